@@ -0,0 +1,289 @@
+/** @file   BenchmarkColorConversion.cpp
+    @brief  Benchmark for color conversions with the scalar and SIMD
+            implementations. Verifies first that all implementations produce
+            identical results for all 2^24 colors, and that the fused
+            conversions between gray and HSV equal the conversion via RGB.
+            Also covers layout and pixel type conversions.
+    @see    ColorConversion, CpuFeatures
+*/
+
+#include <Graphics2D/Image.hh>
+#include <Graphics2D/ImageIO.hh>
+#include <Graphics2D/ImageView.hh>
+#include <Graphics2D/ColorConversion.hh>
+#include "BenchmarkTimer.hh"
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+/** @brief Names of instruction sets. */
+static const char *INSTRUCTION_SET_NAMES[] = { "Auto", "Scalar", "SSSE3", "AVX2" };
+
+/** @brief Conversion method on views. */
+typedef void (*ConvertFunction)(const ImageView &, const ImageView &);
+
+/** @brief Conversions with source and target color model, layout and
+           pixel type. */
+struct Conversion
+{
+  const char *name;
+  ConvertFunction function;
+  Image::ColorModel srcModel, dstModel;
+  Image::PixelLayout srcLayout, dstLayout;
+  Image::PixelType srcType, dstType;
+};
+
+static const Image::PixelLayout PL_I = Image::PL_Interleaved, PL_P = Image::PL_Planar;
+static const Image::PixelType PT_8 = Image::PT_UInt8, PT_16 = Image::PT_UInt16,
+                              PT_F = Image::PT_Float;
+
+static const Conversion CONVERSIONS[] = {
+  { "RGBToGray", ColorConversion::RGBToGray, Image::CM_RGB, Image::CM_Gray, PL_I, PL_I, PT_8, PT_8 },
+  { "GrayToRGB", ColorConversion::GrayToRGB, Image::CM_Gray, Image::CM_RGB, PL_I, PL_I, PT_8, PT_8 },
+  { "RGBToHSV", ColorConversion::RGBToHSV, Image::CM_RGB, Image::CM_HSV, PL_I, PL_I, PT_8, PT_8 },
+  { "HSVToRGB", ColorConversion::HSVToRGB, Image::CM_HSV, Image::CM_RGB, PL_I, PL_I, PT_8, PT_8 },
+  { "HSVToGray", ColorConversion::HSVToGray, Image::CM_HSV, Image::CM_Gray, PL_I, PL_I, PT_8, PT_8 },
+  { "GrayToHSV", ColorConversion::GrayToHSV, Image::CM_Gray, Image::CM_HSV, PL_I, PL_I, PT_8, PT_8 },
+  { "Deinterleave", ColorConversion::ConvertLayout, Image::CM_RGB, Image::CM_RGB, PL_I, PL_P, PT_8, PT_8 },
+  { "Interleave", ColorConversion::ConvertLayout, Image::CM_RGB, Image::CM_RGB, PL_P, PL_I, PT_8, PT_8 },
+  { "RGBToHSV planar", ColorConversion::RGBToHSV, Image::CM_RGB, Image::CM_HSV, PL_P, PL_P, PT_8, PT_8 },
+  { "UInt8ToUInt16", ColorConversion::ConvertDepth, Image::CM_RGB, Image::CM_RGB, PL_I, PL_I, PT_8, PT_16 },
+  { "UInt16ToUInt8", ColorConversion::ConvertDepth, Image::CM_RGB, Image::CM_RGB, PL_I, PL_I, PT_16, PT_8 },
+  { "UInt8ToFloat", ColorConversion::ConvertDepth, Image::CM_RGB, Image::CM_RGB, PL_I, PL_I, PT_8, PT_F },
+  { "FloatToUInt8", ColorConversion::ConvertDepth, Image::CM_RGB, Image::CM_RGB, PL_I, PL_I, PT_F, PT_8 },
+  { "UInt16ToFloat", ColorConversion::ConvertDepth, Image::CM_RGB, Image::CM_RGB, PL_I, PL_I, PT_16, PT_F },
+  { "FloatToUInt16", ColorConversion::ConvertDepth, Image::CM_RGB, Image::CM_RGB, PL_I, PL_I, PT_F, PT_16 }
+};
+static const int NUM_CONVERSIONS = sizeof(CONVERSIONS) / sizeof(CONVERSIONS[0]);
+
+/** @brief Returns true if both views have identical pixel data. */
+static bool IsEqual(const ImageView &a, const ImageView &b)
+{
+  int numPlanes = a.IsPlanar() ? a.GetChannels() : 1;
+  int rowBytes = (a.IsPlanar() ? a.GetWidth() : a.GetWidth() * a.GetChannels()) *
+                 a.GetBytesPerValue();
+  for (int c = 0; c < numPlanes; c++)
+    for (int y = 0; y < a.GetHeight(); y++)
+      if (memcmp(a.GetPlaneRow(c, y), b.GetPlaneRow(c, y), rowBytes) != 0)
+        return false;
+  return true;
+}
+
+/** @brief Fill image with all 2^24 colors, or the first values of each
+           row with all 256 values for gray images. 16-bit images are
+           filled with all 2^16 values, float images with values in
+           [-0.03, 1.05]. */
+static void FillAllValues(Image &image)
+{
+  for (int y = 0; y < image.GetHeight(); y++) {
+    for (int x = 0; x < image.GetWidth(); x++) {
+      int value = y * image.GetWidth() + x;
+      if (image.GetPixelType() != Image::PT_UInt8) {
+        for (int c = 0; c < image.GetChannels(); c++) {
+          int k = value * image.GetChannels() + c;
+          if (image.GetPixelType() == Image::PT_UInt16)
+            image.SetValue(x, y, c, (k & 0xFFFF) / 65535.0f);
+          else
+            image.SetValue(x, y, c, (k % 70000) / 65000.0f - 0.03f);
+        }
+      } else if (image.GetChannels() == 1) {
+        image.SetPixel(x, y, 0, (unsigned char)(value + y));
+      } else {
+        image.SetPixel(x, y, 0, (unsigned char)(value >> 16));
+        image.SetPixel(x, y, 1, (unsigned char)(value >> 8));
+        image.SetPixel(x, y, 2, (unsigned char)value);
+      }
+    }
+  }
+}
+
+/** @brief Compare fused conversions between gray and HSV with the
+           conversion via an RGB image.
+    @return Returns false if any result differs. */
+static bool VerifyFused()
+{
+  Image hsv(4096, 4096, Image::CM_HSV), gray(256, 1, Image::CM_Gray);
+  FillAllValues(hsv);
+  FillAllValues(gray);
+  Image fused, rgb, reference;
+  ColorConversion::HSVToGray(hsv, fused);
+  ColorConversion::HSVToRGB(hsv, rgb);
+  ColorConversion::RGBToGray(rgb, reference);
+  bool equal = IsEqual(ImageView(fused), ImageView(reference));
+  ColorConversion::GrayToHSV(gray, fused);
+  ColorConversion::GrayToRGB(gray, rgb);
+  ColorConversion::RGBToHSV(rgb, reference);
+  equal = equal && IsEqual(ImageView(fused), ImageView(reference));
+  cout << "Verify fused HSVToGray and GrayToHSV : "
+       << (equal ? "identical" : "MISMATCH") << endl;
+  return equal;
+}
+
+/** @brief Compare conversions of images in place, i.e. with the same image
+           as source and target, with conversions into another image.
+    @return Returns false if any result differs. */
+static bool VerifyInPlace()
+{
+  typedef void (*ImageFunction)(const Image &, Image &);
+  const ImageFunction functions[6] = {
+    ColorConversion::RGBToGray, ColorConversion::GrayToRGB, ColorConversion::RGBToHSV,
+    ColorConversion::HSVToRGB, ColorConversion::HSVToGray, ColorConversion::GrayToHSV
+  };
+  const Image::ColorModel srcModels[6] = {
+    Image::CM_RGB, Image::CM_Gray, Image::CM_RGB, Image::CM_HSV, Image::CM_HSV, Image::CM_Gray
+  };
+  bool equal = true;
+  for (int i = 0; i < 6; i++) {
+    for (int layout = 0; layout < 2; layout++) {
+      Image src(301, 67, srcModels[i], 32, (Image::PixelLayout)layout);
+      FillAllValues(src);
+      Image reference(1, 1, Image::CM_Gray, 32, (Image::PixelLayout)layout), image(src);
+      functions[i](src, reference);
+      functions[i](image, image);
+      equal = equal && image.GetColorModel() == reference.GetColorModel() &&
+              image.IsPlanar() == reference.IsPlanar() &&
+              IsEqual(ImageView(image), ImageView(reference));
+    }
+  }
+  // Conversions of layout and pixel type
+  Image src(301, 67, Image::CM_RGB), reference;
+  FillAllValues(src);
+  Image image(src);
+  ColorConversion::ConvertLayout(src, reference, Image::PL_Planar);
+  ColorConversion::ConvertLayout(image, image, Image::PL_Planar);
+  equal = equal && image.IsPlanar() && IsEqual(ImageView(image), ImageView(reference));
+  ColorConversion::ConvertDepth(src, reference, Image::PT_Float);
+  image = src;
+  ColorConversion::ConvertDepth(image, image, Image::PT_Float);
+  equal = equal && image.GetPixelType() == Image::PT_Float &&
+          IsEqual(ImageView(image), ImageView(reference));
+  // Images with wrong number of channels are kept
+  Image gray(src.GetWidth(), src.GetHeight(), Image::CM_Gray);
+  FillAllValues(gray);
+  image = gray;
+  ColorConversion::RGBToHSV(image, image);
+  equal = equal && image.GetColorModel() == Image::CM_Gray &&
+          IsEqual(ImageView(image), ImageView(gray));
+  cout << "Verify conversions in place : " << (equal ? "identical" : "MISMATCH") << endl;
+  return equal;
+}
+
+/** @brief Compare all conversions of all SIMD instruction sets with the
+           scalar implementation, for full images and for unaligned views
+           whose width is not a multiple of the SIMD block size. SIMD
+           results are computed with several threads.
+    @return Returns false if any result differs. */
+static bool Verify()
+{
+  bool valid = true;
+  for (int i = 0; i < NUM_CONVERSIONS; i++) {
+    const Conversion &conv = CONVERSIONS[i];
+    // Fewer rows cover all values of pixel type conversions
+    int height = (conv.srcType == PT_8 && conv.dstType == PT_8) ? 4096 : 128;
+    Image src(4096, height, conv.srcModel, 1, conv.srcLayout, conv.srcType);
+    FillAllValues(src);
+    Image reference(4096, height, conv.dstModel, 1, conv.dstLayout, conv.dstType);
+    Image result(4096, height, conv.dstModel, 1, conv.dstLayout, conv.dstType);
+    ColorConversion::SetInstructionSet(ColorConversion::IS_Scalar);
+    ColorConversion::SetNumThreads(1);
+    conv.function(ImageView(src), ImageView(reference));
+    // Results must not depend on the number of threads
+    ColorConversion::SetNumThreads(7);
+    for (int is = ColorConversion::IS_SSSE3; is <= ColorConversion::IS_AVX2; is++) {
+      if (ColorConversion::SetInstructionSet((ColorConversion::InstructionSet)is) != is)
+        continue;
+      memset(result.GetData(), 0, result.GetNumBytes());
+      conv.function(ImageView(src), ImageView(result));
+      // Views starting at odd column with odd width use the scalar tail
+      ImageView srcRegion(src, 1, 7, 4093, 100), dstRegion(result, 1, 7, 4093, 100);
+      conv.function(srcRegion, dstRegion);
+      bool equal = IsEqual(ImageView(reference), ImageView(result));
+      cout << "Verify " << conv.name << " with " << INSTRUCTION_SET_NAMES[is]
+           << " : " << (equal ? "identical" : "MISMATCH") << endl;
+      valid = valid && equal;
+    }
+  }
+  ColorConversion::SetInstructionSet(ColorConversion::IS_Auto);
+  ColorConversion::SetNumThreads(0);
+  return valid && VerifyFused() && VerifyInPlace();
+}
+
+int main(int argc, char *argv[])
+{
+  // Read parameters
+  if (argc < 2) {
+    cout << "Usage: BenchmarkColorConversion <input image> [<iterations>]" << endl;
+    return 0;
+  }
+  string inputFilename = argv[1];
+  int numIterations = (argc > 2) ? atoi(argv[2]) : 20;
+  cout << "-- BenchmarkColorConversion --" << endl;
+
+  if (!Verify()) {
+    cerr << "SIMD conversions differ from scalar conversions!" << endl;
+    return -1;
+  }
+
+  Image input;
+  if (!ImageIO::Load(inputFilename, input) || input.GetChannels() != 3) {
+    cerr << "Failed to read color image from file " << inputFilename << "!" << endl;
+    return -1;
+  }
+  int width = input.GetWidth(), height = input.GetHeight();
+  cout << "Converting image of size " << width << " x " << height
+       << " pixels " << numIterations << " times" << endl;
+
+  for (int i = 0; i < NUM_CONVERSIONS; i++) {
+    const Conversion &conv = CONVERSIONS[i];
+    Image src(width, height, conv.srcModel, 1, conv.srcLayout, conv.srcType);
+    Image dst(width, height, conv.dstModel, 1, conv.dstLayout, conv.dstType);
+    if (conv.srcModel == Image::CM_Gray)
+      ColorConversion::RGBToGray(ImageView(input), ImageView(src));
+    else if (conv.srcType != PT_8)
+      ColorConversion::ConvertDepth(ImageView(input), ImageView(src));
+    else
+      ColorConversion::ConvertLayout(ImageView(input), ImageView(src));
+    double scalarMs = 0.0;
+    for (int is = ColorConversion::IS_Scalar; is <= ColorConversion::IS_AVX2; is++) {
+      if (ColorConversion::SetInstructionSet((ColorConversion::InstructionSet)is) != is)
+        continue;
+      BenchmarkTimer timer;
+      for (int k = 0; k < numIterations; k++)
+        conv.function(ImageView(src), ImageView(dst));
+      double ms = timer.GetElapsedMs() / numIterations;
+      if (is == ColorConversion::IS_Scalar)
+        scalarMs = ms;
+      cout << conv.name << " with " << INSTRUCTION_SET_NAMES[is] << " : " << ms
+           << " ms (" << 1e-3 * width * height / ms << " MPixel/s, speedup "
+           << scalarMs / ms << "x)" << endl;
+    }
+  }
+  ColorConversion::SetInstructionSet(ColorConversion::IS_Auto);
+
+  // Convert large image with increasing number of threads
+  int maxThreads = ColorConversion::GetNumThreads();
+  Image large(4 * width, 4 * height, Image::CM_RGB), hsv;
+  for (int y = 0; y < large.GetHeight(); y++)
+    for (int x = 0; x < 4; x++)
+      memcpy(large.GetRow(y) + 3 * x * width, input.GetRow(y % height), 3 * width);
+  double serialMs = 0.0;
+  for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+    ColorConversion::SetNumThreads(numThreads);
+    ColorConversion::RGBToHSV(large, hsv);
+    BenchmarkTimer timer;
+    for (int k = 0; k < numIterations; k++)
+      ColorConversion::RGBToHSV(large, hsv);
+    double ms = timer.GetElapsedMs() / numIterations;
+    if (numThreads == 1)
+      serialMs = ms;
+    cout << "RGBToHSV of " << large.GetWidth() << " x " << large.GetHeight()
+         << " pixels with " << numThreads << " threads : " << ms
+         << " ms (speedup " << serialMs / ms << "x)" << endl;
+  }
+  ColorConversion::SetNumThreads(0);
+
+  return 0;
+}
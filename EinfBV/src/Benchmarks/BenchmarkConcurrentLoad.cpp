@@ -0,0 +1,92 @@
+/** @file   BenchmarkConcurrentLoad.cpp
+    @brief  Stress test and benchmark for loading the same image file from
+            many threads simultaneously with ImageIO::Load(), e.g. a JPEG
+            file decoded by FreeImage. Every loaded image is compared with
+            an image loaded by a single thread.
+    @see    ImageIO
+*/
+
+#include <Graphics2D/Image.hh>
+#include <Graphics2D/ImageIO.hh>
+#include "BenchmarkTimer.hh"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+/** @brief Returns if both images have the same size, type and values. */
+static bool IsEqual(const Image &a, const Image &b)
+{
+  if (a.GetWidth() != b.GetWidth() || a.GetHeight() != b.GetHeight() ||
+      a.GetColorModel() != b.GetColorModel() || a.GetPixelType() != b.GetPixelType())
+    return false;
+  int rowBytes = a.GetWidth() * a.GetChannels() * a.GetBytesPerValue();
+  for (int y = 0; y < a.GetHeight(); y++)
+    if (memcmp(a.GetRow(y), b.GetRow(y), rowBytes) != 0)
+      return false;
+  return true;
+}
+
+int main(int argc, char *argv[])
+{
+  // Read parameters
+  if (argc < 2) {
+    cout << "Usage: BenchmarkConcurrentLoad <input image> [<threads>] [<loads per thread>]" << endl;
+    return 0;
+  }
+  string inputFilename = argv[1];
+  int maxThreads = (argc > 2) ? atoi(argv[2]) : 16;
+  int numLoads = (argc > 3) ? atoi(argv[3]) : 20;
+  cout << "-- BenchmarkConcurrentLoad --" << endl;
+
+  // Load reference image in this thread
+  Image reference;
+  if (!ImageIO::Load(inputFilename, reference)) {
+    cerr << "Failed to read image from file " << inputFilename << "!" << endl;
+    return -1;
+  }
+
+  // Load image from an increasing number of threads, all threads start
+  // together to maximize contention
+  bool success = true;
+  for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+    atomic<int> numFailed(0), numReady(0);
+    atomic<bool> start(false);
+    vector<thread> threads;
+    for (int i = 0; i < numThreads; i++) {
+      threads.push_back(thread([&]() {
+        numReady++;
+        while (!start)
+          this_thread::yield();
+        Image image;
+        ImageIO::ImageInfo info;
+        for (int j = 0; j < numLoads; j++) {
+          if (!ImageIO::ReadInfo(inputFilename, info) ||
+              info.width != reference.GetWidth() ||
+              !ImageIO::Load(inputFilename, image) || !IsEqual(image, reference))
+            numFailed++;
+        }
+      }));
+    }
+    while (numReady < numThreads)
+      this_thread::yield();
+    BenchmarkTimer timer;
+    start = true;
+    for (size_t i = 0; i < threads.size(); i++)
+      threads[i].join();
+    double ms = timer.GetElapsedMs();
+    int numImages = numThreads * numLoads;
+    cout << numThreads << " threads : " << numImages << " images in " << ms << " ms ("
+         << 1e3 * numImages / ms << " images/s), " << numFailed << " failed" << endl;
+    if (numFailed > 0)
+      success = false;
+  }
+  if (!success)
+    cerr << "Images loaded concurrently differ from the reference image!" << endl;
+  return success ? 0 : -1;
+}
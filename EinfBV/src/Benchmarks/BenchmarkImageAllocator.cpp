@@ -0,0 +1,81 @@
+/** @file   BenchmarkImageAllocator.cpp
+    @brief  Benchmark for converting a stream of frames with temporary images
+            allocated on the heap or with a PoolImageAllocator.
+    @see    ImageAllocator, PoolImageAllocator
+*/
+
+#include <Graphics2D/Image.hh>
+#include <Graphics2D/ImageIO.hh>
+#include <Graphics2D/ImageAllocator.hh>
+#include <Graphics2D/ColorConversion.hh>
+#include "BenchmarkTimer.hh"
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+
+using namespace std;
+
+/** @brief Convert a stream of frames, creating all images per frame. */
+static double ConvertFrames(const Image &input, int numFrames)
+{
+  BenchmarkTimer timer;
+  int rowBytes = input.GetWidth() * input.GetChannels();
+  for (int i = 0; i < numFrames; i++) {
+    // Create new frame and copy input data into it
+    Image frame(input.GetWidth(), input.GetHeight(), Image::CM_HSV);
+    for (int y = 0; y < input.GetHeight(); y++)
+      memcpy(frame.GetRow(y), input.GetRow(y), rowBytes);
+    // Convert frame via temporary images
+    Image gray, hsv;
+    ColorConversion::HSVToGray(frame, gray);
+    ColorConversion::GrayToHSV(gray, hsv);
+  }
+  return timer.GetElapsedMs();
+}
+
+int main(int argc, char *argv[])
+{
+  // Read parameters
+  if (argc < 2) {
+    cout << "Usage: BenchmarkImageAllocator <input image> [<frames>]" << endl;
+    return 0;
+  }
+  string inputFilename = argv[1];
+  int numFrames = (argc > 2) ? atoi(argv[2]) : 200;
+  cout << "-- BenchmarkImageAllocator --" << endl;
+
+  Image input;
+  if (!ImageIO::Load(inputFilename, input) || input.GetChannels() != 3) {
+    cerr << "Failed to read color image from file " << inputFilename << "!" << endl;
+    return -1;
+  }
+  cout << "Converting " << numFrames << " frames of size " << input.GetWidth()
+       << " x " << input.GetHeight() << " pixels" << endl;
+
+  // Convert frames using the heap allocator
+  double heapMs = ConvertFrames(input, numFrames);
+  cout << "HeapImageAllocator : " << heapMs / numFrames << " ms per frame" << endl;
+
+  // Convert frames using the pool allocator
+  PoolImageAllocator pool;
+  ImageAllocator::SetDefault(&pool);
+  double poolMs = ConvertFrames(input, numFrames);
+  ImageAllocator::SetDefault(NULL);
+  PoolImageAllocator::Statistics stats = pool.GetStatistics();
+  cout << "PoolImageAllocator : " << poolMs / numFrames << " ms per frame ("
+       << stats.hits << " hits, " << stats.misses << " misses, "
+       << 1e-6 * stats.cachedBytes << " MB cached)" << endl;
+  cout << "Speedup is " << heapMs / poolMs << "x" << endl;
+
+  // Verify that size classes cover the request and fit into an int
+  bool valid = true;
+  const size_t sizes[5] = { 1, 4097, 1000000, INT_MAX - 4096, INT_MAX };
+  for (int i = 0; i < 5; i++) {
+    size_t size = PoolImageAllocator::GetSizeClass(sizes[i]);
+    valid = valid && size >= sizes[i] && size <= (size_t)INT_MAX;
+  }
+  cout << "Verify size classes : " << (valid ? "valid" : "INVALID") << endl;
+  return valid ? 0 : -1;
+}
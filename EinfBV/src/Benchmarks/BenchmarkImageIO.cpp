@@ -0,0 +1,170 @@
+/** @file   BenchmarkImageIO.cpp
+    @brief  Benchmark for loading binary Portable PixMap files with
+            ImageIO::LoadPPM() and ImageIO::LoadPPMMapped(), for encoding and
+            decoding them in memory with ImageIO::SaveToMemory() and
+            ImageIO::LoadFromMemory() and for reading their headers only with
+            ImageIO::ReadPPMHeader() and ImageIO::ReadInfo().
+    @see    ImageIO
+*/
+
+#include <Graphics2D/Image.hh>
+#include <Graphics2D/ImageIO.hh>
+#include "BenchmarkTimer.hh"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+/** @brief Sum up all image values to make sure that all pixels are read. */
+static unsigned long TouchImage(const Image &image)
+{
+  unsigned long sum = 0;
+  const unsigned char *d = image.GetData();
+  for (int i = 0; i < image.GetNumBytes(); i++)
+    sum += d[i];
+  return sum;
+}
+
+int main(int argc, char *argv[])
+{
+  // Read parameters
+  if (argc < 2) {
+    cout << "Usage: BenchmarkImageIO <input image> [<scale>] [<iterations>]" << endl;
+    return 0;
+  }
+  string inputFilename = argv[1];
+  int scale = (argc > 2) ? atoi(argv[2]) : 8;
+  int iterations = (argc > 3) ? atoi(argv[3]) : 10;
+  string tmpFilename = "BenchmarkImageIO_tmp.ppm";
+  cout << "-- BenchmarkImageIO --" << endl;
+
+  // Load image and scale it up by tiling it scale x scale times
+  Image input;
+  if (!ImageIO::Load(inputFilename, input)) {
+    cerr << "Failed to read image from file " << inputFilename << "!" << endl;
+    return -1;
+  }
+  int w = input.GetWidth(), h = input.GetHeight(), ch = input.GetChannels();
+  Image image(scale * w, scale * h, input.GetColorModel());
+  for (int y = 0; y < image.GetHeight(); y++) {
+    const unsigned char *src = input.GetRow(y % h);
+    unsigned char *dst = image.GetRow(y);
+    for (int i = 0; i < scale; i++, dst += w * ch)
+      memcpy(dst, src, w * ch);
+  }
+  if (!ImageIO::SavePPM(tmpFilename, image)) {
+    cerr << "Failed to write image to file " << tmpFilename << "!" << endl;
+    return -1;
+  }
+  cout << "Benchmark image has size " << image.GetWidth() << " x "
+       << image.GetHeight() << " pixels (" << 1e-6*image.GetNumBytes()
+       << " MB), " << iterations << " iterations" << endl;
+  unsigned long expectedSum = TouchImage(image);
+  image.Release();
+
+  // Measure time to open the file and to open it and read all pixels
+  const char *names[3] = { "LoadPPM", "LoadPPMMapped (read-only)",
+                           "LoadPPMMapped (copy-on-write)" };
+  for (int mode = 0; mode < 3; mode++) {
+    double openMs = 0.0, totalMs = 0.0;
+    for (int it = 0; it < iterations; it++) {
+      BenchmarkTimer timer;
+      bool success = (mode == 0) ? ImageIO::LoadPPM(tmpFilename, image)
+                                 : ImageIO::LoadPPMMapped(tmpFilename, image, mode == 2);
+      openMs += timer.GetElapsedMs();
+      unsigned long sum = TouchImage(image);
+      totalMs += timer.GetElapsedMs();
+      image.Release();
+      if (!success || sum != expectedSum) {
+        cerr << names[mode] << " failed to read image data correctly!" << endl;
+        remove(tmpFilename.c_str());
+        return -1;
+      }
+    }
+    cout << names[mode] << " : open " << openMs / iterations << " ms, open and read "
+         << totalMs / iterations << " ms" << endl;
+  }
+
+  // Verify that writing into mapped images never changes the file
+  bool unchanged = ImageIO::LoadPPMMapped(tmpFilename, image);
+  if (unchanged) {
+    unsigned char value = image.GetPixel(0, 0, 0);
+    image.SetPixel(0, 0, 0, value + 1);
+    image.Clear();
+    unchanged = image.GetPixel(0, 0, 0) == value;
+    memset(image.GetRow(0), value + 1, image.GetStride());
+    image.Release();
+    unchanged = unchanged && ImageIO::LoadPPMMapped(tmpFilename, image, true);
+    image.Clear();
+    image.Release();
+    unchanged = unchanged && ImageIO::LoadPPM(tmpFilename, image) &&
+                TouchImage(image) == expectedSum;
+    image.Release();
+  }
+  cout << "Verify writing mapped images : " << (unchanged ? "file unchanged" : "MISMATCH") << endl;
+  if (!unchanged) {
+    remove(tmpFilename.c_str());
+    return -1;
+  }
+
+  // Measure time to encode the image into a reused buffer and decode it
+  if (!ImageIO::LoadPPM(tmpFilename, image)) {
+    cerr << "LoadPPM failed to read image!" << endl;
+    remove(tmpFilename.c_str());
+    return -1;
+  }
+  vector<unsigned char> buffer;
+  double saveMs = 0.0, loadMs = 0.0;
+  Image decoded;
+  for (int it = 0; it < iterations; it++) {
+    BenchmarkTimer timer;
+    bool success = ImageIO::SaveToMemory(image, buffer, "ppm");
+    saveMs += timer.GetElapsedMs();
+    timer.Start();
+    success = success && ImageIO::LoadFromMemory(&buffer[0], buffer.size(), decoded);
+    loadMs += timer.GetElapsedMs();
+    if (!success || TouchImage(decoded) != expectedSum) {
+      cerr << "SaveToMemory/LoadFromMemory failed to encode image data correctly!" << endl;
+      remove(tmpFilename.c_str());
+      return -1;
+    }
+  }
+  cout << "SaveToMemory : " << saveMs / iterations << " ms, LoadFromMemory : "
+       << loadMs / iterations << " ms" << endl;
+  image.Release();
+  decoded.Release();
+
+  // Measure time to open the file and read its header only
+  const int numProbes = 1000;
+  BenchmarkTimer timer;
+  for (int i = 0; i < numProbes; i++) {
+    ifstream file(tmpFilename.c_str(), ios::in | ios::binary);
+    ImageIO::PPMHeader header;
+    if (ImageIO::ReadPPMHeader(file, header) != ImageIO::PPM_OK) {
+      cerr << "ReadPPMHeader failed to read header!" << endl;
+      remove(tmpFilename.c_str());
+      return -1;
+    }
+  }
+  double probeMs = timer.GetElapsedMs();
+  cout << "ReadPPMHeader : " << 1e3 * numProbes / probeMs << " headers/s" << endl;
+  timer.Start();
+  for (int i = 0; i < numProbes; i++) {
+    ImageIO::ImageInfo info;
+    if (!ImageIO::ReadInfo(tmpFilename, info) || info.width != scale * w) {
+      cerr << "ReadInfo failed to read header!" << endl;
+      remove(tmpFilename.c_str());
+      return -1;
+    }
+  }
+  probeMs = timer.GetElapsedMs();
+  cout << "ReadInfo : " << 1e3 * numProbes / probeMs << " headers/s" << endl;
+
+  remove(tmpFilename.c_str());
+  return 0;
+}
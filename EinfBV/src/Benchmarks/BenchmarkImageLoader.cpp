@@ -0,0 +1,110 @@
+/** @file   BenchmarkImageLoader.cpp
+    @brief  Benchmark for processing a sequence of image files, loaded with
+            ImageIO::Load() one after another or prefetched by ImageLoader.
+    @see    ImageLoader
+*/
+
+#include <Graphics2D/Image.hh>
+#include <Graphics2D/ImageIO.hh>
+#include <Graphics2D/ImageLoader.hh>
+#include <Graphics2D/ColorConversion.hh>
+#include "BenchmarkTimer.hh"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+/** @brief Process image, returns a checksum of the result. */
+static unsigned long ProcessImage(const Image &image, Image &hsv)
+{
+  ColorConversion::RGBToHSV(image, hsv);
+  unsigned long sum = 0;
+  for (int y = 0; y < hsv.GetHeight(); y++) {
+    const unsigned char *row = hsv.GetRow(y);
+    for (int x = 0; x < 3 * hsv.GetWidth(); x++)
+      sum += row[x];
+  }
+  return sum;
+}
+
+int main(int argc, char *argv[])
+{
+  // Read parameters
+  if (argc < 2) {
+    cout << "Usage: BenchmarkImageLoader <input image> [<frames>] [<buffers>] [<threads>]" << endl;
+    return 0;
+  }
+  string inputFilename = argv[1];
+  int numFrames = (argc > 2) ? atoi(argv[2]) : 32;
+  int numBuffers = (argc > 3) ? atoi(argv[3]) : 4;
+  int numThreads = (argc > 4) ? atoi(argv[4]) : 1;
+  cout << "-- BenchmarkImageLoader --" << endl;
+
+  // Write sequence of frames
+  Image input;
+  if (!ImageIO::Load(inputFilename, input)) {
+    cerr << "Failed to read image from file " << inputFilename << "!" << endl;
+    return -1;
+  }
+  if (input.GetColorModel() != Image::CM_RGB) {
+    Image rgb;
+    ColorConversion::GrayToRGB(input, rgb);
+    input.Swap(rgb);
+  }
+  vector<string> filenames;
+  for (int i = 0; i < numFrames; i++) {
+    ostringstream filename;
+    filename << "BenchmarkImageLoader_tmp" << i << ".ppm";
+    filenames.push_back(filename.str());
+    if (!ImageIO::SavePPM(filenames.back(), input)) {
+      cerr << "Failed to write image to file " << filenames.back() << "!" << endl;
+      return -1;
+    }
+  }
+  cout << numFrames << " frames of size " << input.GetWidth() << " x "
+       << input.GetHeight() << " pixels, " << numBuffers << " buffers, "
+       << numThreads << " loader threads" << endl;
+
+  // Load and process frames one after another
+  Image image, hsv;
+  unsigned long expectedSum = 0;
+  double loadMs = 0.0;
+  BenchmarkTimer timer;
+  for (int i = 0; i < numFrames; i++) {
+    BenchmarkTimer loadTimer;
+    ImageIO::Load(filenames[i], image);
+    loadMs += loadTimer.GetElapsedMs();
+    expectedSum += ProcessImage(image, hsv);
+  }
+  double serialMs = timer.GetElapsedMs();
+
+  // Process frames prefetched by the loader
+  unsigned long sum = 0;
+  int numImages = 0;
+  timer.Start();
+  ImageLoader loader(numBuffers, numThreads);
+  loader.Open(filenames);
+  while (Image *frame = loader.Next()) {
+    sum += ProcessImage(*frame, hsv);
+    loader.Release(frame);
+    numImages++;
+  }
+  double prefetchMs = timer.GetElapsedMs();
+
+  for (int i = 0; i < numFrames; i++)
+    remove(filenames[i].c_str());
+  if (numImages != numFrames || sum != expectedSum) {
+    cerr << "ImageLoader failed to load all frames correctly!" << endl;
+    return -1;
+  }
+  cout << "ImageIO::Load : " << serialMs << " ms (" << 1e3 * numFrames / serialMs
+       << " frames/s), waiting " << loadMs << " ms for loading" << endl;
+  cout << "ImageLoader : " << prefetchMs << " ms (" << 1e3 * numFrames / prefetchMs
+       << " frames/s), stalled " << loader.GetStallMs() << " ms in "
+       << loader.GetNumStalls() << " of " << numFrames << " frames" << endl;
+  return 0;
+}
@@ -0,0 +1,124 @@
+/** @file   BenchmarkLookupTable.cpp
+    @brief  Benchmark for applying per-channel lookup tables and color cubes
+            compared to per-pixel access with GetPixel() and SetPixel().
+    @see    LookupTable, ColorCube
+*/
+
+#include <Graphics2D/Image.hh>
+#include <Graphics2D/ImageIO.hh>
+#include <Graphics2D/LookupTable.hh>
+#include <Graphics2D/ColorCube.hh>
+#include <Graphics2D/ColorConversion.hh>
+#include "BenchmarkTimer.hh"
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+/** @brief Apply lookup table with GetPixel() and SetPixel(). */
+static void ApplyPerPixel(const LookupTable &lut, const Image &src, Image &dst)
+{
+  for (int y = 0; y < src.GetHeight(); y++)
+    for (int x = 0; x < src.GetWidth(); x++)
+      for (int c = 0; c < src.GetChannels(); c++)
+        dst.SetPixel(x, y, c, lut.GetTable(c)[src.GetPixel(x, y, c)]);
+}
+
+/** @brief Check that the identity cube reproduces all 2^24 colors.
+    @return Returns false if any color differs. */
+static bool VerifyIdentityCube()
+{
+  Image colors(4096, 4096, Image::CM_RGB), result;
+  for (int y = 0; y < 4096; y++)
+    for (int x = 0; x < 4096; x++) {
+      int value = y * 4096 + x;
+      unsigned char *pixel = colors.GetRow(y) + 3 * x;
+      pixel[0] = (unsigned char)(value >> 16);
+      pixel[1] = (unsigned char)(value >> 8);
+      pixel[2] = (unsigned char)value;
+    }
+  ColorCube cube(18);
+  cube.Apply(colors, result);
+  bool equal = memcmp(colors.GetData(), result.GetData(), colors.GetNumBytes()) == 0;
+  cout << "Verify identity cube of size 18 : " << (equal ? "identical" : "MISMATCH") << endl;
+  return equal;
+}
+
+int main(int argc, char *argv[])
+{
+  // Read parameters
+  if (argc < 2) {
+    cout << "Usage: BenchmarkLookupTable <input image> [<iterations>]" << endl;
+    return 0;
+  }
+  string inputFilename = argv[1];
+  int numIterations = (argc > 2) ? atoi(argv[2]) : 20;
+  cout << "-- BenchmarkLookupTable --" << endl;
+
+  Image input;
+  if (!ImageIO::Load(inputFilename, input) || input.GetChannels() != 3) {
+    cerr << "Failed to read color image from file " << inputFilename << "!" << endl;
+    return -1;
+  }
+  int numPixels = input.GetWidth() * input.GetHeight();
+  cout << "Processing image of size " << input.GetWidth() << " x "
+       << input.GetHeight() << " pixels " << numIterations << " times" << endl;
+
+  // Gamma correction followed by contrast stretch
+  LookupTable lut, stretch;
+  lut.SetGamma(2.2);
+  stretch.SetContrastStretch(16, 235);
+  lut.Append(stretch);
+  Image reference(input.GetWidth(), input.GetHeight(), Image::CM_RGB), result;
+  BenchmarkTimer timer;
+  for (int k = 0; k < numIterations; k++)
+    ApplyPerPixel(lut, input, reference);
+  double pixelMs = timer.GetElapsedMs() / numIterations;
+  timer.Start();
+  for (int k = 0; k < numIterations; k++)
+    lut.Apply(input, result);
+  double lutMs = timer.GetElapsedMs() / numIterations;
+  timer.Start();
+  for (int k = 0; k < numIterations; k++)
+    memcpy(result.GetData(), input.GetData(), input.GetNumBytes());
+  double copyMs = timer.GetElapsedMs() / numIterations;
+  lut.Apply(input, result);
+  if (memcmp(reference.GetData(), result.GetData(), input.GetNumBytes()) != 0) {
+    cerr << "LookupTable::Apply() differs from per-pixel access!" << endl;
+    return -1;
+  }
+  cout << "GetPixel/SetPixel : " << pixelMs << " ms" << endl;
+  cout << "LookupTable       : " << lutMs << " ms (" << 1e-3 * numPixels / lutMs
+       << " MPixel/s, speedup " << pixelMs / lutMs << "x)" << endl;
+  cout << "memcpy            : " << copyMs << " ms" << endl;
+
+  // Increase value by 20 percent in HSV space
+  if (!VerifyIdentityCube())
+    return -1;
+  ColorCube cube;
+  cube.SetHSVAdjustment(0, 1.0, 1.2);
+  timer.Start();
+  for (int k = 0; k < numIterations; k++)
+    cube.Apply(input, result);
+  double cubeMs = timer.GetElapsedMs() / numIterations;
+  timer.Start();
+  Image hsv;
+  LookupTable value;
+  value.SetLinear(1.2, 0.0, 2);
+  for (int k = 0; k < numIterations; k++) {
+    ColorConversion::RGBToHSV(input, hsv);
+    value.Apply(hsv, hsv);
+    ColorConversion::HSVToRGB(hsv, reference);
+  }
+  double hsvMs = timer.GetElapsedMs() / numIterations;
+  double error = 0.0;
+  for (int i = 0; i < input.GetNumBytes(); i++)
+    error += abs((int)result.GetData()[i] - (int)reference.GetData()[i]);
+  cout << "ColorCube         : " << cubeMs << " ms (" << 1e-3 * numPixels / cubeMs
+       << " MPixel/s, mean deviation " << error / input.GetNumBytes() << ")" << endl;
+  cout << "HSV conversion    : " << hsvMs << " ms" << endl;
+
+  return 0;
+}
@@ -0,0 +1,133 @@
+/** @file   BenchmarkPPMStream.cpp
+    @brief  Benchmark for converting binary Portable PixMap files to HSV in
+            bands of rows with PPMReader and PPMWriter, compared to loading
+            the whole image with ImageIO::LoadPPM().
+    @see    PPMReader, PPMWriter
+*/
+
+#include <Graphics2D/Image.hh>
+#include <Graphics2D/ImageIO.hh>
+#include <Graphics2D/PPMReader.hh>
+#include <Graphics2D/PPMWriter.hh>
+#include <Graphics2D/ColorConversion.hh>
+#include "BenchmarkTimer.hh"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+/** @brief Returns if both files have identical contents. */
+static bool CompareFiles(const string &filename1, const string &filename2)
+{
+  ifstream file1(filename1.c_str(), ios::in | ios::binary);
+  ifstream file2(filename2.c_str(), ios::in | ios::binary);
+  vector<char> buffer1(1 << 16), buffer2(1 << 16);
+  while (file1.good() && file2.good()) {
+    file1.read(&buffer1[0], buffer1.size());
+    file2.read(&buffer2[0], buffer2.size());
+    if (file1.gcount() != file2.gcount() ||
+        memcmp(&buffer1[0], &buffer2[0], file1.gcount()) != 0)
+      return false;
+  }
+  return file1.eof() && file2.eof();
+}
+
+int main(int argc, char *argv[])
+{
+  // Read parameters
+  if (argc < 2) {
+    cout << "Usage: BenchmarkPPMStream <input image> [<scale>] [<band rows>]" << endl;
+    return 0;
+  }
+  string inputFilename = argv[1];
+  int scale = (argc > 2) ? atoi(argv[2]) : 8;
+  int bandRows = (argc > 3) ? atoi(argv[3]) : 64;
+  string tmpFilename = "BenchmarkPPMStream_tmp.ppm";
+  string loadFilename = "BenchmarkPPMStream_load.ppm";
+  string streamFilename = "BenchmarkPPMStream_stream.ppm";
+  cout << "-- BenchmarkPPMStream --" << endl;
+
+  // Load RGB image and write it tiled scale x scale times in bands, so the
+  // benchmark image is never held in memory completely
+  Image input;
+  if (!ImageIO::Load(inputFilename, input)) {
+    cerr << "Failed to read image from file " << inputFilename << "!" << endl;
+    return -1;
+  }
+  if (input.GetColorModel() != Image::CM_RGB) {
+    Image rgb;
+    ColorConversion::GrayToRGB(input, rgb);
+    input.Swap(rgb);
+  }
+  int w = input.GetWidth(), h = input.GetHeight();
+  PPMWriter writer;
+  if (!writer.Open(tmpFilename, scale * w, scale * h, Image::CM_RGB)) {
+    cerr << "Failed to write image to file " << tmpFilename << "!" << endl;
+    return -1;
+  }
+  Image tiled(scale * w, h, Image::CM_RGB);
+  for (int y = 0; y < h; y++) {
+    unsigned char *dst = tiled.GetRow(y);
+    for (int i = 0; i < scale; i++, dst += 3 * w)
+      memcpy(dst, input.GetRow(y), 3 * w);
+  }
+  for (int i = 0; i < scale; i++)
+    writer.WriteRows(tiled);
+  if (!writer.Close()) {
+    cerr << "Failed to write image to file " << tmpFilename << "!" << endl;
+    return -1;
+  }
+  tiled.Release();
+  double megabytes = 1e-6 * 3.0 * scale * w * scale * h;
+  cout << "Benchmark image has size " << scale * w << " x " << scale * h
+       << " pixels (" << megabytes << " MB), bands of " << bandRows << " rows" << endl;
+
+  // Convert the whole image in memory
+  BenchmarkTimer timer;
+  Image image, hsv;
+  bool success = ImageIO::LoadPPM(tmpFilename, image);
+  ColorConversion::RGBToHSV(image, hsv);
+  success = success && ImageIO::SavePPM(loadFilename, hsv);
+  double loadMs = timer.GetElapsedMs();
+  int loadBytes = image.GetNumBytes() + hsv.GetNumBytes();
+  image.Release();
+  hsv.Release();
+
+  // Convert the image band by band
+  timer.Start();
+  PPMReader reader;
+  Image band, hsvBand;
+  success = success && reader.Open(tmpFilename) &&
+            writer.Open(streamFilename, reader.GetWidth(), reader.GetHeight(),
+                        Image::CM_HSV);
+  while (success && reader.ReadRows(band, bandRows) > 0) {
+    ColorConversion::RGBToHSV(band, hsvBand);
+    success = writer.WriteRows(hsvBand);
+  }
+  success = success && reader.GetNextRow() == reader.GetHeight() && writer.Close();
+  reader.Close();
+  double streamMs = timer.GetElapsedMs();
+  int streamBytes = band.GetNumBytes() + hsvBand.GetNumBytes();
+
+  if (!success || !CompareFiles(loadFilename, streamFilename)) {
+    cerr << "Streamed conversion differs from conversion in memory!" << endl;
+    success = false;
+  } else {
+    cout << "LoadPPM + RGBToHSV + SavePPM : " << loadMs << " ms ("
+         << megabytes / (1e-3 * loadMs) << " MB/s), image memory "
+         << 1e-6 * loadBytes << " MB" << endl;
+    cout << "PPMReader + RGBToHSV + PPMWriter : " << streamMs << " ms ("
+         << megabytes / (1e-3 * streamMs) << " MB/s), band memory "
+         << 1e-6 * streamBytes << " MB" << endl;
+  }
+
+  remove(tmpFilename.c_str());
+  remove(loadFilename.c_str());
+  remove(streamFilename.c_str());
+  return success ? 0 : -1;
+}
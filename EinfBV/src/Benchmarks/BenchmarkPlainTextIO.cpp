@@ -0,0 +1,144 @@
+/** @file   BenchmarkPlainTextIO.cpp
+    @brief  Benchmark for loading and saving plain text Portable PixMap files
+            (P2/P3) with ImageIO compared to per-value stream operators.
+    @see    ImageIO
+*/
+
+#include <Graphics2D/Image.hh>
+#include <Graphics2D/ImageIO.hh>
+#include "BenchmarkTimer.hh"
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+/** @brief Save plain text file with one stream operator call per value. */
+static bool SaveStreamPPM(const string &filename, const Image &image)
+{
+  ofstream file(filename.c_str());
+  if (!file.good())
+    return false;
+  file << (image.GetChannels() == 1 ? "P2" : "P3") << endl;
+  file << image.GetWidth() << " " << image.GetHeight() << endl << 255 << endl;
+  const unsigned char *d = image.GetData();
+  int rowBytes = image.GetWidth() * image.GetChannels();
+  for (int i = 0; i < image.GetNumBytes(); i++)
+    file << (int)d[i] << (((i+1) % rowBytes == 0) ? "\n" : " ");
+  return true;
+}
+
+/** @brief Load plain text file with one stream operator call per value. */
+static bool LoadStreamPPM(const string &filename, Image &image)
+{
+  ifstream file(filename.c_str());
+  string magic;
+  int w, h, maxVal;
+  file >> magic >> w >> h >> maxVal;
+  if (!file.good() || w <= 0 || h <= 0)
+    return false;
+  image.Init(w, h, magic == "P2" ? Image::CM_Gray : Image::CM_RGB);
+  unsigned char *d = image.GetData();
+  int val;
+  for (int i = 0; i < image.GetNumBytes(); i++) {
+    file >> val;
+    d[i] = (unsigned char)val;
+  }
+  return !file.fail();
+}
+
+/** @brief Check that values are read correctly when they start close to
+           the end of a buffered block after long runs of whitespace or
+           comments, by moving four values across the block boundary.
+    @return Returns false if any value differs. */
+static bool VerifyBlockBoundary(const string &filename)
+{
+  const int BLOCK_SIZE = 1 << 16;
+  const string header = "P2\n4 1\n255\n", values = "123 200 7 45\n";
+  const unsigned char expected[4] = { 123, 200, 7, 45 };
+  for (int comment = 0; comment < 2; comment++) {
+    for (int offset = -40; offset <= 8; offset++) {
+      // Pad with whitespace or a comment line up to the boundary, blocks
+      // are read starting after the header
+      int padding = BLOCK_SIZE + offset;
+      string text = header;
+      if (comment)
+        text += "#" + string(padding - 2, 'x') + "\n";
+      else
+        text += string(padding, ' ');
+      text += values;
+      {
+        ofstream file(filename.c_str(), ios::binary);
+        file << text;
+      }
+      Image loaded;
+      if (!ImageIO::LoadPPM(filename, loaded) || loaded.GetNumBytes() != 4 ||
+          memcmp(loaded.GetData(), expected, 4) != 0) {
+        cerr << "Values across block boundary (" << (comment ? "comment" : "whitespace")
+             << ", offset " << offset << ") are read incorrectly!" << endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+int main(int argc, char *argv[])
+{
+  // Read parameters
+  if (argc < 2) {
+    cout << "Usage: BenchmarkPlainTextIO <input image> [<iterations>]" << endl;
+    return 0;
+  }
+  string inputFilename = argv[1];
+  int iterations = (argc > 2) ? atoi(argv[2]) : 5;
+  string tmpFilename = "BenchmarkPlainTextIO_tmp.ppm";
+  cout << "-- BenchmarkPlainTextIO --" << endl;
+
+  Image image;
+  if (!ImageIO::Load(inputFilename, image)) {
+    cerr << "Failed to read image from file " << inputFilename << "!" << endl;
+    return -1;
+  }
+  cout << "Image has size " << image.GetWidth() << " x " << image.GetHeight()
+       << " pixels and " << image.GetChannels() << " channels, "
+       << iterations << " iterations" << endl;
+
+  if (!VerifyBlockBoundary(tmpFilename)) {
+    remove(tmpFilename.c_str());
+    return -1;
+  }
+
+  // Measure round trips (save and load) with both implementations
+  double saveMs[2] = { 0.0, 0.0 }, loadMs[2] = { 0.0, 0.0 };
+  for (int mode = 0; mode < 2; mode++) {
+    for (int it = 0; it < iterations; it++) {
+      Image loaded;
+      BenchmarkTimer timer;
+      bool success = (mode == 0) ? SaveStreamPPM(tmpFilename, image)
+                                 : ImageIO::SavePPM(tmpFilename, image, true);
+      saveMs[mode] += timer.GetElapsedMs();
+      timer.Start();
+      success = success && ((mode == 0) ? LoadStreamPPM(tmpFilename, loaded)
+                                        : ImageIO::LoadPPM(tmpFilename, loaded));
+      loadMs[mode] += timer.GetElapsedMs();
+      if (!success || loaded.GetNumBytes() != image.GetNumBytes() ||
+          memcmp(loaded.GetData(), image.GetData(), image.GetNumBytes()) != 0) {
+        cerr << "Round trip failed to reproduce image data!" << endl;
+        remove(tmpFilename.c_str());
+        return -1;
+      }
+    }
+    cout << (mode == 0 ? "Stream operators" : "ImageIO (plain text)")
+         << " : save " << saveMs[mode] / iterations << " ms, load "
+         << loadMs[mode] / iterations << " ms" << endl;
+  }
+  cout << "Round trip speedup is "
+       << (saveMs[0] + loadMs[0]) / (saveMs[1] + loadMs[1]) << "x" << endl;
+
+  remove(tmpFilename.c_str());
+  return 0;
+}
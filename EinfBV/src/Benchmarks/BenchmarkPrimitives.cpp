@@ -0,0 +1,443 @@
+/** @file   BenchmarkPrimitives.cpp
+    @brief  Benchmark for drawing primitives into images, e.g. filled
+            rectangles and polygons for annotation overlays. Filled polygons
+            are compared with a per-pixel inside test using SetPixel() and
+            clipped lines with an unclipped Bresenham line. Anti-aliased
+            drawing is timed against aliased drawing, and drawing many mixed
+            primitives with PrimitiveBatch, serial and on several threads,
+            against virtual Draw() calls.
+    @see    PrimitiveBase, PrimitiveLine, PrimitivePolygon, PrimitiveBatch,
+            ImageView
+*/
+
+#include <Graphics2D/Image.hh>
+#include <Graphics2D/ImageView.hh>
+#include <Graphics2D/PrimitivePoint.hh>
+#include <Graphics2D/PrimitiveLine.hh>
+#include <Graphics2D/PrimitivePolygon.hh>
+#include <Graphics2D/PrimitiveRectangle.hh>
+#include <Graphics2D/PrimitiveBatch.hh>
+#include "BenchmarkTimer.hh"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+using namespace std;
+
+/** @brief Returns if both images have the same size, type and values. */
+static bool IsEqual(const Image &a, const Image &b)
+{
+  if (a.GetWidth() != b.GetWidth() || a.GetHeight() != b.GetHeight() ||
+      a.GetChannels() != b.GetChannels() || a.GetPixelType() != b.GetPixelType() ||
+      a.GetLayout() != b.GetLayout())
+    return false;
+  int numPlanes = a.IsPlanar() ? a.GetChannels() : 1;
+  int rowBytes = a.GetWidth() * a.GetBytesPerValue() * a.GetChannels() / numPlanes;
+  for (int c = 0; c < numPlanes; c++)
+    for (int y = 0; y < a.GetHeight(); y++)
+      if (memcmp(a.GetPlaneRow(c, y), b.GetPlaneRow(c, y), rowBytes) != 0)
+        return false;
+  return true;
+}
+
+/** @brief Fill polygon by testing each pixel center for being inside and
+           drawing it with SetPixel(). Uses the same edge rule as
+           PrimitivePolygon, so the results must be identical. */
+static void FillPerPixel(const PrimitivePolygon &polygon, Image &image)
+{
+  int numPoints = polygon.GetNumPoints();
+  bool evenOdd = (polygon.GetFillMode() == PrimitivePolygon::FM_EvenOdd);
+  for (int y = 0; y < image.GetHeight(); y++) {
+    for (int x = 0; x < image.GetWidth(); x++) {
+      int winding = 0;
+      for (int n = 0; n < numPoints; n++) {
+        Float2D p = polygon.GetPoint(n), q = polygon.GetPoint((n+1) % numPoints);
+        int direction = (p[1] < q[1]) ? 1 : -1;
+        if (direction < 0)
+          swap(p, q);
+        if (p[1] == q[1] || y < p[1] || y >= q[1])
+          continue;
+        double slope = ((double)q[0] - p[0]) / ((double)q[1] - p[1]);
+        if ((double)p[0] + (y - (double)p[1]) * slope <= x)
+          winding += evenOdd ? 1 : direction;
+      }
+      if (evenOdd ? (winding & 1) != 0 : winding != 0)
+        image.SetPixel(x, y, polygon.GetColor());
+    }
+  }
+}
+
+/** @brief Draw line with Bresenham algorithm over all steps, checking the
+           coordinates of every pixel in SetPixel(). */
+static void DrawLineUnclipped(const PrimitiveLine &line, Image &image)
+{
+  int x1 = (int)(line.GetPoint(0)[0] + 0.5f), y1 = (int)(line.GetPoint(0)[1] + 0.5f);
+  int x2 = (int)(line.GetPoint(1)[0] + 0.5f), y2 = (int)(line.GetPoint(1)[1] + 0.5f);
+  int dx = abs(x2 - x1), dy = abs(y2 - y1);
+  int sx = x1 < x2 ? 1 : -1, sy = y1 < y2 ? 1 : -1;
+  int &a = (dx > dy) ? x1 : y1, &b = (dx > dy) ? y1 : x1;
+  int da = max(dx, dy), db = min(dx, dy);
+  int sa = (dx > dy) ? sx : sy, sb = (dx > dy) ? sy : sx;
+  int E = 2*db - da;
+  for (int i = 0; i <= da; i++) {
+    image.SetPixel(x1, y1, line.GetColor(), true);
+    a += sa;
+    if (E <= 0) {
+      E += 2*db;
+    } else {
+      b += sb;
+      E += 2*(db - da);
+    }
+  }
+}
+
+/** @brief Create star polygon with given number of spikes, drawn as a
+           pentagram-like self-intersecting outline if step > 1. */
+static vector<Float2D> CreateStar(float cx, float cy, float radius, int numPoints, int step)
+{
+  vector<Float2D> points;
+  for (int n = 0; n < numPoints; n++) {
+    double angle = 2.0 * M_PI * ((n * step) % numPoints) / numPoints + 0.1;
+    points.push_back(Float2D(cx + radius * (float)cos(angle), cy + radius * (float)sin(angle)));
+  }
+  return points;
+}
+
+/** @brief Check clipped lines against unclipped lines for all pixel types
+           and layouts, using random lines partially or fully outside.
+    @return Returns false if any result differs. */
+static bool VerifyLines()
+{
+  vector<PrimitiveLine> lines;
+  srand(7);
+  for (int i = 0; i < 2000; i++) {
+    Float2D p((float)(rand() % 600 - 200) + 0.25f * (rand() % 4),
+              (float)(rand() % 500 - 170) + 0.25f * (rand() % 4));
+    Float2D q((float)(rand() % 600 - 200), (float)(rand() % 500 - 170));
+    if (i % 10 == 0)
+      q = p; // single pixel
+    else if (i % 10 == 1)
+      q = Float2D(p[0], q[1]); // vertical line
+    else if (i % 10 == 2)
+      q = Float2D(q[0], p[1]); // horizontal line
+    else if (i % 10 == 3)
+      q = Float2D(p[0] + (q[1] - p[1]), q[1]); // diagonal line
+    lines.push_back(PrimitiveLine(Color(rand() % 256, rand() % 256, rand() % 256), p, q));
+  }
+  Image::PixelType types[] = { Image::PT_UInt8, Image::PT_UInt16, Image::PT_Float };
+  bool equal = true;
+  for (int cm = 0; cm < 2; cm++) {
+    for (int layout = 0; layout < 2; layout++) {
+      for (int t = 0; t < 3; t++) {
+        Image::ColorModel colorModel = cm ? Image::CM_RGB : Image::CM_Gray;
+        Image result(211, 157, colorModel, 1, (Image::PixelLayout)layout, types[t]);
+        Image reference(result);
+        for (size_t i = 0; i < lines.size(); i++) {
+          lines[i].Draw(result);
+          DrawLineUnclipped(lines[i], reference);
+        }
+        equal = equal && IsEqual(result, reference);
+      }
+    }
+  }
+  cout << "Verify clipped lines   : " << (equal ? "identical" : "MISMATCH") << endl;
+  return equal;
+}
+
+/** @brief Check filled polygons against the per-pixel reference for all
+           pixel types and layouts.
+    @return Returns false if any result differs. */
+static bool VerifyFill()
+{
+  vector<PrimitivePolygon> polygons;
+  polygons.push_back(PrimitiveRectangle(Color::RED, Float2D(10.5f, 7.2f), Float2D(90.5f, 50.0f),
+                                        PrimitivePolygon::FM_EvenOdd));
+  polygons.push_back(PrimitiveRectangle(Color::GREEN, Float2D(-40, -30), Float2D(25, 400),
+                                        PrimitivePolygon::FM_NonZero));
+  polygons.push_back(PrimitivePolygon(Color::BLUE, CreateStar(120, 80, 70, 5, 2),
+                                      PrimitivePolygon::FM_EvenOdd));
+  polygons.push_back(PrimitivePolygon(Color::YELLOW, CreateStar(60, 110, 55, 7, 3),
+                                      PrimitivePolygon::FM_NonZero));
+  polygons.push_back(PrimitivePolygon(Color::CYAN, CreateStar(170, 30, 45, 9, 1),
+                                      PrimitivePolygon::FM_EvenOdd));
+  Image::PixelType types[] = { Image::PT_UInt8, Image::PT_UInt16, Image::PT_Float };
+  bool equal = true;
+  for (int cm = 0; cm < 2; cm++) {
+    for (int layout = 0; layout < 2; layout++) {
+      for (int t = 0; t < 3; t++) {
+        Image::ColorModel colorModel = cm ? Image::CM_RGB : Image::CM_Gray;
+        Image result(211, 157, colorModel, 1, (Image::PixelLayout)layout, types[t]);
+        Image reference(result);
+        for (size_t i = 0; i < polygons.size(); i++) {
+          polygons[i].Draw(result);
+          FillPerPixel(polygons[i], reference);
+        }
+        equal = equal && IsEqual(result, reference);
+      }
+    }
+  }
+  cout << "Verify filled polygons : " << (equal ? "identical" : "MISMATCH") << endl;
+  return equal;
+}
+
+/** @brief Check blending of rows against blending single pixels, which
+           does not use SIMD instructions, and anti-aliased filling of
+           pixel-aligned rectangles against aliased filling.
+    @return Returns false if any result differs. */
+static bool VerifyBlend()
+{
+  bool equal = true;
+  for (int cm = 0; cm < 2; cm++) {
+    for (int layout = 0; layout < 2; layout++) {
+      Image::ColorModel colorModel = cm ? Image::CM_RGB : Image::CM_Gray;
+      Image result(301, 64, colorModel, 1, (Image::PixelLayout)layout);
+      for (int i = 0; i < result.GetNumBytes(); i++)
+        result.GetData()[i] = (unsigned char)rand();
+      Image reference(result);
+      ImageView view(result), referenceView(reference);
+      vector<unsigned char> alpha(result.GetWidth() + 40);
+      for (int y = 0; y < result.GetHeight(); y++) {
+        for (size_t i = 0; i < alpha.size(); i++)
+          alpha[i] = (i % 7 == 0) ? 255 * (rand() % 2) : (unsigned char)rand();
+        Color color(rand() % 256, rand() % 256, rand() % 256);
+        int x0 = rand() % 40 - 20, n = result.GetWidth() - rand() % 20;
+        view.BlendRow(y, x0, n, &alpha[0], color);
+        for (int x = max(x0, 0); x < min(x0 + n, result.GetWidth()); x++)
+          referenceView.BlendPixel(x, y, color, alpha[x - x0]);
+      }
+      equal = equal && IsEqual(result, reference);
+    }
+  }
+  Image result(100, 80, Image::CM_RGB), reference(result);
+  PrimitiveRectangle rectangle(Color::GREEN, Float2D(9.5f, 19.5f), Float2D(70.5f, 60.5f),
+                               PrimitivePolygon::FM_NonZero);
+  rectangle.Draw(reference);
+  rectangle.SetRenderMode(PrimitiveBase::RM_AntiAliased);
+  rectangle.Draw(result);
+  equal = equal && IsEqual(result, reference);
+  cout << "Verify blended rows    : " << (equal ? "identical" : "MISMATCH") << endl;
+  return equal;
+}
+
+/** @brief Check that anti-aliased lines starting far outside of the image
+           stay on the true line, by comparing the weighted center of the
+           drawn pixels of each column with the exact line position.
+    @return Returns false if any column is off by more than 0.02 pixels. */
+static bool VerifyAntiAliasedLines()
+{
+  double maxError = 0.0;
+  for (double distance = 1e4; distance <= 1e7; distance *= 10.0) {
+    Image image(1000, 600, Image::CM_Gray);
+    image.Clear(Color::BLACK);
+    Float2D start((float)(999.3 - distance), (float)(500.6 - distance / 3.0));
+    Float2D end(999.3f, 500.6f);
+    PrimitiveLine line(Color::WHITE, start, end);
+    line.SetRenderMode(PrimitiveBase::RM_AntiAliased);
+    line.Draw(image);
+    double gradient = ((double)end[1] - start[1]) / ((double)end[0] - start[0]);
+    for (int x = 0; x < image.GetWidth(); x++) {
+      double sum = 0.0, weightedSum = 0.0;
+      for (int y = 0; y < image.GetHeight(); y++) {
+        sum += image.GetRow(y)[x];
+        weightedSum += y * image.GetRow(y)[x];
+      }
+      double expected = end[1] + gradient * (x - end[0]);
+      if (sum > 0.0)
+        maxError = max(maxError, fabs(weightedSum / sum - expected));
+      else
+        maxError = max(maxError, 1.0); // column not drawn
+    }
+  }
+  cout << "Verify AA lines        : max. error " << maxError << " pixels" << endl;
+  return maxError <= 0.02;
+}
+
+/** @brief Create random mixed primitives of all types and modes, with
+           a quarter of them partially or completely outside the canvas. */
+static vector<PrimitiveBase*> CreatePrimitives(int numPrimitives, int width, int height)
+{
+  vector<PrimitiveBase*> primitives;
+  for (int i = 0; i < numPrimitives; i++) {
+    float x = (float)(rand() % (width + width / 4) - width / 8) + 0.1f * (rand() % 10);
+    float y = (float)(rand() % (height + height / 4) - height / 8) + 0.1f * (rand() % 10);
+    float size = (float)(4 + rand() % 60);
+    Color color(rand() % 256, rand() % 256, rand() % 256);
+    PrimitiveBase::RenderMode renderMode = (rand() % 8 == 0) ? PrimitiveBase::RM_AntiAliased
+                                                             : PrimitiveBase::RM_Aliased;
+    PrimitivePolygon::FillMode fillMode = (PrimitivePolygon::FillMode)(rand() % 3);
+    switch (i % 4) {
+      case 0:
+        primitives.push_back(new PrimitivePoint(color, Float2D(x, y)));
+        break;
+      case 1:
+        primitives.push_back(new PrimitiveLine(color, Float2D(x, y),
+                                               Float2D(x + size * (rand() % 5 - 2), y + size)));
+        break;
+      case 2:
+        primitives.push_back(new PrimitiveRectangle(color, Float2D(x, y),
+                                                    Float2D(x + size, y + size / 2), fillMode));
+        break;
+      default:
+        primitives.push_back(new PrimitivePolygon(color, CreateStar(x, y, size, 5, 2), fillMode));
+    }
+    primitives.back()->SetRenderMode(renderMode);
+  }
+  return primitives;
+}
+
+/** @brief Check batched drawing against drawing each primitive.
+    @return Returns false if any result differs. */
+static bool VerifyBatch()
+{
+  vector<PrimitiveBase*> primitives = CreatePrimitives(4000, 397, 251);
+  PrimitiveBatch batch(32);
+  for (size_t i = 0; i < primitives.size(); i++)
+    batch.Add(*primitives[i]);
+  bool equal = true;
+  for (int layout = 0; layout < 2; layout++) {
+    Image reference(397, 251, Image::CM_RGB, 1, (Image::PixelLayout)layout);
+    for (size_t i = 0; i < primitives.size(); i++)
+      primitives[i]->Draw(reference);
+    // Draw with one thread and with more threads than tiles
+    for (int numThreads = 1; numThreads <= 128; numThreads *= 8) {
+      Image result(397, 251, Image::CM_RGB, 1, (Image::PixelLayout)layout);
+      batch.SetNumThreads(numThreads);
+      batch.Draw(result);
+      equal = equal && IsEqual(result, reference);
+    }
+  }
+  // Primitives completely outside of the image leave it unchanged
+  PrimitiveBatch outside;
+  outside.AddLine(Color::RED, Float2D(-50.0f, -20.0f), Float2D(-10.0f, -30.0f));
+  Image result(64, 64, Image::CM_RGB), reference(result);
+  outside.Draw(result);
+  equal = equal && IsEqual(result, reference);
+  for (size_t i = 0; i < primitives.size(); i++)
+    delete primitives[i];
+  cout << "Verify batched drawing : " << (equal ? "identical" : "MISMATCH") << endl;
+  return equal;
+}
+
+int main(int argc, char *argv[])
+{
+  // Read parameters
+  int numPrimitives = (argc > 1) ? atoi(argv[1]) : 10000;
+  int numIterations = (argc > 2) ? atoi(argv[2]) : 10;
+  cout << "-- BenchmarkPrimitives --" << endl;
+  if (!VerifyLines() || !VerifyFill() || !VerifyBlend() || !VerifyAntiAliasedLines() ||
+      !VerifyBatch())
+    return -1;
+
+  // Create random annotation boxes and stars on a full HD canvas
+  int width = 1920, height = 1080;
+  vector<PrimitiveRectangle> rectangles;
+  vector<PrimitivePolygon> stars;
+  vector<PrimitiveLine> lines, zoomedLines;
+  srand(42);
+  for (int i = 0; i < numPrimitives; i++) {
+    float x = (float)(rand() % width), y = (float)(rand() % height);
+    float w = (float)(8 + rand() % 64), h = (float)(8 + rand() % 64);
+    Color color(rand() % 256, rand() % 256, rand() % 256);
+    rectangles.push_back(PrimitiveRectangle(color, Float2D(x, y), Float2D(x + w, y + h)));
+    stars.push_back(PrimitivePolygon(color, CreateStar(x, y, w / 2, 5, 2)));
+    Float2D end((float)(rand() % width), (float)(rand() % height));
+    lines.push_back(PrimitiveLine(color, Float2D(x, y), end));
+    // Lines scaled by 100 around the image center, mostly outside the canvas
+    Float2D center(width / 2.0f, height / 2.0f);
+    zoomedLines.push_back(PrimitiveLine(color, center + 100.0f * (Float2D(x, y) - center),
+                                        center + 100.0f * (end - center)));
+  }
+  cout << "Drawing " << numPrimitives << " primitives into image of size "
+       << width << " x " << height << " pixels " << numIterations << " times" << endl;
+
+  Image image(width, height, Image::CM_RGB), reference(image);
+  BenchmarkTimer timer;
+  for (int k = 0; k < numIterations; k++)
+    for (int i = 0; i < numPrimitives; i++)
+      DrawLineUnclipped(zoomedLines[i], reference);
+  double unclippedMs = timer.GetElapsedMs() / numIterations;
+  timer.Start();
+  for (int k = 0; k < numIterations; k++)
+    for (int i = 0; i < numPrimitives; i++)
+      zoomedLines[i].Draw(image);
+  double zoomedMs = timer.GetElapsedMs() / numIterations;
+  timer.Start();
+  for (int k = 0; k < numIterations; k++)
+    for (int i = 0; i < numPrimitives; i++)
+      lines[i].Draw(image);
+  double lineMs = timer.GetElapsedMs() / numIterations;
+  cout << "Zoomed lines (unclipped) : " << unclippedMs << " ms" << endl;
+  cout << "Zoomed lines (clipped)   : " << zoomedMs << " ms (speedup "
+       << unclippedMs / zoomedMs << "x)" << endl;
+  cout << "Lines                    : " << lineMs << " ms ("
+       << 1e3 * lineMs / numPrimitives << " us per primitive)" << endl;
+
+  for (int i = 0; i < numPrimitives; i++)
+    lines[i].SetRenderMode(PrimitiveBase::RM_AntiAliased);
+  timer.Start();
+  for (int k = 0; k < numIterations; k++)
+    for (int i = 0; i < numPrimitives; i++)
+      lines[i].Draw(image);
+  double antiAliasedMs = timer.GetElapsedMs() / numIterations;
+  cout << "Lines (anti-aliased)     : " << antiAliasedMs << " ms ("
+       << 1e3 * antiAliasedMs / numPrimitives << " us per primitive)" << endl;
+
+  const char *modeNames[] = { "outline", "even-odd", "nonzero" };
+  const char *renderModeNames[] = { "", ", anti-aliased" };
+  for (int renderMode = 0; renderMode < 2; renderMode++) {
+    for (int mode = 0; mode < 3; mode++) {
+      for (int i = 0; i < numPrimitives; i++) {
+        rectangles[i].SetFillMode((PrimitivePolygon::FillMode)mode);
+        rectangles[i].SetRenderMode((PrimitiveBase::RenderMode)renderMode);
+        stars[i].SetFillMode((PrimitivePolygon::FillMode)mode);
+        stars[i].SetRenderMode((PrimitiveBase::RenderMode)renderMode);
+      }
+      timer.Start();
+      for (int k = 0; k < numIterations; k++)
+        for (int i = 0; i < numPrimitives; i++)
+          rectangles[i].Draw(image);
+      double rectangleMs = timer.GetElapsedMs() / numIterations;
+      timer.Start();
+      for (int k = 0; k < numIterations; k++)
+        for (int i = 0; i < numPrimitives; i++)
+          stars[i].Draw(image);
+      double starMs = timer.GetElapsedMs() / numIterations;
+      cout << "Rectangles (" << modeNames[mode] << renderModeNames[renderMode] << ") : "
+           << rectangleMs << " ms (" << 1e3 * rectangleMs / numPrimitives
+           << " us per primitive)" << endl;
+      cout << "Stars (" << modeNames[mode] << renderModeNames[renderMode] << ") : "
+           << starMs << " ms (" << 1e3 * starMs / numPrimitives << " us per primitive)" << endl;
+    }
+  }
+
+  // Draw mixed primitives with virtual calls and batched
+  vector<PrimitiveBase*> primitives = CreatePrimitives(10 * numPrimitives, width, height);
+  PrimitiveBatch batch;
+  for (size_t i = 0; i < primitives.size(); i++)
+    batch.Add(*primitives[i]);
+  timer.Start();
+  for (int k = 0; k < numIterations; k++)
+    for (size_t i = 0; i < primitives.size(); i++)
+      primitives[i]->Draw(reference);
+  double serialMs = timer.GetElapsedMs() / numIterations;
+  cout << "Mixed primitives (" << primitives.size() << ", virtual Draw) : "
+       << serialMs << " ms" << endl;
+  int numThreads[2] = { 1, batch.GetNumThreads() };
+  for (int n = 0; n < 2; n++) {
+    batch.SetNumThreads(numThreads[n]);
+    timer.Start();
+    for (int k = 0; k < numIterations; k++)
+      batch.Draw(image);
+    double batchMs = timer.GetElapsedMs() / numIterations;
+    cout << "Mixed primitives (" << primitives.size() << ", PrimitiveBatch, "
+         << numThreads[n] << " threads) : " << batchMs << " ms (speedup "
+         << serialMs / batchMs << "x)" << endl;
+  }
+  for (size_t i = 0; i < primitives.size(); i++)
+    delete primitives[i];
+
+  return 0;
+}
@@ -0,0 +1,39 @@
+#ifndef __BenchmarkTimer_hh__
+#define __BenchmarkTimer_hh__
+
+#include <chrono>
+
+/** @class BenchmarkTimer
+    @brief Simple wall clock timer used by the benchmarks.
+ */
+class BenchmarkTimer
+{
+public:
+
+  /** @brief Create timer and start it. */
+  BenchmarkTimer()
+  {
+    Start();
+  }
+
+  /** @brief (Re-)start timer. */
+  void Start()
+  {
+    start_ = std::chrono::steady_clock::now();
+  }
+
+  /** @brief Returns elapsed time since last start in milliseconds. */
+  double GetElapsedMs() const
+  {
+    std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start_;
+    return elapsed.count();
+  }
+
+private:
+
+  std::chrono::steady_clock::time_point start_;
+
+};
+
+#endif // __BenchmarkTimer_hh__
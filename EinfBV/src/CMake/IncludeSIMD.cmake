@@ -0,0 +1,4 @@
+OPTION(USE_SIMD "Build with SIMD code paths (selected at runtime)" ON)
+IF(USE_SIMD)
+  ADD_DEFINITIONS(-DBUILD_WITH_SIMD)
+ENDIF()
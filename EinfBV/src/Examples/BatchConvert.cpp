@@ -0,0 +1,400 @@
+/** @file   BatchConvert.cpp
+    @brief  Tool converting many images to another color model and/or file
+            format in one process. Loading, converting and saving overlap in
+            a pipeline: a loader thread and a saver thread perform the file
+            I/O while worker threads convert the images, connected by
+            bounded queues which limit the number of images held in memory.
+    @see    ImageIO, ColorConversion
+*/
+
+#include <Graphics2D/Image.hh>
+#include <Graphics2D/ImageIO.hh>
+#include <Graphics2D/ColorConversion.hh>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdlib>
+#include <climits>
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <dirent.h>
+#  include <sys/stat.h>
+#endif
+
+using namespace std;
+
+/** @brief Image passed through the pipeline */
+struct Job
+{
+  string inputFilename, outputFilename;
+  Image image;
+  /** @brief Number of image bytes as loaded */
+  size_t numBytes;
+};
+
+/** @class JobQueue
+    @brief Bounded queue of jobs connecting two pipeline stages. Push()
+           blocks while the queue is full, Pop() blocks while it is empty
+           and returns false once the queue is closed and empty.
+ */
+class JobQueue
+{
+public:
+
+  JobQueue(size_t capacity) : capacity_(capacity), numOpen_(0) {}
+
+  /** @brief Register a producer, the queue is closed when all registered
+             producers called Close(). */
+  void Open()
+  {
+    lock_guard<mutex> lock(mutex_);
+    numOpen_++;
+  }
+
+  void Close()
+  {
+    lock_guard<mutex> lock(mutex_);
+    numOpen_--;
+    notEmpty_.notify_all();
+  }
+
+  void Push(Job &job)
+  {
+    unique_lock<mutex> lock(mutex_);
+    while (jobs_.size() >= capacity_)
+      notFull_.wait(lock);
+    jobs_.push_back(Job());
+    Job &back = jobs_.back();
+    back.inputFilename.swap(job.inputFilename);
+    back.outputFilename.swap(job.outputFilename);
+    back.image.Swap(job.image);
+    back.numBytes = job.numBytes;
+    notEmpty_.notify_one();
+  }
+
+  bool Pop(Job &job)
+  {
+    unique_lock<mutex> lock(mutex_);
+    while (jobs_.empty() && numOpen_ > 0)
+      notEmpty_.wait(lock);
+    if (jobs_.empty())
+      return false;
+    Job &front = jobs_.front();
+    job.inputFilename.swap(front.inputFilename);
+    job.outputFilename.swap(front.outputFilename);
+    job.image.Swap(front.image);
+    job.numBytes = front.numBytes;
+    jobs_.pop_front();
+    notFull_.notify_one();
+    return true;
+  }
+
+private:
+
+  size_t capacity_;
+  int numOpen_;
+  deque<Job> jobs_;
+  mutex mutex_;
+  condition_variable notEmpty_, notFull_;
+
+};
+
+/** @brief Statistics of the pipeline stages */
+struct Statistics
+{
+  Statistics() : numImages(0), numFailed(0), numBytes(0),
+                 loadMs(0.0), convertMs(0.0), saveMs(0.0) {}
+  int numImages, numFailed;
+  size_t numBytes;
+  double loadMs, convertMs, saveMs;
+  mutex lock;
+};
+
+typedef chrono::steady_clock Clock;
+
+static double ElapsedMs(Clock::time_point start)
+{
+  return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+/** @brief Returns if the path is a directory. */
+static bool IsDirectory(const string &path)
+{
+#ifdef _WIN32
+  DWORD attributes = GetFileAttributesA(path.c_str());
+  return attributes != INVALID_FILE_ATTRIBUTES &&
+         (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+#else
+  struct stat info;
+  return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+#endif
+}
+
+/** @brief Append the regular files of the directory in sorted order. */
+static void ListDirectory(const string &path, vector<string> &filenames)
+{
+  vector<string> names;
+#ifdef _WIN32
+  WIN32_FIND_DATAA data;
+  HANDLE handle = FindFirstFileA((path + "\\*").c_str(), &data);
+  if (handle != INVALID_HANDLE_VALUE) {
+    do {
+      if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+        names.push_back(data.cFileName);
+    } while (FindNextFileA(handle, &data));
+    FindClose(handle);
+  }
+#else
+  DIR *dir = opendir(path.c_str());
+  if (dir != NULL) {
+    while (struct dirent *entry = readdir(dir)) {
+      string name = entry->d_name;
+      if (name[0] != '.' && !IsDirectory(path + "/" + name))
+        names.push_back(name);
+    }
+    closedir(dir);
+  }
+#endif
+  sort(names.begin(), names.end());
+  for (size_t i = 0; i < names.size(); i++)
+    filenames.push_back(path + "/" + names[i]);
+}
+
+/** @brief Returns absolute path of an existing file or directory with
+           symbolic links resolved, or the path itself if this fails. */
+static string GetCanonicalPath(const string &path)
+{
+#ifdef _WIN32
+  char buffer[MAX_PATH];
+  if (GetFullPathNameA(path.c_str(), MAX_PATH, buffer, NULL) == 0)
+    return path;
+  return buffer;
+#else
+  char buffer[PATH_MAX];
+  if (realpath(path.c_str(), buffer) == NULL)
+    return path;
+  return buffer;
+#endif
+}
+
+/** @brief Returns name of output file in the output directory with the
+           file name of the input file and the given extension. */
+static string GetOutputFilename(const string &inputFilename,
+                                const string &outputDir, const string &extension)
+{
+  size_t slash = inputFilename.find_last_of("/\\");
+  string name = (slash == string::npos) ? inputFilename : inputFilename.substr(slash + 1);
+  size_t dot = name.find_last_of('.');
+  if (dot != string::npos)
+    name = name.substr(0, dot);
+  return outputDir + "/" + name + "." + extension;
+}
+
+/** @brief Convert 8-bit image to given color model in place. */
+static void ConvertImage(Image &image, Image &buffer, Image::ColorModel cm)
+{
+  if (image.GetPixelType() != Image::PT_UInt8)
+    ColorConversion::ConvertDepth(image, image, Image::PT_UInt8);
+  Image::ColorModel src = image.GetColorModel();
+  if (cm == Image::CM_None || cm == src)
+    return;
+  if (src == Image::CM_RGB)
+    (cm == Image::CM_Gray) ? ColorConversion::RGBToGray(image, buffer)
+                           : ColorConversion::RGBToHSV(image, buffer);
+  else if (src == Image::CM_HSV)
+    (cm == Image::CM_Gray) ? ColorConversion::HSVToGray(image, buffer)
+                           : ColorConversion::HSVToRGB(image, buffer);
+  else
+    (cm == Image::CM_RGB) ? ColorConversion::GrayToRGB(image, buffer)
+                          : ColorConversion::GrayToHSV(image, buffer);
+  image.Swap(buffer);
+}
+
+int main(int argc, char *argv[])
+{
+  // Read parameters
+  if (argc < 3) {
+    cout << "Usage: BatchConvert <input directory | list file | input images...> "
+         << "<output directory> [-c gray|rgb|hsv] [-e <extension>] "
+         << "[-t <threads>] [-q <queue size>]" << endl
+         << "       A list file (*.txt) contains one input image per line." << endl;
+    return 0;
+  }
+  vector<string> inputs;
+  string outputDir, extension = "ppm";
+  Image::ColorModel colorModel = Image::CM_None;
+  int numWorkers = 0, queueSize = 4;
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (arg == "-c" && i + 1 < argc) {
+      string cm = argv[++i];
+      colorModel = (cm == "gray") ? Image::CM_Gray
+                 : (cm == "rgb") ? Image::CM_RGB
+                 : (cm == "hsv") ? Image::CM_HSV : Image::CM_None;
+      if (colorModel == Image::CM_None) {
+        cerr << "Unknown color model " << cm << "!" << endl;
+        return -1;
+      }
+    } else if (arg == "-e" && i + 1 < argc) {
+      extension = argv[++i];
+    } else if (arg == "-t" && i + 1 < argc) {
+      numWorkers = atoi(argv[++i]);
+    } else if (arg == "-q" && i + 1 < argc) {
+      queueSize = max(1, atoi(argv[++i]));
+    } else {
+      inputs.push_back(arg);
+    }
+  }
+  if (inputs.size() < 2) {
+    cerr << "No input or output given!" << endl;
+    return -1;
+  }
+  outputDir = inputs.back();
+  inputs.pop_back();
+  if (!IsDirectory(outputDir)) {
+    cerr << "Output directory " << outputDir << " does not exist!" << endl;
+    return -1;
+  }
+  if (numWorkers <= 0)
+    numWorkers = max(1, (int)thread::hardware_concurrency());
+  cout << "-- BatchConvert --" << endl;
+
+  // Collect input files from directories, list files and arguments
+  vector<string> filenames;
+  for (size_t i = 0; i < inputs.size(); i++) {
+    const string &input = inputs[i];
+    if (IsDirectory(input)) {
+      ListDirectory(input, filenames);
+    } else if (input.size() > 4 && input.compare(input.size() - 4, 4, ".txt") == 0) {
+      ifstream list(input.c_str());
+      string line;
+      while (getline(list, line))
+        if (!line.empty() && line[0] != '#')
+          filenames.push_back(line);
+    } else {
+      filenames.push_back(input);
+    }
+  }
+  // Output files are named after the input files, so check that no two
+  // inputs are written to the same file and no input is overwritten while
+  // it may still be read
+  vector<string> outputFilenames(filenames.size());
+  map<string, size_t> inputIndex, outputIndex;
+  string canonicalDir = GetCanonicalPath(outputDir);
+  for (size_t i = 0; i < filenames.size(); i++) {
+    outputFilenames[i] = GetOutputFilename(filenames[i], outputDir, extension);
+    inputIndex[GetCanonicalPath(filenames[i])] = i;
+  }
+  for (size_t i = 0; i < filenames.size(); i++) {
+    string output = GetOutputFilename(filenames[i], canonicalDir, extension);
+    if (inputIndex.count(output)) {
+      cerr << "Output file " << outputFilenames[i] << " would overwrite input file "
+           << filenames[inputIndex[output]] << "!" << endl;
+      return -1;
+    }
+    if (outputIndex.count(output)) {
+      cerr << "Input files " << filenames[outputIndex[output]] << " and "
+           << filenames[i] << " would be written to the same output file "
+           << outputFilenames[i] << "!" << endl;
+      return -1;
+    }
+    outputIndex[output] = i;
+  }
+
+  cout << "Converting " << filenames.size() << " images with " << numWorkers
+       << " worker threads, queue size " << queueSize << endl;
+
+  // Workers convert whole images in parallel, so each conversion uses one
+  // thread only
+  ColorConversion::SetNumThreads(1);
+  JobQueue loaded(queueSize), converted(queueSize);
+  Statistics stats;
+  Clock::time_point start = Clock::now();
+
+  // Loader thread reads the files in order
+  loaded.Open();
+  thread loader([&]() {
+    Job job;
+    for (size_t i = 0; i < filenames.size(); i++) {
+      Clock::time_point t = Clock::now();
+      job.inputFilename = filenames[i];
+      job.outputFilename = outputFilenames[i];
+      bool success = ImageIO::Load(job.inputFilename, job.image);
+      job.numBytes = job.image.GetNumBytes();
+      double ms = ElapsedMs(t);
+      {
+        lock_guard<mutex> lock(stats.lock);
+        stats.loadMs += ms;
+        if (!success)
+          stats.numFailed++;
+      }
+      if (success)
+        loaded.Push(job);
+      else
+        cerr << "Failed to read image from file " << job.inputFilename << "!" << endl;
+    }
+    loaded.Close();
+  });
+
+  // Worker threads convert the images
+  vector<thread> workers;
+  for (int i = 0; i < numWorkers; i++) {
+    converted.Open();
+    workers.push_back(thread([&]() {
+      Job job;
+      Image buffer;
+      while (loaded.Pop(job)) {
+        Clock::time_point t = Clock::now();
+        ConvertImage(job.image, buffer, colorModel);
+        double ms = ElapsedMs(t);
+        {
+          lock_guard<mutex> lock(stats.lock);
+          stats.convertMs += ms;
+        }
+        converted.Push(job);
+      }
+      converted.Close();
+    }));
+  }
+
+  // Saver thread (this thread) writes the converted images
+  Job job;
+  while (converted.Pop(job)) {
+    Clock::time_point t = Clock::now();
+    bool success = ImageIO::Save(job.outputFilename, job.image);
+    job.image.Release();
+    lock_guard<mutex> lock(stats.lock);
+    stats.saveMs += ElapsedMs(t);
+    if (success) {
+      stats.numImages++;
+      stats.numBytes += job.numBytes;
+    } else {
+      stats.numFailed++;
+      cerr << "Failed to write image to file " << job.outputFilename << "!" << endl;
+    }
+  }
+  loader.join();
+  for (size_t i = 0; i < workers.size(); i++)
+    workers[i].join();
+  double totalMs = ElapsedMs(start);
+
+  // Report throughput and time spent in the pipeline stages
+  double seconds = 1e-3 * totalMs;
+  cout << "Converted " << stats.numImages << " images (" << stats.numFailed
+       << " failed) in " << totalMs << " ms: "
+       << (seconds > 0.0 ? stats.numImages / seconds : 0.0) << " images/s, "
+       << (seconds > 0.0 ? 1e-6 * stats.numBytes / seconds : 0.0) << " MB/s" << endl;
+  cout << "Busy time load " << stats.loadMs << " ms, convert " << stats.convertMs
+       << " ms (" << numWorkers << " threads), save " << stats.saveMs << " ms" << endl;
+  return (stats.numFailed == 0) ? 0 : -1;
+}
@@ -22,6 +22,13 @@ int main(int argc, char *argv[])
   string outputFilename = (argc > 2) ? argv[2] : "";
   cout << "-- ExampleImageIO --" << endl;
 
+  // Read image information from file header without loading pixel data
+  ImageIO::ImageInfo info;
+  if (ImageIO::ReadInfo(inputFilename, info)) {
+    cout << "File header specifies " << info.width << " x " << info.height
+         << " pixels and " << info.channels << " channels" << endl;
+  }
+
   // Load image from file
   Image image;
   if (!ImageIO::Load(inputFilename, image)) {
@@ -1,7 +1,7 @@
 /** @file   DrawCanvasGui.cpp
     @brief  GUI for drawing primitives onto a canvas and transforming
             them via rotation, translation, and scaling (exercise 4).
-    @see    PrimitiveBase, AffineTransform, DrawCanvasGui
+    @see    PrimitiveBase, PrimitiveBatch, AffineTransform, DrawCanvasGui
     @author esquivel
  */
 
@@ -12,6 +12,7 @@
 #include <Graphics2D/PrimitiveLine.hh>
 #include <Graphics2D/PrimitivePolygon.hh>
 #include <Graphics2D/PrimitiveRectangle.hh>
+#include <Graphics2D/PrimitiveBatch.hh>
 #include <iostream>
 #include <vector>
 
@@ -36,21 +37,21 @@ public:
       color_(Color::RED), drawMode_(DRAWMODE_Polygon)
   {
     // Create initial primitives
-    primitives_.push_back(new PrimitiveRectangle(Color::BLACK, Float2D(50, 0), Float2D(250, 200)));
-    primitives_.push_back(new PrimitiveLine(Color::RED, Float2D(100, 175), Float2D(100, 75)));
-    primitives_.push_back(new PrimitiveLine(Color::GREEN, Float2D(100, 75), Float2D(200, 75)));
-    primitives_.push_back(new PrimitiveLine(Color::BLUE, Float2D(200, 75), Float2D(200, 175)));
-    primitives_.push_back(new PrimitiveLine(Color::YELLOW, Float2D(200, 175), Float2D(100, 175)));
-    primitives_.push_back(new PrimitiveLine(Color::MAGENTA, Float2D(100, 175), Float2D(200, 75)));
-    primitives_.push_back(new PrimitiveLine(Color::CYAN, Float2D(200, 75), Float2D(150, 25)));
-    primitives_.push_back(new PrimitiveLine(Color::MAGENTA, Float2D(150, 25), Float2D(100, 75)));
-    primitives_.push_back(new PrimitiveLine(Color::CYAN, Float2D(100, 75), Float2D(200, 175)));
-    primitives_.push_back(new PrimitiveRectangle(Color::GREEN, Float2D(0, 175), Float2D(width, 200)));
+    primitives_.AddRectangle(Color::BLACK, Float2D(50, 0), Float2D(250, 200));
+    primitives_.AddLine(Color::RED, Float2D(100, 175), Float2D(100, 75));
+    primitives_.AddLine(Color::GREEN, Float2D(100, 75), Float2D(200, 75));
+    primitives_.AddLine(Color::BLUE, Float2D(200, 75), Float2D(200, 175));
+    primitives_.AddLine(Color::YELLOW, Float2D(200, 175), Float2D(100, 175));
+    primitives_.AddLine(Color::MAGENTA, Float2D(100, 175), Float2D(200, 75));
+    primitives_.AddLine(Color::CYAN, Float2D(200, 75), Float2D(150, 25));
+    primitives_.AddLine(Color::MAGENTA, Float2D(150, 25), Float2D(100, 75));
+    primitives_.AddLine(Color::CYAN, Float2D(100, 75), Float2D(200, 175));
+    primitives_.AddRectangle(Color::GREEN, Float2D(0, 175), Float2D(width, 200));
     vector<Float2D> points;
     points.push_back(Float2D(width/2, height/2));
     points.push_back(Float2D(width/2 - 50, height));
     points.push_back(Float2D(width/2 + 50, height));
-    primitives_.push_back(new PrimitivePolygon(Color::BLUE, points));
+    primitives_.AddPolygon(Color::BLUE, points);
 
     // Draw primitives into canvas image and update display
     DrawCanvas_();
@@ -58,9 +59,6 @@ public:
 
   virtual ~DrawCanvasGui()
   {
-    for (unsigned int i = 0; i < primitives_.size(); i++) {
-      delete primitives_[i];
-    }
   }
 
 protected:
@@ -79,9 +77,7 @@ protected:
     // Clear canvas image with background color
     canvas_.Clear(Color::WHITE);
     // Draw all primitives painted so far
-    for (unsigned int i = 0; i < primitives_.size(); i++) {
-      primitives_[i]->Draw(canvas_);
-    }
+    primitives_.Draw(canvas_);
     // Draw currently selected vertices
     Color vertexColor(192, 128, 0);
     for (unsigned int i = 0; i < vertices_.size(); i++) {
@@ -108,15 +104,15 @@ protected:
         Quit();
       } else if (key == 'd' || key == 'D') {
         // Delete all painted primitives with D key
-        if (!primitives_.empty()) {
-          primitives_.clear();
+        if (!primitives_.IsEmpty()) {
+          primitives_.Clear();
           DrawCanvas_();
           cout << "Deleted all primitives from canvas" << endl;
         }
       } else if (key == 'u' || key == 'U') {
         // Undo last painted primitives with U key
-        if (!primitives_.empty()) {
-          primitives_.pop_back();
+        if (!primitives_.IsEmpty()) {
+          primitives_.RemoveLast();
           DrawCanvas_();
           cout << "Deleted most recent primitive from canvas" << endl;
         }
@@ -173,36 +169,30 @@ protected:
            ty = 16.0f;
          AffineTransform T;
          T.MakeTranslation(tx, ty);
-         for (unsigned int i = 0; i < primitives_.size(); i++) {
-           primitives_[i]->ApplyTransform(T);
-         }
+         primitives_.ApplyTransform(T);
          DrawCanvas_();
        } else if (key == GUI_KEY_PGUP || key == GUI_KEY_PGDOWN) {
         // Rotate all primitives by 6 degree around canvas center with page up/down key
-        if (!primitives_.empty()) {
+        if (!primitives_.IsEmpty()) {
           float degree = (key == GUI_KEY_PGUP) ? -6.0f : 6.0f;
           AffineTransform T, T1, T2, T3;
           T1.MakeTranslation(-0.5f * canvas_.GetWidth(), -0.5f * canvas_.GetHeight());
           T2.MakeRotation(degree * (float)M_PI / 180.0f);
           T3.MakeTranslation(0.5f * canvas_.GetWidth(), 0.5f * canvas_.GetHeight());
           T = AffineTransform::Concatenate(T3, AffineTransform::Concatenate(T2, T1));
-          for (unsigned int i = 0; i < primitives_.size(); i++) {
-            primitives_[i]->ApplyTransform(T);
-          }
+          primitives_.ApplyTransform(T);
           DrawCanvas_();
         }
       } else if (key == '+' || key == '-') {
         // Scale all primitives by 110% or 90% w.r.t. canvas center with keys + and -
-        if (!primitives_.empty()) {
+        if (!primitives_.IsEmpty()) {
           float scale = (key == '+') ? 1.1f : 0.9f;
           AffineTransform T, T1, T2, T3;
           T1.MakeTranslation(-0.5f * canvas_.GetWidth(), -0.5f * canvas_.GetHeight());
           T2.MakeScaling(scale, scale);
           T3.MakeTranslation(0.5f * canvas_.GetWidth(), 0.5f * canvas_.GetHeight());
           T = AffineTransform::Concatenate(T3, AffineTransform::Concatenate(T2, T1));
-          for (unsigned int i = 0; i < primitives_.size(); i++) {
-            primitives_[i]->ApplyTransform(T);
-          }
+          primitives_.ApplyTransform(T);
           DrawCanvas_();
         }
       }
@@ -222,7 +212,7 @@ protected:
         case DRAWMODE_Point:
         {
           // Create point primitive from clicked point
-          primitives_.push_back(new PrimitivePoint(color_, Float2D(x, y)));
+          primitives_.AddPoint(color_, Float2D(x, y));
           break;
         }
         case DRAWMODE_Line:
@@ -231,7 +221,7 @@ protected:
           if (vertices_.empty()) {
             vertices_.push_back(Float2D(x, y));
           } else {
-            primitives_.push_back(new PrimitiveLine(color_, vertices_[0], Float2D(x, y)));
+            primitives_.AddLine(color_, vertices_[0], Float2D(x, y));
             vertices_.clear();
           }
           break;
@@ -243,7 +233,7 @@ protected:
             vertices_.push_back(Float2D(x, y));
           } else if (abs((int)vertices_[0][0] - x) <= 4 && abs((int)vertices_[0][1] - y) <= 4) {
             // Create polygon if mouse click appeared close to the first vertex
-            primitives_.push_back(new PrimitivePolygon(color_, vertices_));
+            primitives_.AddPolygon(color_, vertices_);
             vertices_.clear();
           } else {
             // Add clicked point to selected vertices otherwise
@@ -257,7 +247,7 @@ protected:
           if (vertices_.empty()) {
             vertices_.push_back(Float2D(x, y));
           } else {
-            primitives_.push_back(new PrimitiveRectangle(color_, vertices_[0], Float2D(x, y)));
+            primitives_.AddRectangle(color_, vertices_[0], Float2D(x, y));
             vertices_.clear();
           }
           break;
@@ -281,7 +271,7 @@ private:
   /** @brief Stores currently selected vertices */
   vector<Float2D> vertices_;
   /** @brief Stores primitives painted onto the canvas */
-  vector<PrimitiveBase*> primitives_;
+  PrimitiveBatch primitives_;
   /** @brief Image used as canvas to display in window */
   Image canvas_;
   /** @brief Currently selected color for drawing */
@@ -1,44 +1,1366 @@
 #include "ColorConversion.hh"
+#include "CpuFeatures.hh"
 #include <iostream>
 #include <cmath>
+#include <cstring>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <system_error>
+
+#ifdef SIMD_X86
+#  include <immintrin.h>
+#endif
 
 using namespace std;
 
+namespace {
+
+/* ---------------------------------------------------------------------
+   Scalar row functions, reference for all SIMD implementations
+   --------------------------------------------------------------------- */
+
+void RGBToGrayScalar(const unsigned char *src, unsigned char *dst, int width)
+{
+  for (int x = 0; x < width; x++, src += 3)
+    dst[x] = (unsigned char)((77 * src[0] + 150 * src[1] + 29 * src[2] + 128) >> 8);
+}
+
+void GrayToRGBScalar(const unsigned char *src, unsigned char *dst, int width)
+{
+  for (int x = 0; x < width; x++, dst += 3)
+    dst[0] = dst[1] = dst[2] = src[x];
+}
+
+void RGBToHSVScalar(const unsigned char *src, unsigned char *dst, int width)
+{
+  for (int x = 0; x < width; x++, src += 3, dst += 3) {
+    int r = src[0], g = src[1], b = src[2];
+    int max = r > g ? (r > b ? r : b) : (g > b ? g : b);
+    int min = r < g ? (r < b ? r : b) : (g < b ? g : b);
+    int delta = max - min;
+    // Hue in sixths of delta, measured from red, green or blue
+    int num;
+    if (max == r)
+      num = g - b;
+    else if (max == g)
+      num = b - r + 2 * delta;
+    else
+      num = r - g + 4 * delta;
+    if (num < 0)
+      num += 6 * delta;
+    dst[0] = (unsigned char)(255 * num / (delta > 0 ? 6 * delta : 1));
+    dst[1] = (unsigned char)(255 * delta / (max > 0 ? max : 1));
+    dst[2] = (unsigned char)max;
+  }
+}
+
+/** Convert one pixel from HSV to RGB. */
+inline void HSVToRGBPixel(int h, int s, int v, int &r, int &g, int &b)
+{
+  // Sector i and fraction f (in 1/255) of the hue
+  int i = h * 6 / 255, f = h * 6 - i * 255;
+  if (i == 6)
+    i = 0;
+  int p = (v * (255 - s) + 127) / 255;
+  int q = (v * (65025 - s * f) + 32512) / 65025;
+  int t = (v * (65025 - s * (255 - f)) + 32512) / 65025;
+  switch (i) {
+    case 0: r = v; g = t; b = p; break;
+    case 1: r = q; g = v; b = p; break;
+    case 2: r = p; g = v; b = t; break;
+    case 3: r = p; g = q; b = v; break;
+    case 4: r = t; g = p; b = v; break;
+    default: r = v; g = p; b = q; break;
+  }
+}
+
+void HSVToRGBScalar(const unsigned char *src, unsigned char *dst, int width)
+{
+  for (int x = 0; x < width; x++, src += 3, dst += 3) {
+    int r, g, b;
+    HSVToRGBPixel(src[0], src[1], src[2], r, g, b);
+    dst[0] = (unsigned char)r;
+    dst[1] = (unsigned char)g;
+    dst[2] = (unsigned char)b;
+  }
+}
+
+void HSVToGrayScalar(const unsigned char *src, unsigned char *dst, int width)
+{
+  for (int x = 0; x < width; x++, src += 3) {
+    int r, g, b;
+    HSVToRGBPixel(src[0], src[1], src[2], r, g, b);
+    dst[x] = (unsigned char)((77 * r + 150 * g + 29 * b + 128) >> 8);
+  }
+}
+
+/** Gray values have zero hue and saturation. */
+void GrayToHSVScalar(const unsigned char *src, unsigned char *dst, int width)
+{
+  for (int x = 0; x < width; x++, dst += 3) {
+    dst[0] = dst[1] = 0;
+    dst[2] = src[x];
+  }
+}
+
+void InterleaveScalar(const unsigned char *p0, const unsigned char *p1,
+                      const unsigned char *p2, unsigned char *dst, int width)
+{
+  for (int x = 0; x < width; x++, dst += 3) {
+    dst[0] = p0[x];
+    dst[1] = p1[x];
+    dst[2] = p2[x];
+  }
+}
+
+void DeinterleaveScalar(const unsigned char *src, unsigned char *p0,
+                        unsigned char *p1, unsigned char *p2, int width)
+{
+  for (int x = 0; x < width; x++, src += 3) {
+    p0[x] = src[0];
+    p1[x] = src[1];
+    p2[x] = src[2];
+  }
+}
+
+/* Depth conversions of count values, see Image::UInt8ToUInt16() etc. */
+
+void UInt8ToUInt16Scalar(const unsigned char *src, unsigned char *dst, int count)
+{
+  unsigned short *d = (unsigned short *)dst;
+  for (int i = 0; i < count; i++)
+    d[i] = Image::UInt8ToUInt16(src[i]);
+}
+
+void UInt16ToUInt8Scalar(const unsigned char *src, unsigned char *dst, int count)
+{
+  const unsigned short *s = (const unsigned short *)src;
+  for (int i = 0; i < count; i++)
+    dst[i] = Image::UInt16ToUInt8(s[i]);
+}
+
+void UInt8ToFloatScalar(const unsigned char *src, unsigned char *dst, int count)
+{
+  float *d = (float *)dst;
+  for (int i = 0; i < count; i++)
+    d[i] = Image::UInt8ToFloat(src[i]);
+}
+
+void FloatToUInt8Scalar(const unsigned char *src, unsigned char *dst, int count)
+{
+  const float *s = (const float *)src;
+  for (int i = 0; i < count; i++)
+    dst[i] = Image::FloatToUInt8(s[i]);
+}
+
+void UInt16ToFloatScalar(const unsigned char *src, unsigned char *dst, int count)
+{
+  const unsigned short *s = (const unsigned short *)src;
+  float *d = (float *)dst;
+  for (int i = 0; i < count; i++)
+    d[i] = Image::UInt16ToFloat(s[i]);
+}
+
+void FloatToUInt16Scalar(const unsigned char *src, unsigned char *dst, int count)
+{
+  const float *s = (const float *)src;
+  unsigned short *d = (unsigned short *)dst;
+  for (int i = 0; i < count; i++)
+    d[i] = Image::FloatToUInt16(s[i]);
+}
+
+#ifdef SIMD_X86
+
+/* ---------------------------------------------------------------------
+   SIMD row functions, identical results as scalar row functions
+
+   Pixels are processed in blocks of 16 (SSSE3) or 32 (AVX2) pixels, the
+   remaining pixels of a row with the scalar row functions. Three channel
+   blocks are split into channels with byte shuffles, where AVX2 processes
+   two blocks of 16 pixels in its two 128 bit lanes. Arithmetic is done in
+   16 bit integers, divisions in float which is exact for these ranges.
+   --------------------------------------------------------------------- */
+
+/** Shuffle masks to gather channel c from register j of 48 bytes RGB data,
+    stored at index 3 * c + j. */
+const signed char DEINTERLEAVE_MASKS[9][16] = {
+  {  0,  3,  6,  9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+  { -1, -1, -1, -1, -1, -1,  2,  5,  8, 11, 14, -1, -1, -1, -1, -1 },
+  { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  1,  4,  7, 10, 13 },
+  {  1,  4,  7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+  { -1, -1, -1, -1, -1,  0,  3,  6,  9, 12, 15, -1, -1, -1, -1, -1 },
+  { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  2,  5,  8, 11, 14 },
+  {  2,  5,  8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+  { -1, -1, -1, -1, -1,  1,  4,  7, 10, 13, -1, -1, -1, -1, -1, -1 },
+  { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  3,  6,  9, 12, 15 }
+};
+
+/** Shuffle masks to scatter channel c to register j of 48 bytes RGB data,
+    stored at index 3 * j + c. */
+const signed char INTERLEAVE_MASKS[9][16] = {
+  {  0, -1, -1,  1, -1, -1,  2, -1, -1,  3, -1, -1,  4, -1, -1,  5 },
+  { -1,  0, -1, -1,  1, -1, -1,  2, -1, -1,  3, -1, -1,  4, -1, -1 },
+  { -1, -1,  0, -1, -1,  1, -1, -1,  2, -1, -1,  3, -1, -1,  4, -1 },
+  { -1, -1,  6, -1, -1,  7, -1, -1,  8, -1, -1,  9, -1, -1, 10, -1 },
+  {  5, -1, -1,  6, -1, -1,  7, -1, -1,  8, -1, -1,  9, -1, -1, 10 },
+  { -1,  5, -1, -1,  6, -1, -1,  7, -1, -1,  8, -1, -1,  9, -1, -1 },
+  { -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1 },
+  { -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1 },
+  { 10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15 }
+};
+
+/** Shuffle masks to replicate 16 gray values to register j of 48 bytes
+    RGB data. */
+const signed char REPLICATE_MASKS[3][16] = {
+  {  0,  0,  0,  1,  1,  1,  2,  2,  2,  3,  3,  3,  4,  4,  4,  5 },
+  {  5,  5,  6,  6,  6,  7,  7,  7,  8,  8,  8,  9,  9,  9, 10, 10 },
+  { 10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15 }
+};
+
+/* SSSE3 ------------------------------------------------------------- */
+
+/** Load 16 pixels of RGB data and split into channels. */
+SIMD_TARGET_SSSE3 inline void Load3SSSE3(const unsigned char *src,
+                                         const __m128i *masks, __m128i *c)
+{
+  __m128i a = _mm_loadu_si128((const __m128i *)src);
+  __m128i b = _mm_loadu_si128((const __m128i *)(src + 16));
+  __m128i d = _mm_loadu_si128((const __m128i *)(src + 32));
+  for (int i = 0; i < 3; i++)
+    c[i] = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, masks[3 * i]),
+                                     _mm_shuffle_epi8(b, masks[3 * i + 1])),
+                        _mm_shuffle_epi8(d, masks[3 * i + 2]));
+}
+
+/** Merge channels of 16 pixels and store as RGB data. */
+SIMD_TARGET_SSSE3 inline void Store3SSSE3(unsigned char *dst,
+                                          const __m128i *masks, const __m128i *c)
+{
+  for (int j = 0; j < 3; j++)
+    _mm_storeu_si128((__m128i *)(dst + 16 * j),
+      _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(c[0], masks[3 * j]),
+                                _mm_shuffle_epi8(c[1], masks[3 * j + 1])),
+                   _mm_shuffle_epi8(c[2], masks[3 * j + 2])));
+}
+
+/** Load shuffle masks into registers. */
+SIMD_TARGET_SSSE3 inline void LoadMasksSSSE3(const signed char (*table)[16],
+                                             int count, __m128i *masks)
+{
+  for (int i = 0; i < count; i++)
+    masks[i] = _mm_loadu_si128((const __m128i *)table[i]);
+}
+
+/** Returns floor(255 * a / b) for 16 bit values 0 <= a <= 1530, 1 <= b. */
+SIMD_TARGET_SSSE3 inline __m128i ScaledDivideSSSE3(__m128i a, __m128i b)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128 scale = _mm_set1_ps(255.0f);
+  __m128 aLo = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(a, zero)), scale);
+  __m128 aHi = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(a, zero)), scale);
+  __m128 bLo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(b, zero));
+  __m128 bHi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(b, zero));
+  return _mm_packs_epi32(_mm_cvttps_epi32(_mm_div_ps(aLo, bLo)),
+                         _mm_cvttps_epi32(_mm_div_ps(aHi, bHi)));
+}
+
+/** Returns (v * w + 32512) / 65025 for 16 bit values v <= 255, w <= 65025. */
+SIMD_TARGET_SSSE3 inline __m128i Divide65025SSSE3(__m128i v, __m128i w)
+{
+  const __m128i round = _mm_set1_epi32(32512);
+  const __m128 scale = _mm_set1_ps(65025.0f);
+  __m128i lo = _mm_mullo_epi16(v, w), hi = _mm_mulhi_epu16(v, w);
+  __m128i pLo = _mm_add_epi32(_mm_unpacklo_epi16(lo, hi), round);
+  __m128i pHi = _mm_add_epi32(_mm_unpackhi_epi16(lo, hi), round);
+  return _mm_packs_epi32(_mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(pLo), scale)),
+                         _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(pHi), scale)));
+}
+
+/** Returns floor(y / 255) for unsigned 16 bit values y < 65535. */
+SIMD_TARGET_SSSE3 inline __m128i Divide255SSSE3(__m128i y)
+{
+  y = _mm_add_epi16(y, _mm_add_epi16(_mm_set1_epi16(1), _mm_srli_epi16(y, 8)));
+  return _mm_srli_epi16(y, 8);
+}
+
+/** Compute gray values of 8 pixels with 16 bit channels. */
+SIMD_TARGET_SSSE3 inline __m128i GraySSSE3(__m128i r, __m128i g, __m128i b)
+{
+  __m128i sum = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(77)),
+                              _mm_mullo_epi16(g, _mm_set1_epi16(150)));
+  sum = _mm_add_epi16(sum, _mm_mullo_epi16(b, _mm_set1_epi16(29)));
+  return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(128)), 8);
+}
+
+/** Convert 8 pixels with 16 bit channels from RGB to HSV. */
+SIMD_TARGET_SSSE3 inline void RGBToHSVBlockSSSE3(const __m128i *rgb, __m128i *hsv)
+{
+  const __m128i zero = _mm_setzero_si128(), one = _mm_set1_epi16(1);
+  __m128i r = rgb[0], g = rgb[1], b = rgb[2];
+  __m128i max = _mm_max_epi16(r, _mm_max_epi16(g, b));
+  __m128i min = _mm_min_epi16(r, _mm_min_epi16(g, b));
+  __m128i delta = _mm_sub_epi16(max, min), delta2 = _mm_add_epi16(delta, delta);
+  __m128i isR = _mm_cmpeq_epi16(max, r);
+  __m128i isG = _mm_andnot_si128(isR, _mm_cmpeq_epi16(max, g));
+  __m128i isB = _mm_andnot_si128(_mm_or_si128(isR, isG), _mm_cmpeq_epi16(zero, zero));
+  __m128i num = _mm_or_si128(
+    _mm_or_si128(_mm_and_si128(isR, _mm_sub_epi16(g, b)),
+                 _mm_and_si128(isG, _mm_add_epi16(_mm_sub_epi16(b, r), delta2))),
+    _mm_and_si128(isB, _mm_add_epi16(_mm_sub_epi16(r, g), _mm_add_epi16(delta2, delta2))));
+  __m128i delta6 = _mm_add_epi16(delta2, _mm_add_epi16(delta2, delta2));
+  num = _mm_add_epi16(num, _mm_and_si128(_mm_cmplt_epi16(num, zero), delta6));
+  hsv[0] = ScaledDivideSSSE3(num, _mm_max_epi16(delta6, one));
+  hsv[1] = ScaledDivideSSSE3(delta, _mm_max_epi16(max, one));
+  hsv[2] = max;
+}
+
+/** Convert 8 pixels with 16 bit channels from HSV to RGB. */
+SIMD_TARGET_SSSE3 inline void HSVToRGBBlockSSSE3(const __m128i *hsv, __m128i *rgb)
+{
+  const __m128i c255 = _mm_set1_epi16(255), c65025 = _mm_set1_epi16((short)65025);
+  __m128i h = hsv[0], s = hsv[1], v = hsv[2];
+  // Sector i and fraction f, sector 6 equals sector 0
+  __m128i h6 = _mm_mullo_epi16(h, _mm_set1_epi16(6));
+  __m128i i = Divide255SSSE3(h6);
+  __m128i f = _mm_sub_epi16(h6, _mm_mullo_epi16(i, c255));
+  i = _mm_sub_epi16(i, _mm_and_si128(_mm_cmpeq_epi16(i, _mm_set1_epi16(6)), _mm_set1_epi16(6)));
+  __m128i p = Divide255SSSE3(_mm_add_epi16(_mm_mullo_epi16(v, _mm_sub_epi16(c255, s)),
+                                           _mm_set1_epi16(127)));
+  __m128i q = Divide65025SSSE3(v, _mm_sub_epi16(c65025, _mm_mullo_epi16(s, f)));
+  __m128i t = Divide65025SSSE3(v, _mm_sub_epi16(c65025,
+                                                _mm_mullo_epi16(s, _mm_sub_epi16(c255, f))));
+  __m128i m[6];
+  for (int k = 0; k < 6; k++)
+    m[k] = _mm_cmpeq_epi16(i, _mm_set1_epi16((short)k));
+  rgb[0] = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_or_si128(m[0], m[5]), v),
+                                     _mm_and_si128(m[1], q)),
+                        _mm_or_si128(_mm_and_si128(_mm_or_si128(m[2], m[3]), p),
+                                     _mm_and_si128(m[4], t)));
+  rgb[1] = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_or_si128(m[1], m[2]), v),
+                                     _mm_and_si128(m[0], t)),
+                        _mm_or_si128(_mm_and_si128(_mm_or_si128(m[4], m[5]), p),
+                                     _mm_and_si128(m[3], q)));
+  rgb[2] = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_or_si128(m[3], m[4]), v),
+                                     _mm_and_si128(m[2], t)),
+                        _mm_or_si128(_mm_and_si128(_mm_or_si128(m[0], m[1]), p),
+                                     _mm_and_si128(m[5], q)));
+}
+
+/** Apply function on 8 pixels with 16 bit channels to 16 pixels with 8 bit
+    channels. */
+template <void (*Function)(const __m128i *, __m128i *)>
+SIMD_TARGET_SSSE3 inline void Apply3SSSE3(const __m128i *src, __m128i *dst)
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i lo[3], hi[3], resultLo[3], resultHi[3];
+  for (int c = 0; c < 3; c++) {
+    lo[c] = _mm_unpacklo_epi8(src[c], zero);
+    hi[c] = _mm_unpackhi_epi8(src[c], zero);
+  }
+  Function(lo, resultLo);
+  Function(hi, resultHi);
+  for (int c = 0; c < 3; c++)
+    dst[c] = _mm_packus_epi16(resultLo[c], resultHi[c]);
+}
+
+SIMD_TARGET_SSSE3 void RGBToGraySSSE3(const unsigned char *src, unsigned char *dst, int width)
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i masks[9], c[3];
+  LoadMasksSSSE3(DEINTERLEAVE_MASKS, 9, masks);
+  int x = 0;
+  for (; x + 16 <= width; x += 16, src += 48) {
+    Load3SSSE3(src, masks, c);
+    __m128i lo = GraySSSE3(_mm_unpacklo_epi8(c[0], zero), _mm_unpacklo_epi8(c[1], zero),
+                           _mm_unpacklo_epi8(c[2], zero));
+    __m128i hi = GraySSSE3(_mm_unpackhi_epi8(c[0], zero), _mm_unpackhi_epi8(c[1], zero),
+                           _mm_unpackhi_epi8(c[2], zero));
+    _mm_storeu_si128((__m128i *)(dst + x), _mm_packus_epi16(lo, hi));
+  }
+  RGBToGrayScalar(src, dst + x, width - x);
+}
+
+SIMD_TARGET_SSSE3 void GrayToRGBSSSE3(const unsigned char *src, unsigned char *dst, int width)
+{
+  __m128i masks[3];
+  LoadMasksSSSE3(REPLICATE_MASKS, 3, masks);
+  int x = 0;
+  for (; x + 16 <= width; x += 16, dst += 48) {
+    __m128i gray = _mm_loadu_si128((const __m128i *)(src + x));
+    for (int j = 0; j < 3; j++)
+      _mm_storeu_si128((__m128i *)(dst + 16 * j), _mm_shuffle_epi8(gray, masks[j]));
+  }
+  GrayToRGBScalar(src + x, dst, width - x);
+}
+
+SIMD_TARGET_SSSE3 void RGBToHSVSSSE3(const unsigned char *src, unsigned char *dst, int width)
+{
+  __m128i loadMasks[9], storeMasks[9], rgb[3], hsv[3];
+  LoadMasksSSSE3(DEINTERLEAVE_MASKS, 9, loadMasks);
+  LoadMasksSSSE3(INTERLEAVE_MASKS, 9, storeMasks);
+  int x = 0;
+  for (; x + 16 <= width; x += 16, src += 48, dst += 48) {
+    Load3SSSE3(src, loadMasks, rgb);
+    Apply3SSSE3<RGBToHSVBlockSSSE3>(rgb, hsv);
+    Store3SSSE3(dst, storeMasks, hsv);
+  }
+  RGBToHSVScalar(src, dst, width - x);
+}
+
+SIMD_TARGET_SSSE3 void HSVToRGBSSSE3(const unsigned char *src, unsigned char *dst, int width)
+{
+  __m128i loadMasks[9], storeMasks[9], rgb[3], hsv[3];
+  LoadMasksSSSE3(DEINTERLEAVE_MASKS, 9, loadMasks);
+  LoadMasksSSSE3(INTERLEAVE_MASKS, 9, storeMasks);
+  int x = 0;
+  for (; x + 16 <= width; x += 16, src += 48, dst += 48) {
+    Load3SSSE3(src, loadMasks, hsv);
+    Apply3SSSE3<HSVToRGBBlockSSSE3>(hsv, rgb);
+    Store3SSSE3(dst, storeMasks, rgb);
+  }
+  HSVToRGBScalar(src, dst, width - x);
+}
+
+SIMD_TARGET_SSSE3 void HSVToGraySSSE3(const unsigned char *src, unsigned char *dst, int width)
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i masks[9], hsv[3], lo[3], hi[3], rgb[3];
+  LoadMasksSSSE3(DEINTERLEAVE_MASKS, 9, masks);
+  int x = 0;
+  for (; x + 16 <= width; x += 16, src += 48) {
+    Load3SSSE3(src, masks, hsv);
+    for (int c = 0; c < 3; c++) {
+      lo[c] = _mm_unpacklo_epi8(hsv[c], zero);
+      hi[c] = _mm_unpackhi_epi8(hsv[c], zero);
+    }
+    HSVToRGBBlockSSSE3(lo, rgb);
+    lo[0] = GraySSSE3(rgb[0], rgb[1], rgb[2]);
+    HSVToRGBBlockSSSE3(hi, rgb);
+    hi[0] = GraySSSE3(rgb[0], rgb[1], rgb[2]);
+    _mm_storeu_si128((__m128i *)(dst + x), _mm_packus_epi16(lo[0], hi[0]));
+  }
+  HSVToGrayScalar(src, dst + x, width - x);
+}
+
+SIMD_TARGET_SSSE3 void GrayToHSVSSSE3(const unsigned char *src, unsigned char *dst, int width)
+{
+  __m128i masks[9], hsv[3];
+  LoadMasksSSSE3(INTERLEAVE_MASKS, 9, masks);
+  hsv[0] = hsv[1] = _mm_setzero_si128();
+  int x = 0;
+  for (; x + 16 <= width; x += 16, dst += 48) {
+    hsv[2] = _mm_loadu_si128((const __m128i *)(src + x));
+    Store3SSSE3(dst, masks, hsv);
+  }
+  GrayToHSVScalar(src + x, dst, width - x);
+}
+
+SIMD_TARGET_SSSE3 void InterleaveSSSE3(const unsigned char *p0, const unsigned char *p1,
+                                  const unsigned char *p2, unsigned char *dst, int width)
+{
+  __m128i masks[9], c[3];
+  LoadMasksSSSE3(INTERLEAVE_MASKS, 9, masks);
+  int x = 0;
+  for (; x + 16 <= width; x += 16, dst += 48) {
+    c[0] = _mm_loadu_si128((const __m128i *)(p0 + x));
+    c[1] = _mm_loadu_si128((const __m128i *)(p1 + x));
+    c[2] = _mm_loadu_si128((const __m128i *)(p2 + x));
+    Store3SSSE3(dst, masks, c);
+  }
+  InterleaveScalar(p0 + x, p1 + x, p2 + x, dst, width - x);
+}
+
+SIMD_TARGET_SSSE3 void DeinterleaveSSSE3(const unsigned char *src, unsigned char *p0,
+                                    unsigned char *p1, unsigned char *p2, int width)
+{
+  __m128i masks[9], c[3];
+  LoadMasksSSSE3(DEINTERLEAVE_MASKS, 9, masks);
+  int x = 0;
+  for (; x + 16 <= width; x += 16, src += 48) {
+    Load3SSSE3(src, masks, c);
+    _mm_storeu_si128((__m128i *)(p0 + x), c[0]);
+    _mm_storeu_si128((__m128i *)(p1 + x), c[1]);
+    _mm_storeu_si128((__m128i *)(p2 + x), c[2]);
+  }
+  DeinterleaveScalar(src, p0 + x, p1 + x, p2 + x, width - x);
+}
+
+/** Round 16 bit values to 8 bit values as (v + 128) / 257, computed as
+    (t - (t >> 8)) >> 8 with t = v + 128 saturated to 65535. */
+SIMD_TARGET_SSSE3 inline __m128i Round16To8SSSE3(__m128i v)
+{
+  __m128i t = _mm_adds_epu16(v, _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_sub_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+/** Saturate floats to [0, 1] (NaN to 0), scale and round to integers. */
+SIMD_TARGET_SSSE3 inline __m128i ScaleFloatSSSE3(__m128 v, __m128 scale)
+{
+  v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+  return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, scale), _mm_set1_ps(0.5f)));
+}
+
+SIMD_TARGET_SSSE3 void UInt8ToUInt16SSSE3(const unsigned char *src, unsigned char *dst, int count)
+{
+  int i = 0;
+  for (; i + 16 <= count; i += 16, dst += 32) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+    _mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi8(v, v));
+    _mm_storeu_si128((__m128i *)(dst + 16), _mm_unpackhi_epi8(v, v));
+  }
+  UInt8ToUInt16Scalar(src + i, dst, count - i);
+}
+
+SIMD_TARGET_SSSE3 void UInt16ToUInt8SSSE3(const unsigned char *src, unsigned char *dst, int count)
+{
+  int i = 0;
+  for (; i + 16 <= count; i += 16, src += 32) {
+    __m128i a = Round16To8SSSE3(_mm_loadu_si128((const __m128i *)src));
+    __m128i b = Round16To8SSSE3(_mm_loadu_si128((const __m128i *)(src + 16)));
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(a, b));
+  }
+  UInt16ToUInt8Scalar(src, dst + i, count - i);
+}
+
+SIMD_TARGET_SSSE3 void UInt8ToFloatSSSE3(const unsigned char *src, unsigned char *dst, int count)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128 scale = _mm_set1_ps(255.0f);
+  float *d = (float *)dst;
+  int i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+    __m128i w[2] = { _mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero) };
+    for (int j = 0; j < 2; j++) {
+      __m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(w[j], zero));
+      __m128 hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(w[j], zero));
+      _mm_storeu_ps(d + i + 8 * j, _mm_div_ps(lo, scale));
+      _mm_storeu_ps(d + i + 8 * j + 4, _mm_div_ps(hi, scale));
+    }
+  }
+  UInt8ToFloatScalar(src + i, (unsigned char *)(d + i), count - i);
+}
+
+SIMD_TARGET_SSSE3 void FloatToUInt8SSSE3(const unsigned char *src, unsigned char *dst, int count)
+{
+  const __m128 scale = _mm_set1_ps(255.0f);
+  const float *s = (const float *)src;
+  int i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i v[4];
+    for (int j = 0; j < 4; j++)
+      v[j] = ScaleFloatSSSE3(_mm_loadu_ps(s + i + 4 * j), scale);
+    __m128i a = _mm_packs_epi32(v[0], v[1]), b = _mm_packs_epi32(v[2], v[3]);
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(a, b));
+  }
+  FloatToUInt8Scalar((const unsigned char *)(s + i), dst + i, count - i);
+}
+
+SIMD_TARGET_SSSE3 void UInt16ToFloatSSSE3(const unsigned char *src, unsigned char *dst, int count)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128 scale = _mm_set1_ps(65535.0f);
+  const unsigned short *s = (const unsigned short *)src;
+  float *d = (float *)dst;
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+    __m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero));
+    __m128 hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero));
+    _mm_storeu_ps(d + i, _mm_div_ps(lo, scale));
+    _mm_storeu_ps(d + i + 4, _mm_div_ps(hi, scale));
+  }
+  UInt16ToFloatScalar((const unsigned char *)(s + i), (unsigned char *)(d + i), count - i);
+}
+
+SIMD_TARGET_SSSE3 void FloatToUInt16SSSE3(const unsigned char *src, unsigned char *dst, int count)
+{
+  // Signed saturation only, so values are packed with an offset of 32768
+  const __m128 scale = _mm_set1_ps(65535.0f);
+  const __m128i offset = _mm_set1_epi32(32768), sign = _mm_set1_epi16((short)0x8000);
+  const float *s = (const float *)src;
+  unsigned short *d = (unsigned short *)dst;
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i a = _mm_sub_epi32(ScaleFloatSSSE3(_mm_loadu_ps(s + i), scale), offset);
+    __m128i b = _mm_sub_epi32(ScaleFloatSSSE3(_mm_loadu_ps(s + i + 4), scale), offset);
+    _mm_storeu_si128((__m128i *)(d + i), _mm_xor_si128(_mm_packs_epi32(a, b), sign));
+  }
+  FloatToUInt16Scalar((const unsigned char *)(s + i), (unsigned char *)(d + i), count - i);
+}
+
+/* AVX2 -------------------------------------------------------------- */
+
+/** Load 32 pixels of RGB data into registers, where the lower lanes hold
+    the first and the upper lanes the second 16 pixels. */
+SIMD_TARGET_AVX2 inline void LoadLanesAVX2(const unsigned char *src, __m256i *data)
+{
+  for (int j = 0; j < 3; j++) {
+    __m128i lo = _mm_loadu_si128((const __m128i *)(src + 16 * j));
+    __m128i hi = _mm_loadu_si128((const __m128i *)(src + 48 + 16 * j));
+    data[j] = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+  }
+}
+
+/** Store registers as 32 pixels of RGB data, inverse of LoadLanesAVX2(). */
+SIMD_TARGET_AVX2 inline void StoreLanesAVX2(unsigned char *dst, const __m256i *data)
+{
+  for (int j = 0; j < 3; j++) {
+    _mm_storeu_si128((__m128i *)(dst + 16 * j), _mm256_castsi256_si128(data[j]));
+    _mm_storeu_si128((__m128i *)(dst + 48 + 16 * j), _mm256_extracti128_si256(data[j], 1));
+  }
+}
+
+/** Load 32 pixels of RGB data and split into channels. */
+SIMD_TARGET_AVX2 inline void Load3AVX2(const unsigned char *src,
+                                       const __m256i *masks, __m256i *c)
+{
+  __m256i data[3];
+  LoadLanesAVX2(src, data);
+  for (int i = 0; i < 3; i++)
+    c[i] = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(data[0], masks[3 * i]),
+                                           _mm256_shuffle_epi8(data[1], masks[3 * i + 1])),
+                           _mm256_shuffle_epi8(data[2], masks[3 * i + 2]));
+}
+
+/** Merge channels of 32 pixels and store as RGB data. */
+SIMD_TARGET_AVX2 inline void Store3AVX2(unsigned char *dst,
+                                        const __m256i *masks, const __m256i *c)
+{
+  __m256i data[3];
+  for (int j = 0; j < 3; j++)
+    data[j] = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(c[0], masks[3 * j]),
+                                              _mm256_shuffle_epi8(c[1], masks[3 * j + 1])),
+                              _mm256_shuffle_epi8(c[2], masks[3 * j + 2]));
+  StoreLanesAVX2(dst, data);
+}
+
+/** Load shuffle masks into both lanes of registers. */
+SIMD_TARGET_AVX2 inline void LoadMasksAVX2(const signed char (*table)[16],
+                                           int count, __m256i *masks)
+{
+  for (int i = 0; i < count; i++)
+    masks[i] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)table[i]));
+}
+
+/** Returns floor(255 * a / b) for 16 bit values 0 <= a <= 1530, 1 <= b. */
+SIMD_TARGET_AVX2 inline __m256i ScaledDivideAVX2(__m256i a, __m256i b)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256 scale = _mm256_set1_ps(255.0f);
+  __m256 aLo = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_unpacklo_epi16(a, zero)), scale);
+  __m256 aHi = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_unpackhi_epi16(a, zero)), scale);
+  __m256 bLo = _mm256_cvtepi32_ps(_mm256_unpacklo_epi16(b, zero));
+  __m256 bHi = _mm256_cvtepi32_ps(_mm256_unpackhi_epi16(b, zero));
+  return _mm256_packs_epi32(_mm256_cvttps_epi32(_mm256_div_ps(aLo, bLo)),
+                         _mm256_cvttps_epi32(_mm256_div_ps(aHi, bHi)));
+}
+
+/** Returns (v * w + 32512) / 65025 for 16 bit values v <= 255, w <= 65025. */
+SIMD_TARGET_AVX2 inline __m256i Divide65025AVX2(__m256i v, __m256i w)
+{
+  const __m256i round = _mm256_set1_epi32(32512);
+  const __m256 scale = _mm256_set1_ps(65025.0f);
+  __m256i lo = _mm256_mullo_epi16(v, w), hi = _mm256_mulhi_epu16(v, w);
+  __m256i pLo = _mm256_add_epi32(_mm256_unpacklo_epi16(lo, hi), round);
+  __m256i pHi = _mm256_add_epi32(_mm256_unpackhi_epi16(lo, hi), round);
+  return _mm256_packs_epi32(_mm256_cvttps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(pLo), scale)),
+                         _mm256_cvttps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(pHi), scale)));
+}
+
+/** Returns floor(y / 255) for unsigned 16 bit values y < 65535. */
+SIMD_TARGET_AVX2 inline __m256i Divide255AVX2(__m256i y)
+{
+  y = _mm256_add_epi16(y, _mm256_add_epi16(_mm256_set1_epi16(1), _mm256_srli_epi16(y, 8)));
+  return _mm256_srli_epi16(y, 8);
+}
+
+/** Compute gray values of 16 pixels with 16 bit channels. */
+SIMD_TARGET_AVX2 inline __m256i GrayAVX2(__m256i r, __m256i g, __m256i b)
+{
+  __m256i sum = _mm256_add_epi16(_mm256_mullo_epi16(r, _mm256_set1_epi16(77)),
+                              _mm256_mullo_epi16(g, _mm256_set1_epi16(150)));
+  sum = _mm256_add_epi16(sum, _mm256_mullo_epi16(b, _mm256_set1_epi16(29)));
+  return _mm256_srli_epi16(_mm256_add_epi16(sum, _mm256_set1_epi16(128)), 8);
+}
+
+/** Convert 16 pixels with 16 bit channels from RGB to HSV. */
+SIMD_TARGET_AVX2 inline void RGBToHSVBlockAVX2(const __m256i *rgb, __m256i *hsv)
+{
+  const __m256i zero = _mm256_setzero_si256(), one = _mm256_set1_epi16(1);
+  __m256i r = rgb[0], g = rgb[1], b = rgb[2];
+  __m256i max = _mm256_max_epi16(r, _mm256_max_epi16(g, b));
+  __m256i min = _mm256_min_epi16(r, _mm256_min_epi16(g, b));
+  __m256i delta = _mm256_sub_epi16(max, min), delta2 = _mm256_add_epi16(delta, delta);
+  __m256i isR = _mm256_cmpeq_epi16(max, r);
+  __m256i isG = _mm256_andnot_si256(isR, _mm256_cmpeq_epi16(max, g));
+  __m256i isB = _mm256_andnot_si256(_mm256_or_si256(isR, isG), _mm256_cmpeq_epi16(zero, zero));
+  __m256i num = _mm256_or_si256(
+    _mm256_or_si256(_mm256_and_si256(isR, _mm256_sub_epi16(g, b)),
+                 _mm256_and_si256(isG, _mm256_add_epi16(_mm256_sub_epi16(b, r), delta2))),
+    _mm256_and_si256(isB, _mm256_add_epi16(_mm256_sub_epi16(r, g), _mm256_add_epi16(delta2, delta2))));
+  __m256i delta6 = _mm256_add_epi16(delta2, _mm256_add_epi16(delta2, delta2));
+  num = _mm256_add_epi16(num, _mm256_and_si256(_mm256_cmpgt_epi16(zero, num), delta6));
+  hsv[0] = ScaledDivideAVX2(num, _mm256_max_epi16(delta6, one));
+  hsv[1] = ScaledDivideAVX2(delta, _mm256_max_epi16(max, one));
+  hsv[2] = max;
+}
+
+/** Convert 16 pixels with 16 bit channels from HSV to RGB. */
+SIMD_TARGET_AVX2 inline void HSVToRGBBlockAVX2(const __m256i *hsv, __m256i *rgb)
+{
+  const __m256i c255 = _mm256_set1_epi16(255), c65025 = _mm256_set1_epi16((short)65025);
+  __m256i h = hsv[0], s = hsv[1], v = hsv[2];
+  // Sector i and fraction f, sector 6 equals sector 0
+  __m256i h6 = _mm256_mullo_epi16(h, _mm256_set1_epi16(6));
+  __m256i i = Divide255AVX2(h6);
+  __m256i f = _mm256_sub_epi16(h6, _mm256_mullo_epi16(i, c255));
+  i = _mm256_sub_epi16(i, _mm256_and_si256(_mm256_cmpeq_epi16(i, _mm256_set1_epi16(6)), _mm256_set1_epi16(6)));
+  __m256i p = Divide255AVX2(_mm256_add_epi16(_mm256_mullo_epi16(v, _mm256_sub_epi16(c255, s)),
+                                           _mm256_set1_epi16(127)));
+  __m256i q = Divide65025AVX2(v, _mm256_sub_epi16(c65025, _mm256_mullo_epi16(s, f)));
+  __m256i t = Divide65025AVX2(v, _mm256_sub_epi16(c65025,
+                                                _mm256_mullo_epi16(s, _mm256_sub_epi16(c255, f))));
+  __m256i m[6];
+  for (int k = 0; k < 6; k++)
+    m[k] = _mm256_cmpeq_epi16(i, _mm256_set1_epi16((short)k));
+  rgb[0] = _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(_mm256_or_si256(m[0], m[5]), v),
+                                     _mm256_and_si256(m[1], q)),
+                        _mm256_or_si256(_mm256_and_si256(_mm256_or_si256(m[2], m[3]), p),
+                                     _mm256_and_si256(m[4], t)));
+  rgb[1] = _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(_mm256_or_si256(m[1], m[2]), v),
+                                     _mm256_and_si256(m[0], t)),
+                        _mm256_or_si256(_mm256_and_si256(_mm256_or_si256(m[4], m[5]), p),
+                                     _mm256_and_si256(m[3], q)));
+  rgb[2] = _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(_mm256_or_si256(m[3], m[4]), v),
+                                     _mm256_and_si256(m[2], t)),
+                        _mm256_or_si256(_mm256_and_si256(_mm256_or_si256(m[0], m[1]), p),
+                                     _mm256_and_si256(m[5], q)));
+}
+
+/** Apply function on 16 pixels with 16 bit channels to 32 pixels with 8 bit
+    channels. */
+template <void (*Function)(const __m256i *, __m256i *)>
+SIMD_TARGET_AVX2 inline void Apply3AVX2(const __m256i *src, __m256i *dst)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i lo[3], hi[3], resultLo[3], resultHi[3];
+  for (int c = 0; c < 3; c++) {
+    lo[c] = _mm256_unpacklo_epi8(src[c], zero);
+    hi[c] = _mm256_unpackhi_epi8(src[c], zero);
+  }
+  Function(lo, resultLo);
+  Function(hi, resultHi);
+  for (int c = 0; c < 3; c++)
+    dst[c] = _mm256_packus_epi16(resultLo[c], resultHi[c]);
+}
+
+SIMD_TARGET_AVX2 void RGBToGrayAVX2(const unsigned char *src, unsigned char *dst, int width)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i masks[9], c[3];
+  LoadMasksAVX2(DEINTERLEAVE_MASKS, 9, masks);
+  int x = 0;
+  for (; x + 32 <= width; x += 32, src += 96) {
+    Load3AVX2(src, masks, c);
+    __m256i lo = GrayAVX2(_mm256_unpacklo_epi8(c[0], zero), _mm256_unpacklo_epi8(c[1], zero),
+                           _mm256_unpacklo_epi8(c[2], zero));
+    __m256i hi = GrayAVX2(_mm256_unpackhi_epi8(c[0], zero), _mm256_unpackhi_epi8(c[1], zero),
+                           _mm256_unpackhi_epi8(c[2], zero));
+    _mm256_storeu_si256((__m256i *)(dst + x), _mm256_packus_epi16(lo, hi));
+  }
+  RGBToGrayScalar(src, dst + x, width - x);
+}
+
+SIMD_TARGET_AVX2 void GrayToRGBAVX2(const unsigned char *src, unsigned char *dst, int width)
+{
+  __m256i masks[3];
+  LoadMasksAVX2(REPLICATE_MASKS, 3, masks);
+  int x = 0;
+  for (; x + 32 <= width; x += 32, dst += 96) {
+    __m256i gray = _mm256_loadu_si256((const __m256i *)(src + x));
+    __m256i rgb[3];
+    for (int j = 0; j < 3; j++)
+      rgb[j] = _mm256_shuffle_epi8(gray, masks[j]);
+    StoreLanesAVX2(dst, rgb);
+  }
+  GrayToRGBScalar(src + x, dst, width - x);
+}
+
+SIMD_TARGET_AVX2 void RGBToHSVAVX2(const unsigned char *src, unsigned char *dst, int width)
+{
+  __m256i loadMasks[9], storeMasks[9], rgb[3], hsv[3];
+  LoadMasksAVX2(DEINTERLEAVE_MASKS, 9, loadMasks);
+  LoadMasksAVX2(INTERLEAVE_MASKS, 9, storeMasks);
+  int x = 0;
+  for (; x + 32 <= width; x += 32, src += 96, dst += 96) {
+    Load3AVX2(src, loadMasks, rgb);
+    Apply3AVX2<RGBToHSVBlockAVX2>(rgb, hsv);
+    Store3AVX2(dst, storeMasks, hsv);
+  }
+  RGBToHSVScalar(src, dst, width - x);
+}
+
+SIMD_TARGET_AVX2 void HSVToRGBAVX2(const unsigned char *src, unsigned char *dst, int width)
+{
+  __m256i loadMasks[9], storeMasks[9], rgb[3], hsv[3];
+  LoadMasksAVX2(DEINTERLEAVE_MASKS, 9, loadMasks);
+  LoadMasksAVX2(INTERLEAVE_MASKS, 9, storeMasks);
+  int x = 0;
+  for (; x + 32 <= width; x += 32, src += 96, dst += 96) {
+    Load3AVX2(src, loadMasks, hsv);
+    Apply3AVX2<HSVToRGBBlockAVX2>(hsv, rgb);
+    Store3AVX2(dst, storeMasks, rgb);
+  }
+  HSVToRGBScalar(src, dst, width - x);
+}
+
+SIMD_TARGET_AVX2 void HSVToGrayAVX2(const unsigned char *src, unsigned char *dst, int width)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i masks[9], hsv[3], lo[3], hi[3], rgb[3];
+  LoadMasksAVX2(DEINTERLEAVE_MASKS, 9, masks);
+  int x = 0;
+  for (; x + 32 <= width; x += 32, src += 96) {
+    Load3AVX2(src, masks, hsv);
+    for (int c = 0; c < 3; c++) {
+      lo[c] = _mm256_unpacklo_epi8(hsv[c], zero);
+      hi[c] = _mm256_unpackhi_epi8(hsv[c], zero);
+    }
+    HSVToRGBBlockAVX2(lo, rgb);
+    lo[0] = GrayAVX2(rgb[0], rgb[1], rgb[2]);
+    HSVToRGBBlockAVX2(hi, rgb);
+    hi[0] = GrayAVX2(rgb[0], rgb[1], rgb[2]);
+    _mm256_storeu_si256((__m256i *)(dst + x), _mm256_packus_epi16(lo[0], hi[0]));
+  }
+  HSVToGrayScalar(src, dst + x, width - x);
+}
+
+SIMD_TARGET_AVX2 void GrayToHSVAVX2(const unsigned char *src, unsigned char *dst, int width)
+{
+  __m256i masks[9], hsv[3];
+  LoadMasksAVX2(INTERLEAVE_MASKS, 9, masks);
+  hsv[0] = hsv[1] = _mm256_setzero_si256();
+  int x = 0;
+  for (; x + 32 <= width; x += 32, dst += 96) {
+    hsv[2] = _mm256_loadu_si256((const __m256i *)(src + x));
+    Store3AVX2(dst, masks, hsv);
+  }
+  GrayToHSVScalar(src + x, dst, width - x);
+}
+
+SIMD_TARGET_AVX2 void InterleaveAVX2(const unsigned char *p0, const unsigned char *p1,
+                                  const unsigned char *p2, unsigned char *dst, int width)
+{
+  __m256i masks[9], c[3];
+  LoadMasksAVX2(INTERLEAVE_MASKS, 9, masks);
+  int x = 0;
+  for (; x + 32 <= width; x += 32, dst += 96) {
+    c[0] = _mm256_loadu_si256((const __m256i *)(p0 + x));
+    c[1] = _mm256_loadu_si256((const __m256i *)(p1 + x));
+    c[2] = _mm256_loadu_si256((const __m256i *)(p2 + x));
+    Store3AVX2(dst, masks, c);
+  }
+  InterleaveScalar(p0 + x, p1 + x, p2 + x, dst, width - x);
+}
+
+SIMD_TARGET_AVX2 void DeinterleaveAVX2(const unsigned char *src, unsigned char *p0,
+                                    unsigned char *p1, unsigned char *p2, int width)
+{
+  __m256i masks[9], c[3];
+  LoadMasksAVX2(DEINTERLEAVE_MASKS, 9, masks);
+  int x = 0;
+  for (; x + 32 <= width; x += 32, src += 96) {
+    Load3AVX2(src, masks, c);
+    _mm256_storeu_si256((__m256i *)(p0 + x), c[0]);
+    _mm256_storeu_si256((__m256i *)(p1 + x), c[1]);
+    _mm256_storeu_si256((__m256i *)(p2 + x), c[2]);
+  }
+  DeinterleaveScalar(src, p0 + x, p1 + x, p2 + x, width - x);
+}
+
+/** Round 16 bit values to 8 bit values (see Round16To8SSSE3()). */
+SIMD_TARGET_AVX2 inline __m256i Round16To8AVX2(__m256i v)
+{
+  __m256i t = _mm256_adds_epu16(v, _mm256_set1_epi16(128));
+  return _mm256_srli_epi16(_mm256_sub_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+/** Saturate floats to [0, 1] (NaN to 0), scale and round to integers. */
+SIMD_TARGET_AVX2 inline __m256i ScaleFloatAVX2(__m256 v, __m256 scale)
+{
+  v = _mm256_min_ps(_mm256_max_ps(v, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+  return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(v, scale), _mm256_set1_ps(0.5f)));
+}
+
+SIMD_TARGET_AVX2 void UInt8ToUInt16AVX2(const unsigned char *src, unsigned char *dst, int count)
+{
+  int i = 0;
+  for (; i + 16 <= count; i += 16, dst += 32) {
+    __m256i v = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(src + i)));
+    _mm256_storeu_si256((__m256i *)dst, _mm256_or_si256(v, _mm256_slli_epi16(v, 8)));
+  }
+  UInt8ToUInt16Scalar(src + i, dst, count - i);
+}
+
+SIMD_TARGET_AVX2 void UInt16ToUInt8AVX2(const unsigned char *src, unsigned char *dst, int count)
+{
+  int i = 0;
+  for (; i + 32 <= count; i += 32, src += 64) {
+    __m256i a = Round16To8AVX2(_mm256_loadu_si256((const __m256i *)src));
+    __m256i b = Round16To8AVX2(_mm256_loadu_si256((const __m256i *)(src + 32)));
+    // Packing works per lane, restore order of the 64 bit blocks
+    __m256i v = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+    _mm256_storeu_si256((__m256i *)(dst + i), v);
+  }
+  UInt16ToUInt8Scalar(src, dst + i, count - i);
+}
+
+SIMD_TARGET_AVX2 void UInt8ToFloatAVX2(const unsigned char *src, unsigned char *dst, int count)
+{
+  const __m256 scale = _mm256_set1_ps(255.0f);
+  float *d = (float *)dst;
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(src + i)));
+    _mm256_storeu_ps(d + i, _mm256_div_ps(_mm256_cvtepi32_ps(v), scale));
+  }
+  UInt8ToFloatScalar(src + i, (unsigned char *)(d + i), count - i);
+}
+
+SIMD_TARGET_AVX2 void FloatToUInt8AVX2(const unsigned char *src, unsigned char *dst, int count)
+{
+  const __m256 scale = _mm256_set1_ps(255.0f);
+  const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+  const float *s = (const float *)src;
+  int i = 0;
+  for (; i + 32 <= count; i += 32) {
+    __m256i v[4];
+    for (int j = 0; j < 4; j++)
+      v[j] = ScaleFloatAVX2(_mm256_loadu_ps(s + i + 8 * j), scale);
+    // Packing works per lane, restore order of the 32 bit blocks
+    __m256i a = _mm256_packs_epi32(v[0], v[1]), b = _mm256_packs_epi32(v[2], v[3]);
+    __m256i c = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(a, b), order);
+    _mm256_storeu_si256((__m256i *)(dst + i), c);
+  }
+  FloatToUInt8Scalar((const unsigned char *)(s + i), dst + i, count - i);
+}
+
+SIMD_TARGET_AVX2 void UInt16ToFloatAVX2(const unsigned char *src, unsigned char *dst, int count)
+{
+  const __m256 scale = _mm256_set1_ps(65535.0f);
+  const unsigned short *s = (const unsigned short *)src;
+  float *d = (float *)dst;
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i v = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(s + i)));
+    _mm256_storeu_ps(d + i, _mm256_div_ps(_mm256_cvtepi32_ps(v), scale));
+  }
+  UInt16ToFloatScalar((const unsigned char *)(s + i), (unsigned char *)(d + i), count - i);
+}
+
+SIMD_TARGET_AVX2 void FloatToUInt16AVX2(const unsigned char *src, unsigned char *dst, int count)
+{
+  const __m256 scale = _mm256_set1_ps(65535.0f);
+  const float *s = (const float *)src;
+  unsigned short *d = (unsigned short *)dst;
+  int i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m256i a = ScaleFloatAVX2(_mm256_loadu_ps(s + i), scale);
+    __m256i b = ScaleFloatAVX2(_mm256_loadu_ps(s + i + 8), scale);
+    __m256i v = _mm256_permute4x64_epi64(_mm256_packus_epi32(a, b), 0xD8);
+    _mm256_storeu_si256((__m256i *)(d + i), v);
+  }
+  FloatToUInt16Scalar((const unsigned char *)(s + i), (unsigned char *)(d + i), count - i);
+}
+
+#endif // SIMD_X86
+
+/** Row functions for one instruction set */
+struct RowFunctions
+{
+  ColorConversion::InstructionSet instructionSet;
+  void (*rgbToGray)(const unsigned char *, unsigned char *, int);
+  void (*grayToRGB)(const unsigned char *, unsigned char *, int);
+  void (*rgbToHSV)(const unsigned char *, unsigned char *, int);
+  void (*hsvToRGB)(const unsigned char *, unsigned char *, int);
+  void (*hsvToGray)(const unsigned char *, unsigned char *, int);
+  void (*grayToHSV)(const unsigned char *, unsigned char *, int);
+  void (*interleave)(const unsigned char *, const unsigned char *,
+                     const unsigned char *, unsigned char *, int);
+  void (*deinterleave)(const unsigned char *, unsigned char *, unsigned char *,
+                       unsigned char *, int);
+  // Depth conversions indexed by source and target Image::PixelType, NULL
+  // for equal types
+  void (*depth[3][3])(const unsigned char *, unsigned char *, int);
+};
+
+const RowFunctions SCALAR_FUNCTIONS = {
+  ColorConversion::IS_Scalar,
+  RGBToGrayScalar, GrayToRGBScalar, RGBToHSVScalar, HSVToRGBScalar,
+  HSVToGrayScalar, GrayToHSVScalar, InterleaveScalar, DeinterleaveScalar,
+  { { NULL, UInt8ToUInt16Scalar, UInt8ToFloatScalar },
+    { UInt16ToUInt8Scalar, NULL, UInt16ToFloatScalar },
+    { FloatToUInt8Scalar, FloatToUInt16Scalar, NULL } }
+};
+
+#ifdef SIMD_X86
+const RowFunctions SSSE3_FUNCTIONS = {
+  ColorConversion::IS_SSSE3,
+  RGBToGraySSSE3, GrayToRGBSSSE3, RGBToHSVSSSE3, HSVToRGBSSSE3,
+  HSVToGraySSSE3, GrayToHSVSSSE3, InterleaveSSSE3, DeinterleaveSSSE3,
+  { { NULL, UInt8ToUInt16SSSE3, UInt8ToFloatSSSE3 },
+    { UInt16ToUInt8SSSE3, NULL, UInt16ToFloatSSSE3 },
+    { FloatToUInt8SSSE3, FloatToUInt16SSSE3, NULL } }
+};
+
+const RowFunctions AVX2_FUNCTIONS = {
+  ColorConversion::IS_AVX2,
+  RGBToGrayAVX2, GrayToRGBAVX2, RGBToHSVAVX2, HSVToRGBAVX2,
+  HSVToGrayAVX2, GrayToHSVAVX2, InterleaveAVX2, DeinterleaveAVX2,
+  { { NULL, UInt8ToUInt16AVX2, UInt8ToFloatAVX2 },
+    { UInt16ToUInt8AVX2, NULL, UInt16ToFloatAVX2 },
+    { FloatToUInt8AVX2, FloatToUInt16AVX2, NULL } }
+};
+#endif
+
+/** Returns the fastest supported row functions up to the given set. */
+const RowFunctions *SelectRowFunctions(ColorConversion::InstructionSet is)
+{
+#ifdef SIMD_X86
+  bool autoSelect = (is == ColorConversion::IS_Auto);
+  if ((autoSelect || is == ColorConversion::IS_AVX2) && CpuFeatures::HasAVX2())
+    return &AVX2_FUNCTIONS;
+  if ((autoSelect || is != ColorConversion::IS_Scalar) && CpuFeatures::HasSSSE3())
+    return &SSSE3_FUNCTIONS;
+#else
+  (void)is;
+#endif
+  return &SCALAR_FUNCTIONS;
+}
+
+/** Returns row functions currently used, selected on first use. */
+atomic<const RowFunctions *> &CurrentRowFunctions()
+{
+  static atomic<const RowFunctions *> functions(SelectRowFunctions(ColorConversion::IS_Auto));
+  return functions;
+}
+
+} // namespace
+
+atomic<int> ColorConversion::numThreads_(0);
+
 ColorConversion::ColorConversion()
 {
 }
 
+void ColorConversion::SetNumThreads(int numThreads)
+{
+  numThreads_.store(numThreads > 0 ? numThreads : 0);
+}
+
+int ColorConversion::GetNumThreads()
+{
+  int numThreads = numThreads_.load();
+  if (numThreads == 0)
+    numThreads = (int)thread::hardware_concurrency();
+  return numThreads > 0 ? numThreads : 1;
+}
+
+ColorConversion::InstructionSet ColorConversion::SetInstructionSet(InstructionSet is)
+{
+  const RowFunctions *functions = SelectRowFunctions(is);
+  CurrentRowFunctions().store(functions);
+  return functions->instructionSet;
+}
+
+ColorConversion::InstructionSet ColorConversion::GetInstructionSet()
+{
+  return CurrentRowFunctions().load()->instructionSet;
+}
+
 void ColorConversion::RGBToGray(const Image &src, Image &dst)
 {
-  // TODO : Implement this method in exercise 5
+  ConvertImage_(src, dst, Image::CM_Gray, 3, RGBToGray, "RGBToGray");
+}
+
+void ColorConversion::RGBToGray(const ImageView &src, const ImageView &dst)
+{
+  if (CheckViews_(src, dst, 3, 1, "RGBToGray"))
+    ConvertRows_(src, dst, CurrentRowFunctions().load()->rgbToGray);
 }
 
 void ColorConversion::GrayToRGB(const Image &src, Image &dst)
 {
-  // TODO : Implement this method in exercise 5
+  ConvertImage_(src, dst, Image::CM_RGB, 1, GrayToRGB, "GrayToRGB");
+}
+
+void ColorConversion::GrayToRGB(const ImageView &src, const ImageView &dst)
+{
+  if (CheckViews_(src, dst, 1, 3, "GrayToRGB"))
+    ConvertRows_(src, dst, CurrentRowFunctions().load()->grayToRGB);
 }
 
 void ColorConversion::RGBToHSV(const Image &src, Image &dst)
 {
-  // TODO : Implement this method in exercise 5
+  ConvertImage_(src, dst, Image::CM_HSV, 3, RGBToHSV, "RGBToHSV");
+}
+
+void ColorConversion::RGBToHSV(const ImageView &src, const ImageView &dst)
+{
+  if (CheckViews_(src, dst, 3, 3, "RGBToHSV"))
+    ConvertRows_(src, dst, CurrentRowFunctions().load()->rgbToHSV);
 }
 
 void ColorConversion::HSVToRGB(const Image &src, Image &dst)
 {
-  // TODO : Implement this method in exercise 5
+  ConvertImage_(src, dst, Image::CM_RGB, 3, HSVToRGB, "HSVToRGB");
+}
+
+void ColorConversion::HSVToRGB(const ImageView &src, const ImageView &dst)
+{
+  if (CheckViews_(src, dst, 3, 3, "HSVToRGB"))
+    ConvertRows_(src, dst, CurrentRowFunctions().load()->hsvToRGB);
 }
 
 void ColorConversion::HSVToGray(const Image &src, Image &dst)
 {
-  Image tmp;
-  HSVToRGB(src, tmp);
-  RGBToGray(tmp, dst);
+  ConvertImage_(src, dst, Image::CM_Gray, 3, HSVToGray, "HSVToGray");
+}
+
+void ColorConversion::HSVToGray(const ImageView &src, const ImageView &dst)
+{
+  if (CheckViews_(src, dst, 3, 1, "HSVToGray"))
+    ConvertRows_(src, dst, CurrentRowFunctions().load()->hsvToGray);
 }
 
 void ColorConversion::GrayToHSV(const Image &src, Image &dst)
 {
+  ConvertImage_(src, dst, Image::CM_HSV, 1, GrayToHSV, "GrayToHSV");
+}
+
+void ColorConversion::GrayToHSV(const ImageView &src, const ImageView &dst)
+{
+  if (CheckViews_(src, dst, 1, 3, "GrayToHSV"))
+    ConvertRows_(src, dst, CurrentRowFunctions().load()->grayToHSV);
+}
+
+void ColorConversion::ConvertLayout(const Image &src, Image &dst,
+                                    Image::PixelLayout layout)
+{
+  if (&src == &dst) {
+    if (src.GetLayout() != layout) {
+      Image tmp;
+      ConvertLayout(src, tmp, layout);
+      dst.Swap(tmp);
+    }
+    return;
+  }
+  if (InitTarget_(src, dst, src.GetColorModel(), layout, src.GetPixelType()))
+    ConvertLayout(ImageView(src), ImageView(dst));
+}
+
+void ColorConversion::ConvertLayout(const ImageView &src, const ImageView &dst)
+{
+  if (!CheckViews_(src, dst, src.GetChannels(), src.GetChannels(), "ConvertLayout", true))
+    return;
+  if (src.GetPixelType() != dst.GetPixelType()) {
+    cerr << "ColorConversion::ConvertLayout() : Pixel types differ!" << endl;
+    return;
+  }
+  int size = src.GetBytesPerValue();
+  if (src.GetChannels() == 1 || src.IsPlanar() == dst.IsPlanar()) {
+    // Copy rows of all planes
+    int numPlanes = src.IsPlanar() ? src.GetChannels() : 1;
+    int rowBytes = (src.IsPlanar() ? src.GetWidth() : src.GetWidth() * src.GetChannels()) * size;
+    for (int c = 0; c < numPlanes; c++)
+      for (int y = 0; y < src.GetHeight(); y++)
+        memcpy(dst.GetPlaneRow(c, y), src.GetPlaneRow(c, y), rowBytes);
+  } else if (size > 1) {
+    // Copy values of wider pixel types one by one
+    int srcStep = src.IsPlanar() ? size : 3 * size;
+    int dstStep = dst.IsPlanar() ? size : 3 * size;
+    for (int c = 0; c < 3; c++) {
+      for (int y = 0; y < src.GetHeight(); y++) {
+        const unsigned char *s = src.GetPlaneRow(c, y);
+        unsigned char *d = dst.GetPlaneRow(c, y);
+        for (int x = 0; x < src.GetWidth(); x++, s += srcStep, d += dstStep)
+          memcpy(d, s, size);
+      }
+    }
+  } else {
+    ConvertRows_(src, dst, NULL);
+  }
+}
+
+void ColorConversion::ConvertDepth(const Image &src, Image &dst,
+                                   Image::PixelType type)
+{
+  if (&src == &dst) {
+    if (src.GetPixelType() != type) {
+      Image tmp;
+      ConvertDepth(src, tmp, type);
+      dst.Swap(tmp);
+    }
+    return;
+  }
+  if (InitTarget_(src, dst, src.GetColorModel(), src.GetLayout(), type))
+    ConvertDepth(ImageView(src), ImageView(dst));
+}
+
+void ColorConversion::ConvertDepth(const ImageView &src, const ImageView &dst)
+{
+  if (!CheckViews_(src, dst, src.GetChannels(), src.GetChannels(), "ConvertDepth", true))
+    return;
+  if (src.GetChannels() == 3 && src.IsPlanar() != dst.IsPlanar()) {
+    cerr << "ColorConversion::ConvertDepth() : Pixel layouts differ!" << endl;
+    return;
+  }
+  if (src.GetPixelType() == dst.GetPixelType()) {
+    ConvertLayout(src, dst);
+    return;
+  }
+  RowFunction_ function =
+    CurrentRowFunctions().load()->depth[src.GetPixelType()][dst.GetPixelType()];
+  ConvertRows_(src, dst, function, ConvertDepthBand_);
+}
+
+void ColorConversion::ConvertRows_(const ImageView &src, const ImageView &dst,
+                                   RowFunction_ function, BandFunction_ band)
+{
+  int height = src.GetHeight();
+  long long numPixels = (long long)src.GetWidth() * height;
+  long long maxBands = numPixels / MIN_PIXELS_PER_THREAD;
+  int numBands = GetNumThreads();
+  if (numBands > maxBands)
+    numBands = (int)maxBands;
+  if (numBands > height)
+    numBands = height;
+  if (numBands <= 1) {
+    band(src, dst, function, 0, height);
+    return;
+  }
+  // Convert first band in this thread, others in new threads
+  vector<thread> threads;
+  threads.reserve(numBands - 1);
+  for (int i = 1; i < numBands; i++) {
+    int beginY = (int)((long long)i * height / numBands);
+    int endY = (int)((long long)(i + 1) * height / numBands);
+    try {
+      threads.push_back(thread(band, cref(src), cref(dst), function,
+                               beginY, endY));
+    } catch (const system_error &) {
+      band(src, dst, function, beginY, endY);
+    }
+  }
+  band(src, dst, function, 0, height / numBands);
+  for (size_t i = 0; i < threads.size(); i++)
+    threads[i].join();
+}
+
+void ColorConversion::ConvertBand_(const ImageView &src, const ImageView &dst,
+                                   RowFunction_ function, int beginY, int endY)
+{
+  int width = src.GetWidth();
+  bool srcPlanar = src.IsPlanar() && src.GetChannels() == 3;
+  bool dstPlanar = dst.IsPlanar() && dst.GetChannels() == 3;
+  if (!srcPlanar && !dstPlanar) {
+    for (int y = beginY; y < endY; y++)
+      function(src.GetRow(y), dst.GetRow(y), width);
+    return;
+  }
+  // Row functions work on interleaved rows, so planar rows are interleaved
+  // into temporary rows before and deinterleaved after the conversion.
+  // Without row function, rows are only (de-)interleaved.
+  const RowFunctions *functions = CurrentRowFunctions().load();
+  vector<unsigned char> srcRow(srcPlanar && function != NULL ? 3 * width : 0);
+  vector<unsigned char> dstRow(dstPlanar ? 3 * width : 0);
+  for (int y = beginY; y < endY; y++) {
+    unsigned char *d = dstPlanar ? &dstRow[0] : dst.GetRow(y);
+    if (srcPlanar) {
+      unsigned char *s = (function != NULL) ? &srcRow[0] : d;
+      functions->interleave(src.GetPlaneRow(0, y), src.GetPlaneRow(1, y),
+                            src.GetPlaneRow(2, y), s, width);
+      if (function != NULL)
+        function(s, d, width);
+    } else if (function != NULL) {
+      function(src.GetRow(y), d, width);
+    } else {
+      d = src.GetRow(y);
+    }
+    if (dstPlanar)
+      functions->deinterleave(d, dst.GetPlaneRow(0, y), dst.GetPlaneRow(1, y),
+                              dst.GetPlaneRow(2, y), width);
+  }
+}
+
+void ColorConversion::ConvertDepthBand_(const ImageView &src, const ImageView &dst,
+                                        RowFunction_ function, int beginY, int endY)
+{
+  int numPlanes = src.IsPlanar() ? src.GetChannels() : 1;
+  int count = src.IsPlanar() ? src.GetWidth() : src.GetWidth() * src.GetChannels();
+  for (int c = 0; c < numPlanes; c++)
+    for (int y = beginY; y < endY; y++)
+      function(src.GetPlaneRow(c, y), dst.GetPlaneRow(c, y), count);
+}
+
+void ColorConversion::ConvertImage_(const Image &src, Image &dst, Image::ColorModel cm,
+                                    int srcChannels, ViewFunction_ function,
+                                    const char *method)
+{
+  if (&src != &dst) {
+    if (InitTarget_(src, dst, cm, dst.GetLayout()))
+      function(ImageView(src), ImageView(dst));
+    return;
+  }
+  // Initializing the target would overwrite the source, so convert into a
+  // temporary image with the same row alignment and layout and swap it in.
+  // The source is kept if it cannot be converted
+  if (src.IsEmpty())
+    return;
   Image tmp;
-  GrayToRGB(src, tmp);
-  RGBToHSV(tmp, dst);
+  tmp.Init(src.GetWidth(), src.GetHeight(), cm, src.GetRowAlignment(), src.GetLayout());
+  ImageView srcView(src), tmpView(tmp);
+  if (tmp.IsEmpty() || !CheckViews_(srcView, tmpView, srcChannels, tmp.GetChannels(), method))
+    return;
+  function(srcView, tmpView);
+  dst.Swap(tmp);
 }
 
+bool ColorConversion::InitTarget_(const Image &src, Image &dst, Image::ColorModel cm,
+                                  Image::PixelLayout layout, Image::PixelType type)
+{
+  if (src.IsEmpty()) {
+    dst.Release();
+    return false;
+  }
+  dst.Init(src.GetWidth(), src.GetHeight(), cm, dst.GetRowAlignment(), layout, type);
+  return !dst.IsEmpty();
+}
+
+bool ColorConversion::CheckViews_(const ImageView &src, const ImageView &dst,
+                                  int srcChannels, int dstChannels, const char *method,
+                                  bool anyPixelType)
+{
+  if (src.IsEmpty() || dst.IsEmpty() ||
+      src.GetWidth() != dst.GetWidth() || src.GetHeight() != dst.GetHeight()) {
+    cerr << "ColorConversion::" << method << "() : Invalid image size!" << endl;
+    return false;
+  }
+  if (src.GetChannels() != srcChannels || dst.GetChannels() != dstChannels) {
+    cerr << "ColorConversion::" << method << "() : Invalid number of channels!" << endl;
+    return false;
+  }
+  if (!anyPixelType && (src.GetPixelType() != Image::PT_UInt8 ||
+                        dst.GetPixelType() != Image::PT_UInt8)) {
+    cerr << "ColorConversion::" << method << "() : Only 8-bit images are supported!" << endl;
+    return false;
+  }
+  if (dst.IsReadOnly()) {
+    cerr << "ColorConversion::" << method << "() : Target image is read-only!" << endl;
+    return false;
+  }
+  return true;
+}
@@ -2,36 +2,178 @@
 #define __ColorConversion_hh__
 
 #include "Image.hh"
+#include "ImageView.hh"
+#include <atomic>
 
 /** @class ColorConversion
     @brief Abstract class containing static methods to convert images from
            one color model to another. Supports gray, RGB and HSV images.
+
+    Methods taking images initialize the target image to the size of the
+    source image, source and target may be the same image. Methods taking
+    views (see ImageView) convert the region in place and expect a target
+    view of the same size with a suitable color model, e.g. to convert a
+    tile of a large image.
+
+    Conversions between gray, RGB and HSV are implemented with integer
+    arithmetic and use SSSE3 or AVX2 instructions if supported by the
+    processor (see CpuFeatures). All instruction sets produce identical
+    results, gray values are computed as (77 R + 150 G + 29 B + 128) / 256.
+
+    Source and target may use interleaved or planar layout (see
+    Image::PixelLayout). Target images keep the layout they were initialized
+    with, planar rows are interleaved on the fly. ConvertLayout() converts
+    between the layouts.
+
+    Color conversions expect 8-bit images. ConvertDepth() converts between
+    the pixel types (see Image::PixelType) with saturation, e.g. to chain
+    float operations and quantize only the final result.
+
+    Large images are converted in parallel by splitting them into bands of
+    rows, one per thread (see SetNumThreads()). Pixels are converted
+    independently, so the result does not depend on the number of threads.
+
     @author esquivel
  */
 class ColorConversion
 {
 public:
 
+  /** @brief Instruction sets used by the conversion methods */
+  enum InstructionSet { IS_Auto, IS_Scalar, IS_SSSE3, IS_AVX2 };
+
+  /** @brief Select instruction set used by the conversion methods. IS_Auto
+             selects the fastest instruction set supported by the processor,
+             which is the default. Unsupported instruction sets fall back to
+             the next supported one.
+      @return Returns the instruction set actually used. */
+  static InstructionSet SetInstructionSet(InstructionSet is);
+
+  /** @brief Returns instruction set used by the conversion methods. */
+  static InstructionSet GetInstructionSet();
+
+  /** @brief Set maximum number of threads used by the conversion methods.
+             Passing 0 uses one thread per processor core, which is the
+             default. Small images are always converted by fewer threads. */
+  static void SetNumThreads(int numThreads);
+
+  /** @brief Returns maximum number of threads used by the conversion
+             methods, i.e. the number of processor cores if set to 0. */
+  static int GetNumThreads();
+
+  /** @brief Copy image into target image with given pixel layout, i.e.
+             split interleaved channels into planes or vice versa. The
+             source image may be the target image. */
+  static void ConvertLayout(const Image &src, Image &dst, Image::PixelLayout layout);
+
+  /** @brief Copy view into target view of the same size and color model,
+             converting from the layout of the source to the layout of the
+             target view. */
+  static void ConvertLayout(const ImageView &src, const ImageView &dst);
+
+  /** @brief Copy image into target image with given pixel type, values are
+             converted as by Image::UInt8ToFloat() etc. The source image may
+             be the target image. */
+  static void ConvertDepth(const Image &src, Image &dst, Image::PixelType type);
+
+  /** @brief Copy view into target view of the same size, color model and
+             layout, converting from the pixel type of the source to the
+             pixel type of the target view. */
+  static void ConvertDepth(const ImageView &src, const ImageView &dst);
+
   /** @brief Convert RGB image to gray image. */
   static void RGBToGray(const Image &src, Image &dst);
 
+  /** @brief Convert RGB view to gray view of the same size. */
+  static void RGBToGray(const ImageView &src, const ImageView &dst);
+
   /** @brief Convert gray image to RGB image. */
   static void GrayToRGB(const Image &src, Image &dst);
 
+  /** @brief Convert gray view to RGB view of the same size. */
+  static void GrayToRGB(const ImageView &src, const ImageView &dst);
+
   /** @brief Convert RGB image to HSV image. */
   static void RGBToHSV(const Image &src, Image &dst);
 
+  /** @brief Convert RGB view to HSV view of the same size. */
+  static void RGBToHSV(const ImageView &src, const ImageView &dst);
+
   /** @brief Convert HSV image to RGB image. */
   static void HSVToRGB(const Image &src, Image &dst);
 
-  /** @brief Convert HSV image to gray image (via RGB image). */
+  /** @brief Convert HSV view to RGB view of the same size. */
+  static void HSVToRGB(const ImageView &src, const ImageView &dst);
+
+  /** @brief Convert HSV image to gray image. Computes the gray value of the
+             RGB color per pixel without an intermediate RGB image. */
   static void HSVToGray(const Image &src, Image &dst);
 
-  /** @brief Convert gray image to HSV image (via RGB image). */
+  /** @brief Convert HSV view to gray view of the same size. */
+  static void HSVToGray(const ImageView &src, const ImageView &dst);
+
+  /** @brief Convert gray image to HSV image, i.e. zero hue and saturation. */
   static void GrayToHSV(const Image &src, Image &dst);
 
+  /** @brief Convert gray view to HSV view of the same size. */
+  static void GrayToHSV(const ImageView &src, const ImageView &dst);
+
 private:
 
+  /** @brief Function converting one row of width pixels */
+  typedef void (*RowFunction_)(const unsigned char *src, unsigned char *dst,
+                               int width);
+
+  /** @brief Function applying a row function to the rows in [beginY, endY) */
+  typedef void (*BandFunction_)(const ImageView &src, const ImageView &dst,
+                                RowFunction_ function, int beginY, int endY);
+
+  /** @brief Apply row function to all rows of the source and target view,
+             split into bands converted in parallel by the band function.
+             Without row function (NULL), ConvertBand_() only converts rows
+             between planar and interleaved layout. */
+  static void ConvertRows_(const ImageView &src, const ImageView &dst,
+                           RowFunction_ function, BandFunction_ band = ConvertBand_);
+
+  /** @brief Apply row function to the rows in [beginY, endY). */
+  static void ConvertBand_(const ImageView &src, const ImageView &dst,
+                           RowFunction_ function, int beginY, int endY);
+
+  /** @brief Apply depth conversion to all values of the rows in
+             [beginY, endY), plane by plane in planar layout. */
+  static void ConvertDepthBand_(const ImageView &src, const ImageView &dst,
+                                RowFunction_ function, int beginY, int endY);
+
+  /** @brief Minimum number of pixels converted per thread */
+  static const int MIN_PIXELS_PER_THREAD = 1 << 16;
+
+  /** @brief Stores number of threads set by SetNumThreads() */
+  static std::atomic<int> numThreads_;
+
+  /** @brief Color conversion of views */
+  typedef void (*ViewFunction_)(const ImageView &src, const ImageView &dst);
+
+  /** @brief Initialize target image with given color model and convert the
+             source image with the view function, through a temporary image
+             if source and target are the same image. */
+  static void ConvertImage_(const Image &src, Image &dst, Image::ColorModel cm,
+                            int srcChannels, ViewFunction_ function, const char *method);
+
+  /** @brief Initialize target image with size of source image and given
+             color model, layout and pixel type.
+      @return Returns false if the source image is empty. */
+  static bool InitTarget_(const Image &src, Image &dst, Image::ColorModel cm,
+                          Image::PixelLayout layout,
+                          Image::PixelType type = Image::PT_UInt8);
+
+  /** @brief Check if source and target views have the same size, the
+             expected numbers of channels, 8-bit values (unless anyPixelType
+             is set) and if the target is writable.
+      @return Returns true if views can be converted. */
+  static bool CheckViews_(const ImageView &src, const ImageView &dst,
+                          int srcChannels, int dstChannels, const char *method,
+                          bool anyPixelType = false);
+
   /** @brief Constructor is private for pure static class. */
   ColorConversion();
 
@@ -0,0 +1,178 @@
+#include "ColorCube.hh"
+#include "ColorConversion.hh"
+#include <iostream>
+#include <cmath>
+
+using namespace std;
+
+ColorCube::ColorCube(int size)
+  : size_(0)
+{
+  Init(size);
+}
+
+bool ColorCube::Init(int size)
+{
+  if (size < MIN_SIZE || size > MAX_SIZE) {
+    cerr << "ColorCube::Init() : Invalid size!" << endl;
+    return false;
+  }
+  size_ = size;
+  entries_.resize(3 * size * size * size);
+  // Cell index and fraction, the last value lies in the last cell
+  for (int v = 0; v < 256; v++) {
+    int pos = v * (size - 1);
+    index_[v] = pos / 255;
+    fraction_[v] = pos % 255;
+    if (index_[v] == size - 1) {
+      index_[v]--;
+      fraction_[v] = 255;
+    }
+  }
+  SetIdentity();
+  return true;
+}
+
+int ColorCube::GetSize() const
+{
+  return size_;
+}
+
+void ColorCube::SetIdentity()
+{
+  for (int r = 0; r < size_; r++)
+    for (int g = 0; g < size_; g++)
+      for (int b = 0; b < size_; b++) {
+        unsigned char *entry = &entries_[GetOffset_(r, g, b)];
+        entry[0] = (unsigned char)((r * 255 + (size_ - 1) / 2) / (size_ - 1));
+        entry[1] = (unsigned char)((g * 255 + (size_ - 1) / 2) / (size_ - 1));
+        entry[2] = (unsigned char)((b * 255 + (size_ - 1) / 2) / (size_ - 1));
+      }
+}
+
+void ColorCube::SetEntry(int r, int g, int b, const Color &color)
+{
+  if (r < 0 || g < 0 || b < 0 || r >= size_ || g >= size_ || b >= size_) {
+    cerr << "ColorCube::SetEntry() : Invalid grid point!" << endl;
+    return;
+  }
+  unsigned char *entry = &entries_[GetOffset_(r, g, b)];
+  entry[0] = color.red;
+  entry[1] = color.green;
+  entry[2] = color.blue;
+}
+
+Color ColorCube::GetEntry(int r, int g, int b) const
+{
+  if (r < 0 || g < 0 || b < 0 || r >= size_ || g >= size_ || b >= size_) {
+    cerr << "ColorCube::GetEntry() : Invalid grid point!" << endl;
+    return Color();
+  }
+  const unsigned char *entry = &entries_[GetOffset_(r, g, b)];
+  return Color(entry[0], entry[1], entry[2]);
+}
+
+void ColorCube::SetHSVAdjustment(int hueShift, double saturationScale, double valueScale)
+{
+  // Convert all entries at once, the cube is stored as RGB image row
+  int numEntries = size_ * size_ * size_;
+  ImageView entries(&entries_[0], numEntries, 1, 3 * numEntries, Image::CM_RGB, false);
+  Image hsv(numEntries, 1, Image::CM_HSV);
+  ColorConversion::RGBToHSV(entries, ImageView(hsv));
+  LookupTable lut;
+  lut.SetLinear(saturationScale, 0.0, 1);
+  lut.SetLinear(valueScale, 0.0, 2);
+  unsigned char hue[256];
+  for (int i = 0; i < 256; i++)
+    hue[i] = (unsigned char)((i + hueShift) & 255);
+  lut.SetTable(hue, 0);
+  lut.Apply(hsv, hsv);
+  ColorConversion::HSVToRGB(ImageView(hsv), entries);
+}
+
+void ColorCube::Append(const LookupTable &lut)
+{
+  int numEntries = size_ * size_ * size_;
+  lut.Apply(ImageView(&entries_[0], numEntries, 1, 3 * numEntries, Image::CM_RGB, false),
+            ImageView(&entries_[0], numEntries, 1, 3 * numEntries, Image::CM_RGB, false));
+}
+
+bool ColorCube::Apply(const Image &src, Image &dst) const
+{
+  if (src.GetColorModel() != Image::CM_RGB) {
+    cerr << "ColorCube::Apply() : Source image is no RGB image!" << endl;
+    return false;
+  }
+  if (&src != &dst) {
+    dst.Init(src.GetWidth(), src.GetHeight(), Image::CM_RGB, dst.GetRowAlignment(),
+             src.GetLayout());
+    if (dst.IsEmpty())
+      return false;
+  }
+  return Apply(ImageView(src), ImageView(dst));
+}
+
+bool ColorCube::Apply(const ImageView &src, const ImageView &dst) const
+{
+  if (src.IsEmpty() || src.GetWidth() != dst.GetWidth() ||
+      src.GetHeight() != dst.GetHeight()) {
+    cerr << "ColorCube::Apply() : Invalid image size!" << endl;
+    return false;
+  }
+  if (src.GetChannels() != 3 || dst.GetChannels() != 3) {
+    cerr << "ColorCube::Apply() : Invalid number of channels!" << endl;
+    return false;
+  }
+  if (src.GetPixelType() != Image::PT_UInt8 || dst.GetPixelType() != Image::PT_UInt8) {
+    cerr << "ColorCube::Apply() : Only 8-bit images are supported!" << endl;
+    return false;
+  }
+  if (dst.IsReadOnly()) {
+    cerr << "ColorCube::Apply() : Target image is read-only!" << endl;
+    return false;
+  }
+  // Offsets of the two inner corners of the tetrahedron containing a color,
+  // indexed by the order of its fractions (see below)
+  const int dr = 3 * size_ * size_, dg = 3 * size_, db = 3;
+  const int corners[8][2] = {
+    { db, dg + db }, { db, dr + db }, { dg, dg + db }, { dr, dr + dg },
+    { dg, dr + dg }, { dr, dr + db }, { dg, dr + dg }, { dr, dr + dg }
+  };
+  const unsigned char *entries = &entries_[0];
+  // Channels are accessed via plane rows to support both layouts
+  int srcStep = src.IsPlanar() ? 1 : 3, dstStep = dst.IsPlanar() ? 1 : 3;
+  for (int y = 0; y < src.GetHeight(); y++) {
+    const unsigned char *s0 = src.GetPlaneRow(0, y), *s1 = src.GetPlaneRow(1, y),
+                        *s2 = src.GetPlaneRow(2, y);
+    unsigned char *d0 = dst.GetPlaneRow(0, y), *d1 = dst.GetPlaneRow(1, y),
+                  *d2 = dst.GetPlaneRow(2, y);
+    for (int x = 0, i = 0, j = 0; x < src.GetWidth(); x++, i += srcStep, j += dstStep) {
+      int r = s0[i], g = s1[i], b = s2[i];
+      int fr = fraction_[r], fg = fraction_[g], fb = fraction_[b];
+      const unsigned char *c000 = entries + index_[r] * dr + index_[g] * dg +
+                                  index_[b] * db;
+      // Tetrahedral interpolation between c000, c111 and the corners along
+      // the largest and the two largest fractions
+      int order = (fr >= fg) | ((fg >= fb) << 1) | ((fr >= fb) << 2);
+      int hi = fr > fg ? fr : fg, lo = fr < fg ? fr : fg;
+      hi = hi > fb ? hi : fb;
+      lo = lo < fb ? lo : fb;
+      int mid = fr + fg + fb - hi - lo;
+      int w0 = 255 - hi, w1 = hi - mid, w2 = mid - lo;
+      const unsigned char *c1 = c000 + corners[order][0], *c2 = c000 + corners[order][1];
+      const unsigned char *c111 = c000 + dr + dg + db;
+      d0[j] = (unsigned char)((w0 * c000[0] + w1 * c1[0] + w2 * c2[0] +
+                               lo * c111[0] + 127) / 255);
+      d1[j] = (unsigned char)((w0 * c000[1] + w1 * c1[1] + w2 * c2[1] +
+                               lo * c111[1] + 127) / 255);
+      d2[j] = (unsigned char)((w0 * c000[2] + w1 * c1[2] + w2 * c2[2] +
+                               lo * c111[2] + 127) / 255);
+    }
+  }
+  return true;
+}
+
+int ColorCube::GetOffset_(int r, int g, int b) const
+{
+  return 3 * ((r * size_ + g) * size_ + b);
+}
@@ -0,0 +1,79 @@
+#ifndef __ColorCube_hh__
+#define __ColorCube_hh__
+
+#include "Image.hh"
+#include "ImageView.hh"
+#include "LookupTable.hh"
+#include <vector>
+
+/** @class ColorCube
+    @brief Three-dimensional color lookup table mapping RGB colors to RGB
+           colors, e.g. for color grading or HSV adjustments of RGB images.
+
+    The cube stores size^3 entries on a regular grid over the RGB cube,
+    colors between grid points are interpolated tetrahedrally in integer
+    arithmetic. Grid points map exactly to 8-bit values if size - 1 divides
+    255 (e.g. sizes 16, 18 or 52), so the identity cube then reproduces the
+    input exactly.
+ */
+class ColorCube
+{
+public:
+
+  /** @brief Minimum and maximum size of the cube */
+  static const int MIN_SIZE = 2, MAX_SIZE = 86;
+
+  /** @brief Create identity cube with given size. */
+  ColorCube(int size = 18);
+
+  /** @brief Initialize identity cube with given size.
+      @return Returns false if the size is invalid. */
+  bool Init(int size);
+
+  /** @brief Returns number of grid points per dimension. */
+  int GetSize() const;
+
+  /** @brief Set all entries to identity. */
+  void SetIdentity();
+
+  /** @brief Set RGB entry for grid point (r, g, b), 0 <= r, g, b < size. */
+  void SetEntry(int r, int g, int b, const Color &color);
+
+  /** @brief Returns RGB entry for grid point (r, g, b). */
+  Color GetEntry(int r, int g, int b) const;
+
+  /** @brief Adjust entries in HSV space: add hueShift to hue (in units of
+             360 / 256 degrees) and scale saturation and value. */
+  void SetHSVAdjustment(int hueShift, double saturationScale, double valueScale);
+
+  /** @brief Apply lookup table to all entries, i.e. after the cube. */
+  void Append(const LookupTable &lut);
+
+  /** @brief Apply cube to RGB source image and store result in target image
+             (which may be the source image itself) with the same layout.
+      @return Returns false if the source image is no RGB image. */
+  bool Apply(const Image &src, Image &dst) const;
+
+  /** @brief Apply cube to RGB source view and store result in RGB target
+             view of the same size (which may be the same view). The views
+             may use different layouts, but must be 8-bit views.
+      @return Returns false if the views do not match. */
+  bool Apply(const ImageView &src, const ImageView &dst) const;
+
+private:
+
+  /** @brief Returns offset of grid point (r, g, b) in entries. */
+  int GetOffset_(int r, int g, int b) const;
+
+  /** @brief Number of grid points per dimension */
+  int size_;
+
+  /** @brief RGB entries, blue index runs fastest */
+  std::vector<unsigned char> entries_;
+
+  /** @brief Grid index and fraction (in 1/255) per 8-bit value */
+  int index_[256], fraction_[256];
+
+};
+
+#endif // __ColorCube_hh__
@@ -0,0 +1,45 @@
+#include "CpuFeatures.hh"
+
+#if defined(SIMD_X86) && defined(_MSC_VER)
+#  include <intrin.h>
+#  include <immintrin.h>
+#endif
+
+CpuFeatures::CpuFeatures()
+  : ssse3_(false), avx2_(false)
+{
+#if defined(SIMD_X86) && defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  int maxLeaf = info[0];
+  __cpuid(info, 1);
+  ssse3_ = (info[2] & (1 << 9)) != 0;
+  // AVX2 needs OSXSAVE and the OS saving the YMM registers
+  bool osAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) &&
+               (_xgetbv(0) & 0x6) == 0x6;
+  if (osAvx && maxLeaf >= 7) {
+    __cpuidex(info, 7, 0);
+    avx2_ = (info[1] & (1 << 5)) != 0;
+  }
+#elif defined(SIMD_X86)
+  __builtin_cpu_init();
+  ssse3_ = __builtin_cpu_supports("ssse3") != 0;
+  avx2_ = __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+const CpuFeatures &CpuFeatures::Get_()
+{
+  static const CpuFeatures features;
+  return features;
+}
+
+bool CpuFeatures::HasSSSE3()
+{
+  return Get_().ssse3_;
+}
+
+bool CpuFeatures::HasAVX2()
+{
+  return Get_().avx2_;
+}
@@ -0,0 +1,55 @@
+#ifndef __CpuFeatures_hh__
+#define __CpuFeatures_hh__
+
+/** @def SIMD_X86
+    @brief Defined if SIMD code paths for x86 processors are compiled,
+           i.e. if building with USE_SIMD for an x86 or x86-64 target.
+
+    SIMD code is compiled for the instruction sets given by SIMD_TARGET_SSSE3
+    and SIMD_TARGET_AVX2 regardless of the compiler flags, so it must only
+    be called if the processor supports it (see CpuFeatures). */
+#if defined(BUILD_WITH_SIMD) && (defined(__x86_64__) || defined(__i386__) || \
+                                 defined(_M_X64) || defined(_M_IX86))
+#  define SIMD_X86
+#  if defined(__GNUC__) || defined(__clang__)
+#    define SIMD_TARGET_SSSE3 __attribute__((target("ssse3")))
+#    define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#  else
+#    define SIMD_TARGET_SSSE3
+#    define SIMD_TARGET_AVX2
+#  endif
+#endif
+
+/** @class CpuFeatures
+    @brief Abstract class containing static methods to query the instruction
+           sets supported by the processor at runtime. Used to select SIMD
+           code paths, e.g. in ColorConversion.
+
+    All methods return false if SIMD code paths are not compiled (see
+    SIMD_X86), so callers fall back to their scalar implementation.
+ */
+class CpuFeatures
+{
+public:
+
+  /** @brief Returns true if SSSE3 instructions are supported. */
+  static bool HasSSSE3();
+
+  /** @brief Returns true if AVX2 instructions are supported (by the
+             processor and the operating system). */
+  static bool HasAVX2();
+
+private:
+
+  /** @brief Detect features once, thread-safe. */
+  static const CpuFeatures &Get_();
+
+  /** @brief Constructor detects supported instruction sets. */
+  CpuFeatures();
+
+  /** @brief Supported instruction sets */
+  bool ssse3_, avx2_;
+
+};
+
+#endif // __CpuFeatures_hh__
@@ -1,4 +1,5 @@
 #include "GuiBase.hh"
+#include "ColorConversion.hh"
 #include <GL/glut.h>
 #include <iostream>
 #include <cstring>
@@ -77,6 +78,13 @@ void GuiBase::GetMousePosition(int &x, int &y)
 
 void GuiBase::SetImage(const Image &image)
 {
+  // Textures are created from 8-bit values, convert other pixel types
+  if (image.GetPixelType() != Image::PT_UInt8) {
+    Image tmp;
+    ColorConversion::ConvertDepth(image, tmp, Image::PT_UInt8);
+    SetImage(tmp);
+    return;
+  }
   // Create texture
   if (textureId_ == 0) {
     GLuint texId = 0;
@@ -96,6 +104,7 @@ void GuiBase::SetImage(const Image &image)
   // Copy image data to texture
   if (textureId_ > 0) {
     glBindTexture(GL_TEXTURE_2D, (GLuint)textureId_);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // rows are addressed via stride
     int w = image.GetWidth(), h = image.GetHeight();
     if (image.IsEmpty()) {
       // Image is empty, fill texture with black
@@ -107,18 +116,39 @@ void GuiBase::SetImage(const Image &image)
     } else if (image.GetColorModel() == Image::CM_Gray) {
       // Image has gray values, convert to RGB texture data
       unsigned char *tmpData = new unsigned char[w*h*3];
-      const unsigned char *srcPtr = image.GetData();
       unsigned char *dstPtr = tmpData;
-      for (int i = 0; i < w * h; i++, srcPtr++, dstPtr += 3) {
-        dstPtr[0] = *srcPtr; dstPtr[1] = *srcPtr; dstPtr[2] = *srcPtr;
+      for (int y = 0; y < h; y++) {
+        const unsigned char *srcPtr = image.GetRow(y);
+        for (int x = 0; x < w; x++, srcPtr++, dstPtr += 3) {
+          dstPtr[0] = *srcPtr; dstPtr[1] = *srcPtr; dstPtr[2] = *srcPtr;
+        }
       }
       glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w, h,
                    0, GL_RGB, GL_UNSIGNED_BYTE, tmpData);
       delete[] tmpData;
-    } else {
+    } else if (image.IsPlanar()) {
+      // Image has color planes, interleave into packed RGB texture data
+      unsigned char *tmpData = new unsigned char[w*h*3];
+      ColorConversion::ConvertLayout(ImageView(image),
+                                     ImageView(tmpData, w, h, w*3, image.GetColorModel()));
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w, h,
+                   0, GL_RGB, GL_UNSIGNED_BYTE, tmpData);
+      delete[] tmpData;
+    } else if (image.GetStride() % 3 == 0) {
       // Image has color values, assume that image is already in RGB format
-      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.GetWidth(), image.GetHeight(),
+      // and let OpenGL skip the row padding
+      glPixelStorei(GL_UNPACK_ROW_LENGTH, image.GetStride() / 3);
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w, h,
                    0, GL_RGB, GL_UNSIGNED_BYTE, image.GetData());
+      glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    } else {
+      // Row padding is no multiple of the pixel size, copy packed rows
+      unsigned char *tmpData = new unsigned char[w*h*3];
+      for (int y = 0; y < h; y++)
+        memcpy(tmpData + y*w*3, image.GetRow(y), w*3);
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w, h,
+                   0, GL_RGB, GL_UNSIGNED_BYTE, tmpData);
+      delete[] tmpData;
     }
     glBindTexture(GL_TEXTURE_2D, 0);
     //glutPostRedisplay();
@@ -1,9 +1,11 @@
 #include "Image.hh"
 #include <iostream>
+#include <climits>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <utility>
 
 #define RINT(x)      (int)(x + 0.5f)
 #define CLAMP(x,a,b) (((x) < (a)) ? (a) : (((x) > (b)) ? (b) : (x)))
@@ -11,28 +13,60 @@
 using namespace std;
 
 Image::Image()
-  : width_(0), height_(0), channels_(0), data_(NULL), colorModel_(CM_None)
+  : width_(0), height_(0), channels_(0), data_(NULL), colorModel_(CM_None),
+    stride_(0), rowAlignment_(1), layout_(PL_Interleaved), planeStride_(0),
+    pixelType_(PT_UInt8), valueSize_(1),
+    buffer_(NULL), bufferSize_(0),
+    allocator_(ImageAllocator::GetDefault()),
+    ownershipMode_(OM_Owned), readOnly_(false),
+    releaseCallback_(NULL), releaseContext_(NULL)
 {
 }
 
-Image::Image(int w, int h, ColorModel cm)
-  : width_(0), height_(0), channels_(0), data_(NULL), colorModel_(CM_None)
+Image::Image(int w, int h, ColorModel cm, int rowAlignment, PixelLayout layout,
+             PixelType type)
+  : width_(0), height_(0), channels_(0), data_(NULL), colorModel_(CM_None),
+    stride_(0), rowAlignment_(1), layout_(PL_Interleaved), planeStride_(0),
+    pixelType_(PT_UInt8), valueSize_(1),
+    buffer_(NULL), bufferSize_(0),
+    allocator_(ImageAllocator::GetDefault()),
+    ownershipMode_(OM_Owned), readOnly_(false),
+    releaseCallback_(NULL), releaseContext_(NULL)
 {
-  Init(w, h, cm);
+  Init(w, h, cm, rowAlignment, layout, type);
 }
 
 Image::Image(const Image &img)
-  : width_(0), height_(0), channels_(0), data_(NULL), colorModel_(CM_None)
+  : width_(0), height_(0), channels_(0), data_(NULL), colorModel_(CM_None),
+    stride_(0), rowAlignment_(1), layout_(PL_Interleaved), planeStride_(0),
+    pixelType_(PT_UInt8), valueSize_(1),
+    buffer_(NULL), bufferSize_(0),
+    allocator_(ImageAllocator::GetDefault()),
+    ownershipMode_(OM_Owned), readOnly_(false),
+    releaseCallback_(NULL), releaseContext_(NULL)
 {
   *this = img;
 }
 
+Image::Image(Image &&img)
+  : width_(0), height_(0), channels_(0), data_(NULL), colorModel_(CM_None),
+    stride_(0), rowAlignment_(1), layout_(PL_Interleaved), planeStride_(0),
+    pixelType_(PT_UInt8), valueSize_(1),
+    buffer_(NULL), bufferSize_(0),
+    allocator_(ImageAllocator::GetDefault()),
+    ownershipMode_(OM_Owned), readOnly_(false),
+    releaseCallback_(NULL), releaseContext_(NULL)
+{
+  Swap(img);
+}
+
 Image::~Image()
 {
   Release();
 }
 
-void Image::Init(int w, int h, ColorModel cm)
+void Image::Init(int w, int h, ColorModel cm, int rowAlignment, PixelLayout layout,
+                 PixelType type)
 {
   // Check if size is valid
   if (w <= 0 || h <= 0 || cm == CM_None) {
@@ -40,53 +74,270 @@ void Image::Init(int w, int h, ColorModel cm)
     Release();
     return;
   }
-  // Allocate memory (release already allocated memory if needed)
+  // Check if row alignment is a power of two
+  if (rowAlignment <= 0 || rowAlignment > 4096 ||
+      (rowAlignment & (rowAlignment - 1)) != 0) {
+    cerr << "Image::Init() : Row alignment must be a power of two!" << endl;
+    Release();
+    return;
+  }
+  // Align values of wider pixel types at least to their size
+  int valueSize = GetBytesPerValue(type);
+  if (rowAlignment < valueSize)
+    rowAlignment = valueSize;
+  // Allocate memory (reuse already allocated memory if it is large enough)
   int channels = (cm == CM_Gray) ? 1 : 3;
-  int numBytes = w * h * channels;
-  if (data_ == NULL) {
-    data_ = new unsigned char[numBytes];
-  } else if (GetNumBytes() != numBytes) {
-    delete[] data_;
-    data_ = new unsigned char[numBytes];
+  long long maxRowBytes = ((long long)w * valueSize + rowAlignment) * channels;
+  if (maxRowBytes * h > INT_MAX) {
+    cerr << "Image::Init() : Image size exceeds the maximum size!" << endl;
+    Release();
+    return;
+  }
+  int rowBytes = ((layout == PL_Planar) ? w : w * channels) * valueSize;
+  int stride = ((rowBytes + rowAlignment - 1) / rowAlignment) * rowAlignment;
+  int planeStride = (layout == PL_Planar) ? stride * h : 0;
+  int numBytes = (layout == PL_Planar) ? planeStride * channels : stride * h;
+  if (ownershipMode_ == OM_External)
+    Release();
+  if (!AlignData_(numBytes, rowAlignment)) {
+    ReleaseData_();
+    AllocateData_(numBytes, rowAlignment);
+    if (data_ == NULL) {
+      cerr << "Image::Init() : Failed to allocate image data!" << endl;
+      Release();
+      return;
+    }
   }
   width_ = w;
   height_ = h;
   channels_ = channels;
   colorModel_ = cm;
+  stride_ = stride;
+  rowAlignment_ = rowAlignment;
+  layout_ = layout;
+  planeStride_ = planeStride;
+  pixelType_ = type;
+  valueSize_ = valueSize;
   memset(data_, 0, numBytes);
 }
 
 void Image::Clear(unsigned char value)
 {
-  if (data_ != NULL)
+  if (data_ == NULL)
+    return;
+  if (readOnly_)
+    return;
+  if (pixelType_ == PT_UInt8) {
     memset(data_, value, GetNumBytes());
+    return;
+  }
+  // Fill first row with the converted value and copy it to all other rows
+  int numRows = (layout_ == PL_Planar) ? height_ * channels_ : height_;
+  int numValues = (layout_ == PL_Planar) ? width_ : width_ * channels_;
+  for (int i = 0; i < numValues; i++)
+    WriteUInt8(data_ + i * valueSize_, pixelType_, value);
+  for (int y = 1; y < numRows; y++)
+    memcpy(data_ + y * stride_, data_, numValues * valueSize_);
 }
 
 void Image::Clear(const Color &color)
 {
+  if (readOnly_)
+    return;
   if (colorModel_ == CM_Gray) {
     Clear(color.red);
+  } else if (data_ != NULL && pixelType_ != PT_UInt8) {
+    // Fill first row of each plane (or first row) and copy it to all rows
+    int numPlanes = (layout_ == PL_Planar) ? 3 : 1;
+    int numValues = (layout_ == PL_Planar) ? width_ : width_ * 3;
+    const unsigned char values[3] = { color.red, color.green, color.blue };
+    for (int c = 0; c < numPlanes; c++) {
+      unsigned char *d = GetPlaneRow(c, 0);
+      for (int i = 0; i < numValues; i++)
+        WriteUInt8(d + i * valueSize_, pixelType_,
+                   (numPlanes == 3) ? values[c] : values[i % 3]);
+      for (int y = 1; y < height_; y++)
+        memcpy(GetPlaneRow(c, y), d, numValues * valueSize_);
+    }
+  } else if (data_ != NULL && layout_ == PL_Planar) {
+    memset(data_, color.red, planeStride_);
+    memset(data_ + planeStride_, color.green, planeStride_);
+    memset(data_ + 2 * planeStride_, color.blue, planeStride_);
   } else if (data_ != NULL) {
-    unsigned char *d = data_;
-    for (int i = 0; i < width_*height_; i++, d += 3) {
-      d[0] = color.red;
-      d[1] = color.green;
-      d[2] = color.blue;
+    for (int y = 0; y < height_; y++) {
+      unsigned char *d = GetRow(y);
+      for (int x = 0; x < width_; x++, d += 3) {
+        d[0] = color.red;
+        d[1] = color.green;
+        d[2] = color.blue;
+      }
     }
   }
 }
 
 void Image::Release()
 {
-  // Release allocated memory
-  if (data_ != NULL)
-    delete[] data_;
+  // Release allocated memory or hand external data back to its owner
+  if (ownershipMode_ == OM_External) {
+    if (releaseCallback_ != NULL)
+      releaseCallback_(data_, releaseContext_);
+  } else {
+    ReleaseData_();
+  }
   // Reset image parameters
   width_ = 0;
   height_ = 0;
   channels_ = 0;
   data_ = NULL;
   colorModel_ = CM_None;
+  stride_ = 0;
+  rowAlignment_ = 1;
+  layout_ = PL_Interleaved;
+  planeStride_ = 0;
+  pixelType_ = PT_UInt8;
+  valueSize_ = 1;
+  buffer_ = NULL;
+  bufferSize_ = 0;
+  ownershipMode_ = OM_Owned;
+  readOnly_ = false;
+  releaseCallback_ = NULL;
+  releaseContext_ = NULL;
+}
+
+void Image::Reserve(int numBytes)
+{
+  if (ownershipMode_ == OM_External || GetCapacity() >= numBytes)
+    return;
+  // Allocate larger buffer and copy current image data
+  unsigned char *oldBuffer = buffer_, *oldData = data_;
+  int oldNumBytes = GetNumBytes();
+  int oldBufferSize = bufferSize_;
+  AllocateData_(numBytes, rowAlignment_);
+  if (data_ == NULL) {
+    // Keep current data if allocation failed
+    cerr << "Image::Reserve() : Failed to allocate image data!" << endl;
+    buffer_ = oldBuffer;
+    bufferSize_ = oldBufferSize;
+    data_ = oldData;
+    return;
+  }
+  if (oldData != NULL)
+    memcpy(data_, oldData, oldNumBytes);
+  else
+    data_ = NULL; // image stays empty until Init() is called
+  if (oldBuffer != NULL)
+    allocator_->Deallocate(oldBuffer, oldBufferSize);
+}
+
+int Image::GetCapacity() const
+{
+  if (ownershipMode_ == OM_External)
+    return GetNumBytes();
+  if (buffer_ == NULL)
+    return 0;
+  size_t offset = (size_t)buffer_ & (size_t)(rowAlignment_ - 1);
+  return (offset == 0) ? bufferSize_ : bufferSize_ - (int)(rowAlignment_ - offset);
+}
+
+void Image::Swap(Image &img)
+{
+  std::swap(width_, img.width_);
+  std::swap(height_, img.height_);
+  std::swap(channels_, img.channels_);
+  std::swap(data_, img.data_);
+  std::swap(colorModel_, img.colorModel_);
+  std::swap(stride_, img.stride_);
+  std::swap(rowAlignment_, img.rowAlignment_);
+  std::swap(layout_, img.layout_);
+  std::swap(planeStride_, img.planeStride_);
+  std::swap(pixelType_, img.pixelType_);
+  std::swap(valueSize_, img.valueSize_);
+  std::swap(buffer_, img.buffer_);
+  std::swap(bufferSize_, img.bufferSize_);
+  std::swap(allocator_, img.allocator_);
+  std::swap(ownershipMode_, img.ownershipMode_);
+  std::swap(readOnly_, img.readOnly_);
+  std::swap(releaseCallback_, img.releaseCallback_);
+  std::swap(releaseContext_, img.releaseContext_);
+}
+
+void Image::SetAllocator(ImageAllocator *allocator)
+{
+  if (allocator == NULL)
+    allocator = ImageAllocator::GetDefault();
+  if (allocator == allocator_)
+    return;
+  if (ownershipMode_ == OM_External || data_ == NULL) {
+    // Release unused memory with previous allocator
+    if (data_ == NULL)
+      ReleaseData_();
+    allocator_ = allocator;
+    return;
+  }
+  // Move image data into memory of the new allocator
+  Image tmp;
+  tmp.allocator_ = allocator;
+  tmp = *this;
+  Swap(tmp);
+}
+
+ImageAllocator *Image::GetAllocator() const
+{
+  return allocator_;
+}
+
+void Image::Attach(int w, int h, ColorModel cm, unsigned char *data,
+                   ReleaseCallback release, void *context, bool readOnly,
+                   int stride, PixelType type)
+{
+  // Release current data first, also if it is external
+  Release();
+  // Check if size and data are valid
+  int channels = (cm == CM_Gray) ? 1 : 3;
+  int valueSize = GetBytesPerValue(type);
+  if (stride == 0)
+    stride = w * channels * valueSize;
+  if (w <= 0 || h <= 0 || cm == CM_None || data == NULL ||
+      stride < w * channels * valueSize || stride % valueSize != 0 ||
+      (size_t)data % (size_t)valueSize != 0) {
+    cerr << "Image::Attach() : Invalid image size, color model or data!" << endl;
+    if (release != NULL)
+      release(data, context);
+    return;
+  }
+  width_ = w;
+  height_ = h;
+  channels_ = channels;
+  data_ = data;
+  colorModel_ = cm;
+  stride_ = stride;
+  rowAlignment_ = valueSize;
+  pixelType_ = type;
+  valueSize_ = valueSize;
+  ownershipMode_ = OM_External;
+  readOnly_ = readOnly;
+  releaseCallback_ = release;
+  releaseContext_ = context;
+}
+
+void Image::Detach()
+{
+  if (ownershipMode_ == OM_Owned)
+    return;
+  // Copy external data into own buffer, the external data is released
+  // when tmp is destroyed
+  Image tmp(*this);
+  Swap(tmp);
+}
+
+Image::OwnershipMode Image::GetOwnershipMode() const
+{
+  return ownershipMode_;
+}
+
+bool Image::IsReadOnly() const
+{
+  return readOnly_;
 }
 
 bool Image::IsEmpty() const
@@ -122,7 +373,52 @@ int Image::GetChannels() const
 
 int Image::GetNumBytes() const
 {
-  return width_ * height_ * channels_;
+  return (layout_ == PL_Planar) ? planeStride_ * channels_ : stride_ * height_;
+}
+
+int Image::GetStride() const
+{
+  return stride_;
+}
+
+Image::PixelLayout Image::GetLayout() const
+{
+  return layout_;
+}
+
+bool Image::IsPlanar() const
+{
+  return layout_ == PL_Planar;
+}
+
+int Image::GetPlaneStride() const
+{
+  return planeStride_;
+}
+
+Image::PixelType Image::GetPixelType() const
+{
+  return pixelType_;
+}
+
+int Image::GetBytesPerValue() const
+{
+  return valueSize_;
+}
+
+int Image::GetBytesPerValue(PixelType type)
+{
+  return (type == PT_Float) ? 4 : ((type == PT_UInt16) ? 2 : 1);
+}
+
+int Image::GetRowAlignment() const
+{
+  return rowAlignment_;
+}
+
+bool Image::IsContiguous() const
+{
+  return stride_ == ((layout_ == PL_Planar) ? width_ : width_ * channels_) * valueSize_;
 }
 
 const unsigned char *Image::GetData() const
@@ -142,25 +438,38 @@ Image::ColorModel Image::GetColorModel() const
 
 Image& Image::operator=(const Image &src)
 {
+  if (this == &src)
+    return *this;
   if (src.data_ != NULL) {
-    int numBytes = src.GetNumBytes();
-    if (data_ == NULL) {
-      data_ = new unsigned char[numBytes];
-    } else if (GetNumBytes() != numBytes) {
-      delete[] data_;
-      data_ = new unsigned char[numBytes];
+    // Create image with same size, color model, row alignment, layout and
+    // pixel type
+    Init(src.width_, src.height_, src.colorModel_, src.rowAlignment_, src.layout_,
+         src.pixelType_);
+    if (data_ == NULL)
+      return *this;
+    // Copy rows (source rows may be padded differently if src is external)
+    if (stride_ == src.stride_) {
+      memcpy(data_, src.data_, GetNumBytes());
+    } else {
+      int rowBytes = width_ * channels_ * valueSize_;
+      for (int y = 0; y < height_; y++)
+        memcpy(GetRow(y), src.GetRow(y), rowBytes);
     }
-    width_ = src.width_;
-    height_ = src.height_;
-    channels_ = src.channels_;
-    colorModel_ = src.colorModel_;
-    memcpy(data_, src.data_, numBytes);
   } else {
     Release();
   }
   return *this;
 }
 
+Image& Image::operator=(Image &&src)
+{
+  if (this != &src) {
+    Release();
+    Swap(src);
+  }
+  return *this;
+}
+
 unsigned char Image::GetPixel(int x, int y, int ch, bool check) const
 {
   if (check) {
@@ -168,7 +477,9 @@ unsigned char Image::GetPixel(int x, int y, int ch, bool check) const
     if (x < 0) x = 0; else if (x >= width_) x = width_-1;
     if (y < 0) y = 0; else if (y >= height_) y = height_-1;
   }
-  return data_[(y*width_ + x)*channels_ + ch];
+  if (pixelType_ == PT_UInt8)
+    return data_[GetOffset_(x, y, ch)];
+  return ReadUInt8(&data_[GetOffset_(x, y, ch)], pixelType_);
 }
 
 void Image::GetPixel(int x, int y, Color &color, bool check) const
@@ -178,33 +489,160 @@ void Image::GetPixel(int x, int y, Color &color, bool check) const
     if (x < 0) x = 0; else if (x >= width_) x = width_-1;
     if (y < 0) y = 0; else if (y >= height_) y = height_-1;
   }
-  unsigned char *d = &data_[(y*width_ + x)*channels_];
-  if (colorModel_ == CM_Gray)
-    color.Set(*d, *d, *d);
+  const unsigned char *d = &data_[GetOffset_(x, y, 0)];
+  if (colorModel_ == CM_Gray) {
+    unsigned char v = ReadUInt8(d, pixelType_);
+    color.Set(v, v, v);
+  } else if (pixelType_ != PT_UInt8) {
+    int step = (layout_ == PL_Planar) ? planeStride_ : valueSize_;
+    color.Set(ReadUInt8(d, pixelType_), ReadUInt8(d + step, pixelType_),
+              ReadUInt8(d + 2 * step, pixelType_));
+  } else if (layout_ == PL_Planar)
+    color.Set(d[0], d[planeStride_], d[2 * planeStride_]);
   else
     color.Set(d[0], d[1], d[2]);
 }
 
 void Image::SetPixel(int x, int y, int ch, unsigned char value, bool check)
 {
+  if (readOnly_)
+    return;
   if (check) {
     if (x < 0 || x >= width_ || y < 0 || y >= height_) return;
   }
-  data_[(y*width_ + x)*channels_ + ch] = value;
+  if (pixelType_ == PT_UInt8)
+    data_[GetOffset_(x, y, ch)] = value;
+  else
+    WriteUInt8(&data_[GetOffset_(x, y, ch)], pixelType_, value);
 }
 
 void Image::SetPixel(int x, int y, const Color &color, bool check)
 {
+  if (readOnly_)
+    return;
   if (check) {
     if (x < 0 || x >= width_ || y < 0 || y >= height_) return;
   }
-  unsigned char *d = &data_[(y*width_ + x)*channels_];
+  unsigned char *d = &data_[GetOffset_(x, y, 0)];
   if (colorModel_ == CM_Gray)
-    *d = color.red; // set only 1-st channel for gray images
-  else {
+    WriteUInt8(d, pixelType_, color.red); // set only 1-st channel for gray images
+  else if (pixelType_ != PT_UInt8) {
+    int step = (layout_ == PL_Planar) ? planeStride_ : valueSize_;
+    WriteUInt8(d, pixelType_, color.red);
+    WriteUInt8(d + step, pixelType_, color.green);
+    WriteUInt8(d + 2 * step, pixelType_, color.blue);
+  } else if (layout_ == PL_Planar) {
+    d[0] = color.red;
+    d[planeStride_] = color.green;
+    d[2 * planeStride_] = color.blue;
+  } else {
     d[0] = color.red;
     d[1] = color.green;
     d[2] = color.blue;
   }
 }
 
+float Image::GetValue(int x, int y, int ch, bool check) const
+{
+  if (check) {
+    if (data_ == NULL) return 0.0f;
+    if (x < 0) x = 0; else if (x >= width_) x = width_-1;
+    if (y < 0) y = 0; else if (y >= height_) y = height_-1;
+  }
+  return ReadFloat(&data_[GetOffset_(x, y, ch)], pixelType_);
+}
+
+void Image::SetValue(int x, int y, int ch, float value, bool check)
+{
+  if (readOnly_)
+    return;
+  if (check) {
+    if (x < 0 || x >= width_ || y < 0 || y >= height_) return;
+  }
+  WriteFloat(&data_[GetOffset_(x, y, ch)], pixelType_, value);
+}
+
+unsigned char Image::ReadUInt8(const unsigned char *p, PixelType type)
+{
+  switch (type) {
+    case PT_UInt16:
+      return UInt16ToUInt8(*(const unsigned short*)p);
+    case PT_Float:
+      return FloatToUInt8(*(const float*)p);
+    default:
+      return *p;
+  }
+}
+
+void Image::WriteUInt8(unsigned char *p, PixelType type, unsigned char value)
+{
+  switch (type) {
+    case PT_UInt16:
+      *(unsigned short*)p = UInt8ToUInt16(value);
+      break;
+    case PT_Float:
+      *(float*)p = UInt8ToFloat(value);
+      break;
+    default:
+      *p = value;
+  }
+}
+
+float Image::ReadFloat(const unsigned char *p, PixelType type)
+{
+  switch (type) {
+    case PT_UInt16:
+      return UInt16ToFloat(*(const unsigned short*)p);
+    case PT_Float:
+      return *(const float*)p;
+    default:
+      return UInt8ToFloat(*p);
+  }
+}
+
+void Image::WriteFloat(unsigned char *p, PixelType type, float value)
+{
+  switch (type) {
+    case PT_UInt16:
+      *(unsigned short*)p = FloatToUInt16(value);
+      break;
+    case PT_Float:
+      *(float*)p = value;
+      break;
+    default:
+      *p = FloatToUInt8(value);
+  }
+}
+
+void Image::AllocateData_(int numBytes, int alignment)
+{
+  // Allocate additional bytes to be able to align the data pointer
+  buffer_ = allocator_->Allocate(numBytes + alignment - 1, bufferSize_);
+  if (buffer_ == NULL) {
+    bufferSize_ = 0;
+    data_ = NULL;
+    return;
+  }
+  AlignData_(numBytes, alignment);
+}
+
+bool Image::AlignData_(int numBytes, int alignment)
+{
+  if (buffer_ == NULL)
+    return false;
+  size_t offset = (size_t)buffer_ & (size_t)(alignment - 1);
+  unsigned char *data = (offset == 0) ? buffer_ : buffer_ + (alignment - offset);
+  if (data + numBytes > buffer_ + bufferSize_)
+    return false;
+  data_ = data;
+  return true;
+}
+
+void Image::ReleaseData_()
+{
+  if (buffer_ != NULL)
+    allocator_->Deallocate(buffer_, bufferSize_);
+  buffer_ = NULL;
+  bufferSize_ = 0;
+  data_ = NULL;
+}
@@ -2,7 +2,9 @@
 #define __Image_hh__
 
 #include "Color.hh"
+#include "ImageAllocator.hh"
 #include <string>
+#include <cstddef>
 
 /** @class Image
     @brief Simple multi-channel image implementation. Provides some basic
@@ -10,10 +12,29 @@
            In order to draw into images, access pixels with the SetPixel
            methods, or create primitives (see PrimitiveBase) for drawing.
 
-    Image data is always stored as 1 byte per channel. The number of channels
-    is either 1 for gray images, 3 for color images (RGB or HSV color model),
-    and 0 for empty images. Image data is stored row-wise in chunks of 1 or 3
-    bytes.
+    Image data is stored as 1 byte per channel by default. The number of
+    channels is either 1 for gray images, 3 for color images (RGB or HSV
+    color model), and 0 for empty images. Image data is stored row-wise in
+    chunks of 1 or 3 values. Each row starts at a multiple of the row alignment given to Init()
+    and may be padded with unused bytes at its end, so rows must be accessed
+    via GetRow() or GetStride() instead of assuming width * channels bytes
+    per row. By default rows are tightly packed (row alignment 1).
+    Color images may also be stored in planar layout (see PixelLayout),
+    where each channel is stored in a separate plane of width values per row.
+    Values may also be stored as 16-bit integers or 32-bit floats (see
+    PixelType), e.g. to load 16-bit PPM files or to chain filters without
+    rounding after each step. GetPixel() and SetPixel() always use 8-bit
+    values, GetValue() and SetValue() use values in range [0, 1].
+    Use ImageView to reference a region of an image without copying it.
+    Owned image data is allocated with an ImageAllocator, e.g. a
+    PoolImageAllocator to recycle buffers of temporary images.
+    Attached external data may be read-only (see Attach()). Methods writing
+    pixels (Clear(), SetPixel(), SetValue(), and the ImageView methods) do
+    nothing for read-only images, algorithms writing into images report an
+    error. GetData(), GetRow() and GetPlaneRow() always return the data, so
+    check IsReadOnly() before writing through them. Memory-mapped files are
+    mapped copy-on-write, so such writes never change the file (see
+    ImageIO::LoadPPMMapped()).
 
     @author esquivel
  */
@@ -31,32 +52,126 @@ public:
     CM_HSV   ///< Color model for 3-channel HSV color images
   };
 
+  /** @brief Specifies who owns the image data. OM_Owned is used for data
+             allocated by the image itself, OM_External for data wrapped with
+             Attach() (e.g. memory-mapped files). */
+  enum OwnershipMode {
+    OM_Owned,   ///< Image data is allocated and released by the image
+    OM_External ///< Image data is owned by someone else and only referenced
+  };
+
+  /** @brief Specifies how the channels of color images are stored.
+             PL_Interleaved stores the channels of each pixel next to each
+             other (e.g. RGBRGB...), PL_Planar stores each channel in a
+             separate plane (e.g. RR...GG...BB...), so values of a single
+             channel are contiguous. Both layouts are equal for gray images. */
+  enum PixelLayout {
+    PL_Interleaved, ///< Channels of a pixel are stored consecutively
+    PL_Planar       ///< Each channel is stored in a separate plane
+  };
+
+  /** @brief Specifies how each channel value is stored. PT_UInt8 stores
+             values in range [0, 255] and is used by most algorithms,
+             PT_UInt16 stores values in range [0, 65535] and PT_Float stores
+             values in range [0, 1] (values outside are allowed, but are
+             saturated when converted to integer types). */
+  enum PixelType {
+    PT_UInt8,  ///< 1 byte unsigned integer per value
+    PT_UInt16, ///< 2 byte unsigned integer per value (native byte order)
+    PT_Float   ///< 4 byte float per value
+  };
+
+  /** @brief Callback to release externally owned image data. Receives the
+             data pointer and the context pointer given to Attach(). */
+  typedef void (*ReleaseCallback)(unsigned char *data, void *context);
+
   /** @brief Create an empty image that must be initialized later. */
   Image();
 
-  /** @brief Create an image with given size and color model. */
-  Image(int w, int h, ColorModel cm);
+  /** @brief Create an image with given size, color model, row alignment,
+             pixel layout and pixel type (see Init()). */
+  Image(int w, int h, ColorModel cm, int rowAlignment = 1,
+        PixelLayout layout = PL_Interleaved, PixelType type = PT_UInt8);
 
   /** @brief Create an image as copy of another image. */
   Image(const Image &img);
 
+  /** @brief Create an image by taking over the data of another image without
+             copying it. The other image is empty afterwards. */
+  Image(Image &&img);
+
   /** @brief Release memory used by image instance. */
   ~Image();
 
   /** @brief Initialize image to given size and color model and set all data
-             values to zero. */
-  void Init(int w, int h, ColorModel cm);
-
-  /** @brief Set all image values to zero or the given value. */
+             values to zero. The image data and every row start at an address
+             that is a multiple of rowAlignment bytes (power of two, e.g. 32
+             or 64 for aligned SIMD access), rows are padded accordingly.
+             In planar layout, every plane starts at such an address.
+             The row alignment is raised to the size of a value if needed.
+             Memory that is already allocated is reused if its capacity is
+             sufficient, see Reserve(). */
+  void Init(int w, int h, ColorModel cm, int rowAlignment = 1,
+            PixelLayout layout = PL_Interleaved, PixelType type = PT_UInt8);
+
+  /** @brief Set all image values to zero or the given 8-bit value
+             (converted to the pixel type). Does nothing for read-only
+             images (see IsReadOnly()). */
   void Clear(unsigned char value = 0);
 
-  /** @brief Set all image values to the given color. Assumes that the
-             image is an RGB color image. */
+  /** @brief Set all image values to the given color (converted to the
+             pixel type). Assumes that the image is an RGB color image.
+             Does nothing for read-only images. */
   void Clear(const Color &color);
 
   /** @brief Release internal data and sets size to zero. */
   void Release();
 
+  /** @brief Make sure that at least numBytes bytes can be used by Init()
+             without reallocating memory. Image data is preserved. Does
+             nothing for external data (see Attach()). */
+  void Reserve(int numBytes);
+
+  /** @brief Returns number of bytes that can be used for image data without
+             reallocating memory, see Reserve(). */
+  int GetCapacity() const;
+
+  /** @brief Exchange data and parameters with another image without copying
+             image data. */
+  void Swap(Image &img);
+
+  /** @brief Set allocator for owned image data (NULL for the default
+             allocator, see ImageAllocator::SetDefault()). Current image data
+             is moved to memory of the new allocator. */
+  void SetAllocator(ImageAllocator *allocator);
+
+  /** @brief Returns allocator used for owned image data. */
+  ImageAllocator *GetAllocator() const;
+
+  /** @brief Wrap externally owned image data of given size and color model
+             without copying it. The data must be stored like the data of an
+             image allocated by Init(). If a release callback is given, it is
+             called with the given context when the image releases the data.
+             If readOnly is set, the data must not be modified via this image.
+             The stride gives the number of bytes per row (0 for tightly
+             packed rows), the data must be aligned to the size of a value.
+      @attention Calling Init() releases the external data and allocates new
+                 image data owned by the image. */
+  void Attach(int w, int h, ColorModel cm, unsigned char *data,
+              ReleaseCallback release = NULL, void *context = NULL,
+              bool readOnly = false, int stride = 0, PixelType type = PT_UInt8);
+
+  /** @brief Copy externally owned image data into data owned by the image,
+             e.g. in order to modify a read-only image. Does nothing if the
+             image data is owned by the image already. */
+  void Detach();
+
+  /** @brief Returns if the image data is owned by the image or external. */
+  OwnershipMode GetOwnershipMode() const;
+
+  /** @brief Returns if the image data must not be modified. */
+  bool IsReadOnly() const;
+
   /** @brief Returns if image has empty data. */
   bool IsEmpty() const;
 
@@ -76,15 +191,77 @@ public:
              images, and 0 for uninitialized images). */
   int GetChannels() const;
 
-  /** @brief Returns image data size in bytes. */
+  /** @brief Returns image data size in bytes including row padding, i.e.
+             GetStride() * GetHeight(), times the number of channels in
+             planar layout. */
   int GetNumBytes() const;
 
+  /** @brief Returns number of bytes between the starts of two rows (of a
+             plane in planar layout). */
+  int GetStride() const;
+
+  /** @brief Returns pixel layout given to Init(). */
+  PixelLayout GetLayout() const;
+
+  /** @brief Returns if color channels are stored in separate planes. */
+  bool IsPlanar() const;
+
+  /** @brief Returns number of bytes between the starts of two planes in
+             planar layout, 0 in interleaved layout. */
+  int GetPlaneStride() const;
+
+  /** @brief Returns pixel type given to Init(). */
+  PixelType GetPixelType() const;
+
+  /** @brief Returns number of bytes per value (1, 2 or 4). */
+  int GetBytesPerValue() const;
+
+  /** @brief Returns number of bytes per value of given pixel type. */
+  static int GetBytesPerValue(PixelType type);
+
+  /** @brief Returns row alignment in bytes given to Init(). */
+  int GetRowAlignment() const;
+
+  /** @brief Returns if rows are stored without padding, i.e. if the stride
+             equals width * channels (width in planar layout) values. */
+  bool IsContiguous() const;
+
   /** @brief Returns read-only pointer to image data of size num_bytes. */
   const unsigned char *GetData() const;
 
   /** @brief Returns pointer to image data of size num_bytes. */
   unsigned char *GetData();
 
+  /** @brief Returns read-only pointer to first value in row y (of the first
+             plane in planar layout). */
+  const unsigned char *GetRow(int y) const
+  {
+    return data_ + y * stride_;
+  }
+
+  /** @brief Returns pointer to first value in row y (of the first plane in
+             planar layout). */
+  unsigned char *GetRow(int y)
+  {
+    return data_ + y * stride_;
+  }
+
+  /** @brief Returns read-only pointer to the value of channel ch of the first
+             pixel in row y. Consecutive values of the channel are 1 value
+             apart in planar layout and GetChannels() values in interleaved
+             layout. */
+  const unsigned char *GetPlaneRow(int ch, int y) const
+  {
+    return data_ + y * stride_ + (planeStride_ > 0 ? ch * planeStride_ : ch * valueSize_);
+  }
+
+  /** @brief Returns pointer to the value of channel ch of the first pixel in
+             row y (see GetPlaneRow() const). */
+  unsigned char *GetPlaneRow(int ch, int y)
+  {
+    return data_ + y * stride_ + (planeStride_ > 0 ? ch * planeStride_ : ch * valueSize_);
+  }
+
   /** @brief Return color model for this image (CM_RGB or CM_HSV for 3 channels
              CM_Gray for 1 channel, and CM_None for uninitialized images). */
   ColorModel GetColorModel() const;
@@ -92,8 +269,13 @@ public:
   /** @brief Assignment creates a deep copy of the given image. */
   Image& operator=(const Image &src);
 
-  /** @brief Get image value from channel ch at pixel (x, y).
-             If check is set, the coordinates are checked for validity. */
+  /** @brief Move assignment takes over the data of the given image without
+             copying it. The given image is empty afterwards. */
+  Image& operator=(Image &&src);
+
+  /** @brief Get image value from channel ch at pixel (x, y) converted to
+             8 bits. If check is set, the coordinates are checked for
+             validity. */
   unsigned char GetPixel(int x, int y, int ch, bool check = false) const;
 
   /** @brief Get image values from all channels at pixel (x, y).
@@ -101,21 +283,135 @@ public:
              Assumes that the image is an RGB color image.  */
   void GetPixel(int x, int y, Color &color, bool check = false) const;
 
-  /** @brief Set image value in channel ch at pixel (x, y).
-             If check is set, the coordinates are checked for validity. */
+  /** @brief Set image value in channel ch at pixel (x, y) from an 8-bit
+             value. If check is set, the coordinates are checked for
+             validity. Does nothing for read-only images. */
   void SetPixel(int x, int y, int ch, unsigned char value, bool check = false);
 
   /** @brief Set image values in all channels at pixel (x, y).
              If check is set, the coordinates are checked for validity.
-             Assumes that the image is an RGB color image. */
+             Assumes that the image is an RGB color image. Does nothing
+             for read-only images. */
   void SetPixel(int x, int y, const Color &color, bool check = false);
 
+  /** @brief Get image value from channel ch at pixel (x, y) in range [0, 1]
+             (float values are returned unchanged). If check is set, the
+             coordinates are checked for validity. */
+  float GetValue(int x, int y, int ch, bool check = false) const;
+
+  /** @brief Set image value in channel ch at pixel (x, y) from a value in
+             range [0, 1], rounded and saturated for integer pixel types.
+             If check is set, the coordinates are checked for validity.
+             Does nothing for read-only images. */
+  void SetValue(int x, int y, int ch, float value, bool check = false);
+
+  /** @brief Read value of given pixel type at address p as 8-bit value. */
+  static unsigned char ReadUInt8(const unsigned char *p, PixelType type);
+
+  /** @brief Write 8-bit value as value of given pixel type to address p. */
+  static void WriteUInt8(unsigned char *p, PixelType type, unsigned char value);
+
+  /** @brief Read value of given pixel type at address p in range [0, 1]. */
+  static float ReadFloat(const unsigned char *p, PixelType type);
+
+  /** @brief Write value in range [0, 1] as value of given pixel type to
+             address p, rounded and saturated for integer pixel types. */
+  static void WriteFloat(unsigned char *p, PixelType type, float value);
+
+  /** @brief Convert 8-bit value to 16-bit value, i.e. 255 maps to 65535. */
+  static unsigned short UInt8ToUInt16(unsigned char v)
+  {
+    return (unsigned short)(v * 257);
+  }
+
+  /** @brief Convert 16-bit value to the nearest 8-bit value. */
+  static unsigned char UInt16ToUInt8(unsigned short v)
+  {
+    return (unsigned char)((v + 128) / 257);
+  }
+
+  /** @brief Convert 8-bit value to float value in range [0, 1]. */
+  static float UInt8ToFloat(unsigned char v)
+  {
+    return v / 255.0f;
+  }
+
+  /** @brief Convert 16-bit value to float value in range [0, 1]. */
+  static float UInt16ToFloat(unsigned short v)
+  {
+    return v / 65535.0f;
+  }
+
+  /** @brief Convert float value to the nearest 8-bit value, saturating
+             values outside of [0, 1] (NaN maps to 0). */
+  static unsigned char FloatToUInt8(float v)
+  {
+    v = (v > 0.0f) ? v : 0.0f;
+    v = (v < 1.0f) ? v : 1.0f;
+    return (unsigned char)(v * 255.0f + 0.5f);
+  }
+
+  /** @brief Convert float value to the nearest 16-bit value, saturating
+             values outside of [0, 1] (NaN maps to 0). */
+  static unsigned short FloatToUInt16(float v)
+  {
+    v = (v > 0.0f) ? v : 0.0f;
+    v = (v < 1.0f) ? v : 1.0f;
+    return (unsigned short)(v * 65535.0f + 0.5f);
+  }
+
 private:
 
   int width_, height_, channels_;
   unsigned char *data_;
   ColorModel colorModel_;
 
+  /** @brief Stores bytes per row and row alignment */
+  int stride_, rowAlignment_;
+
+  /** @brief Stores pixel layout and bytes per plane (0 if interleaved) */
+  PixelLayout layout_;
+  int planeStride_;
+
+  /** @brief Stores pixel type and bytes per value */
+  PixelType pixelType_;
+  int valueSize_;
+
+  /** @brief Returns offset of channel ch at pixel (x, y) in image data. */
+  int GetOffset_(int x, int y, int ch) const
+  {
+    return (planeStride_ > 0) ? y * stride_ + x * valueSize_ + ch * planeStride_
+                              : y * stride_ + (x * channels_ + ch) * valueSize_;
+  }
+
+  /** @brief Stores allocated memory of owned image data and its size,
+             data_ points to the first aligned address within this buffer */
+  unsigned char *buffer_;
+  int bufferSize_;
+
+  /** @brief Stores allocator for owned image data */
+  ImageAllocator *allocator_;
+
+  /** @brief Stores ownership of image data and if it is read-only */
+  OwnershipMode ownershipMode_;
+  bool readOnly_;
+
+  /** @brief Stores callback and context to release external image data */
+  ReleaseCallback releaseCallback_;
+  void *releaseContext_;
+
+  /** @brief Allocate owned image data with given size and alignment.
+             Sets data pointer to NULL in case of failure. */
+  void AllocateData_(int numBytes, int alignment);
+
+  /** @brief Set data pointer to the first address with given alignment in
+             the allocated buffer if numBytes bytes fit into the buffer.
+      @return Returns false if the buffer is too small. */
+  bool AlignData_(int numBytes, int alignment);
+
+  /** @brief Release owned image data. */
+  void ReleaseData_();
+
 };
 
 #endif // __Image_hh__
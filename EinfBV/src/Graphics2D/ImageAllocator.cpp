@@ -0,0 +1,153 @@
+#include "ImageAllocator.hh"
+#include <new>
+#include <climits>
+
+using namespace std;
+
+// ImageAllocator
+
+ImageAllocator *ImageAllocator::default_ = NULL;
+
+ImageAllocator::ImageAllocator()
+{
+}
+
+ImageAllocator::~ImageAllocator()
+{
+}
+
+ImageAllocator *ImageAllocator::GetDefault()
+{
+  static HeapImageAllocator heapAllocator;
+  return (default_ != NULL) ? default_ : &heapAllocator;
+}
+
+void ImageAllocator::SetDefault(ImageAllocator *allocator)
+{
+  default_ = allocator;
+}
+
+// HeapImageAllocator
+
+HeapImageAllocator::HeapImageAllocator()
+{
+}
+
+HeapImageAllocator::~HeapImageAllocator()
+{
+}
+
+unsigned char *HeapImageAllocator::Allocate(int numBytes, int &allocatedBytes)
+{
+  unsigned char *data = new (nothrow) unsigned char[numBytes];
+  allocatedBytes = (data != NULL) ? numBytes : 0;
+  return data;
+}
+
+void HeapImageAllocator::Deallocate(unsigned char *data, int /* allocatedBytes */)
+{
+  delete[] data;
+}
+
+// PoolImageAllocator
+
+PoolImageAllocator::PoolImageAllocator(size_t maxCachedBytes)
+  : maxCachedBytes_(maxCachedBytes)
+{
+  stats_.hits = 0;
+  stats_.misses = 0;
+  stats_.releases = 0;
+  stats_.cachedBuffers = 0;
+  stats_.cachedBytes = 0;
+}
+
+PoolImageAllocator::~PoolImageAllocator()
+{
+  Purge();
+}
+
+unsigned char *PoolImageAllocator::Allocate(int numBytes, int &allocatedBytes)
+{
+  size_t size = GetSizeClass(numBytes);
+  {
+    // Take buffer from pool of this size class if available
+    lock_guard<mutex> lock(mutex_);
+    map<size_t, vector<unsigned char*> >::iterator it = pools_.find(size);
+    if (it != pools_.end() && !it->second.empty()) {
+      unsigned char *data = it->second.back();
+      it->second.pop_back();
+      stats_.hits++;
+      stats_.cachedBuffers--;
+      stats_.cachedBytes -= size;
+      allocatedBytes = (int)size;
+      return data;
+    }
+    stats_.misses++;
+  }
+  // Allocate new buffer outside of the lock
+  unsigned char *data = new (nothrow) unsigned char[size];
+  allocatedBytes = (data != NULL) ? (int)size : 0;
+  return data;
+}
+
+void PoolImageAllocator::Deallocate(unsigned char *data, int allocatedBytes)
+{
+  if (data == NULL)
+    return;
+  size_t size = (size_t)allocatedBytes;
+  {
+    lock_guard<mutex> lock(mutex_);
+    stats_.releases++;
+    if (stats_.cachedBytes + size <= maxCachedBytes_) {
+      pools_[size].push_back(data);
+      stats_.cachedBuffers++;
+      stats_.cachedBytes += size;
+      return;
+    }
+  }
+  // Pool is full, free buffer
+  delete[] data;
+}
+
+PoolImageAllocator::Statistics PoolImageAllocator::GetStatistics() const
+{
+  lock_guard<mutex> lock(mutex_);
+  return stats_;
+}
+
+void PoolImageAllocator::ResetStatistics()
+{
+  lock_guard<mutex> lock(mutex_);
+  stats_.hits = 0;
+  stats_.misses = 0;
+  stats_.releases = 0;
+}
+
+void PoolImageAllocator::Purge()
+{
+  lock_guard<mutex> lock(mutex_);
+  map<size_t, vector<unsigned char*> >::iterator it;
+  for (it = pools_.begin(); it != pools_.end(); it++) {
+    for (size_t i = 0; i < it->second.size(); i++)
+      delete[] it->second[i];
+  }
+  pools_.clear();
+  stats_.cachedBuffers = 0;
+  stats_.cachedBytes = 0;
+}
+
+size_t PoolImageAllocator::GetSizeClass(size_t numBytes)
+{
+  // Use 4 kB for small buffers, otherwise round up to a multiple of a quarter
+  // of the largest power of two not exceeding numBytes
+  const size_t minSize = 4096;
+  if (numBytes <= minSize)
+    return minSize;
+  size_t base = minSize;
+  while (base <= numBytes / 2)
+    base *= 2;
+  size_t step = base / 4;
+  size_t size = ((numBytes + step - 1) / step) * step;
+  // Sizes are passed as int, so use the exact size if rounding overflows
+  return (size > (size_t)INT_MAX) ? numBytes : size;
+}
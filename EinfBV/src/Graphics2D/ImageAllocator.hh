@@ -0,0 +1,142 @@
+#ifndef __ImageAllocator_hh__
+#define __ImageAllocator_hh__
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <vector>
+
+/** @class ImageAllocator
+    @brief Abstract interface for allocating the data of Image instances.
+           Every image uses the allocator that was the default allocator
+           when it was created (see SetDefault()), or the one given to
+           Image::SetAllocator().
+
+    @attention An allocator must outlive all images using it.
+ */
+class ImageAllocator
+{
+public:
+
+  /** @brief Destructor. */
+  virtual ~ImageAllocator();
+
+  /** @brief Allocate at least numBytes bytes. The number of bytes actually
+             allocated is returned in allocatedBytes and may be used by the
+             caller. Returns NULL in case of failure. */
+  virtual unsigned char *Allocate(int numBytes, int &allocatedBytes) = 0;
+
+  /** @brief Release memory returned by Allocate(). Gets the number of
+             allocated bytes returned by Allocate(). */
+  virtual void Deallocate(unsigned char *data, int allocatedBytes) = 0;
+
+  /** @brief Returns allocator used by new images. Returns an allocator using
+             the heap (see HeapImageAllocator) unless SetDefault() is called. */
+  static ImageAllocator *GetDefault();
+
+  /** @brief Set allocator used by images created afterwards. Passing NULL
+             restores the heap allocator.
+      @attention Not synchronized, should be called during initialization. */
+  static void SetDefault(ImageAllocator *allocator);
+
+protected:
+
+  /** @brief Constructor is protected for abstract class. */
+  ImageAllocator();
+
+private:
+
+  /** @brief Stores allocator set by SetDefault() */
+  static ImageAllocator *default_;
+
+};
+
+/** @class HeapImageAllocator
+    @brief Image allocator using new[] and delete[] for every allocation.
+ */
+class HeapImageAllocator : public ImageAllocator
+{
+public:
+
+  /** @brief Create heap allocator. */
+  HeapImageAllocator();
+
+  /** @brief Destructor. */
+  virtual ~HeapImageAllocator();
+
+  /** @brief Allocate exactly numBytes bytes on the heap. */
+  virtual unsigned char *Allocate(int numBytes, int &allocatedBytes);
+
+  /** @brief Release memory on the heap. */
+  virtual void Deallocate(unsigned char *data, int allocatedBytes);
+
+};
+
+/** @class PoolImageAllocator
+    @brief Thread-safe image allocator that keeps released buffers in pools
+           of size classes and hands them out again for allocations of a
+           similar size. Useful for temporary images and per-frame images
+           of the same size that are created and released frequently.
+
+    Allocation sizes are rounded up to size classes with four classes per
+    power of two, so the memory overhead is below 25%. Released buffers are
+    cached until the cache exceeds the given limit, then they are freed.
+ */
+class PoolImageAllocator : public ImageAllocator
+{
+public:
+
+  /** @brief Statistics of a pool allocator. */
+  struct Statistics
+  {
+    unsigned long hits;       ///< Allocations served from the pool
+    unsigned long misses;     ///< Allocations that allocated new memory
+    unsigned long releases;   ///< Buffers returned to the allocator
+    size_t cachedBuffers;     ///< Number of buffers currently in the pool
+    size_t cachedBytes;       ///< Bytes of buffers currently in the pool
+  };
+
+  /** @brief Create pool allocator that caches at most maxCachedBytes bytes
+             of released buffers. */
+  explicit PoolImageAllocator(size_t maxCachedBytes = 256 << 20);
+
+  /** @brief Destructor. Frees all cached buffers. */
+  virtual ~PoolImageAllocator();
+
+  /** @brief Allocate buffer from the pool or from the heap if the pool has
+             no buffer of the size class of numBytes. */
+  virtual unsigned char *Allocate(int numBytes, int &allocatedBytes);
+
+  /** @brief Return buffer to the pool (or free it if the pool is full). */
+  virtual void Deallocate(unsigned char *data, int allocatedBytes);
+
+  /** @brief Returns current statistics. */
+  Statistics GetStatistics() const;
+
+  /** @brief Reset hit, miss and release counters. */
+  void ResetStatistics();
+
+  /** @brief Free all buffers cached in the pool. */
+  void Purge();
+
+  /** @brief Returns size class for given number of bytes. Sizes which
+             would round up beyond INT_MAX are their own class. */
+  static size_t GetSizeClass(size_t numBytes);
+
+private:
+
+  /** @brief Stores released buffers for every size class */
+  std::map<size_t, std::vector<unsigned char*> > pools_;
+
+  /** @brief Stores limit for cached bytes */
+  size_t maxCachedBytes_;
+
+  /** @brief Stores statistics */
+  Statistics stats_;
+
+  /** @brief Protects pools and statistics */
+  mutable std::mutex mutex_;
+
+};
+
+#endif // __ImageAllocator_hh__
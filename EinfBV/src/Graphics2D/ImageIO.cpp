@@ -1,15 +1,460 @@
 #include "ImageIO.hh"
+#include "ColorConversion.hh"
+#include "CpuFeatures.hh"
 #include <fstream>
+#include <sstream>
 #include <iostream>
+#include <cctype>
+#include <climits>
 #include <cstring>
+#include <vector>
+
+#ifdef SIMD_X86
+#  include <tmmintrin.h>
+#endif
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
 
 using namespace std;
 
+namespace {
+
+/** @brief Memory-mapped file as used by ImageIO::LoadPPMMapped(). */
+struct MappedFile
+{
+  unsigned char *base;
+  size_t size;
+};
+
+/** @brief Map whole file into memory copy-on-write, so the memory may be
+           modified without changing the file.
+    @return Returns NULL in case of failure. */
+MappedFile *MapFile(const string &filename)
+{
+#ifdef _WIN32
+  HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    return NULL;
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+    CloseHandle(file);
+    return NULL;
+  }
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+  CloseHandle(file);
+  if (mapping == NULL)
+    return NULL;
+  void *base = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+  CloseHandle(mapping); // view keeps the mapping alive
+  if (base == NULL)
+    return NULL;
+#else
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return NULL;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    close(fd);
+    return NULL;
+  }
+  void *base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd); // mapping stays valid after closing the descriptor
+  if (base == MAP_FAILED)
+    return NULL;
+#endif
+  MappedFile *mapped = new MappedFile;
+  mapped->base = (unsigned char*)base;
+#ifdef _WIN32
+  mapped->size = (size_t)fileSize.QuadPart;
+#else
+  mapped->size = (size_t)st.st_size;
+#endif
+  return mapped;
+}
+
+/** @brief Unmap file mapped by MapFile() and delete the instance. */
+void UnmapFile(MappedFile *mapped)
+{
+  if (mapped == NULL)
+    return;
+#ifdef _WIN32
+  UnmapViewOfFile(mapped->base);
+#else
+  munmap(mapped->base, mapped->size);
+#endif
+  delete mapped;
+}
+
+/** @brief Buffered reader for the plain text data of P2/P3 files. Reads the
+           stream in large blocks and parses decimal values by hand, which
+           is much faster than the locale-aware stream extraction. */
+class PlainTextReader
+{
+public:
+
+  explicit PlainTextReader(istream &stream)
+    : stream_(stream), buffer_(BLOCK_SIZE + 1), cur_(NULL), end_(NULL),
+      eof_(false), inComment_(false)
+  {
+    cur_ = end_ = (const unsigned char*)&buffer_[0];
+  }
+
+  /** @brief Read next value, skipping whitespace and comments.
+      @return Returns false if no more values are available. */
+  bool Next(int &val)
+  {
+    // Fast path for a value after a single separator within the buffer
+    const unsigned char *q = cur_;
+    if (end_ - q > MAX_TOKEN && !inComment_ && *q <= ' ' &&
+        (unsigned int)(q[1] - '0') <= 9) {
+      ParseDigits_(q + 1, val);
+      return true;
+    }
+    for (;;) {
+      // Make sure that a complete value is buffered
+      if (end_ - cur_ < MAX_TOKEN && !eof_)
+        Refill_();
+      const unsigned char *p = cur_;
+      if (inComment_) {
+        // Skip rest of comment line
+        while (p < end_ && *p != '\n')
+          p++;
+        inComment_ = (p == end_);
+      }
+      // Skip whitespace
+      while (p < end_ && *p <= ' ')
+        p++;
+      cur_ = p;
+      // Skipping may have moved close to the end of the buffered data, so
+      // refill again before parsing a value which could be cut off
+      if (end_ - p < MAX_TOKEN && !eof_)
+        continue;
+      if (p == end_) {
+        if (eof_)
+          return false;
+        continue;
+      }
+      if (*p == '#') {
+        inComment_ = true;
+        continue;
+      }
+      if ((unsigned int)(*p - '0') > 9)
+        return false;
+      ParseDigits_(p, val);
+      return true;
+    }
+  }
+
+private:
+
+  /** @brief Parse digits starting at p, the buffer is terminated by a
+             non-digit character. */
+  void ParseDigits_(const unsigned char *p, int &val)
+  {
+    unsigned int digit = (unsigned int)(*p - '0');
+    val = 0;
+    do {
+      if (val < 100000000) // saturate instead of overflowing
+        val = 10 * val + (int)digit;
+      p++;
+    } while ((digit = (unsigned int)(*p - '0')) <= 9);
+    cur_ = p;
+  }
+
+  static const size_t BLOCK_SIZE = 1 << 16;
+  static const int MAX_TOKEN = 32;
+
+  /** @brief Move unread data to the front and fill up buffer from stream. */
+  void Refill_()
+  {
+    unsigned char *base = (unsigned char*)&buffer_[0];
+    size_t remaining = end_ - cur_;
+    memmove(base, cur_, remaining);
+    stream_.read((char*)base + remaining, BLOCK_SIZE - remaining);
+    size_t count = (size_t)stream_.gcount();
+    eof_ = (count < BLOCK_SIZE - remaining);
+    cur_ = base;
+    end_ = base + remaining + count;
+    base[remaining + count] = 0; // terminate buffer for the digit loop
+  }
+
+  istream &stream_;
+  vector<char> buffer_;
+  const unsigned char *cur_, *end_;
+  bool eof_, inComment_;
+};
+
+/** @brief Buffered writer for the plain text data of P2/P3 files. Formats
+           values with a lookup table and writes lines of at most 70
+           characters as recommended by the format specification. */
+class PlainTextWriter
+{
+public:
+
+  explicit PlainTextWriter(ostream &stream)
+    : stream_(stream), buffer_(BLOCK_SIZE), pos_(0), lineLength_(0)
+  {
+    // Store each value as digits followed by a separating space
+    for (int v = 0; v < 256; v++) {
+      int len = 0;
+      if (v >= 100) digits_[v][len++] = (char)('0' + v / 100);
+      if (v >= 10) digits_[v][len++] = (char)('0' + (v / 10) % 10);
+      digits_[v][len++] = (char)('0' + v % 10);
+      digits_[v][len++] = ' ';
+      while (len < 4) digits_[v][len++] = ' ';
+      length_[v] = (v >= 100) ? 4 : ((v >= 10) ? 3 : 2);
+    }
+  }
+
+  ~PlainTextWriter()
+  {
+    Flush();
+  }
+
+  /** @brief Write value followed by a space, break line if needed. */
+  void Write(unsigned char val)
+  {
+    if (pos_ + 4 > BLOCK_SIZE)
+      WriteBuffer_();
+    int len = length_[val];
+    if (lineLength_ + len > 71) {
+      // Replace previous separator by line break
+      buffer_[pos_-1] = '\n';
+      lineLength_ = 0;
+    }
+    memcpy(&buffer_[pos_], digits_[val], 4);
+    pos_ += len;
+    lineLength_ += len;
+  }
+
+  /** @brief Write 16-bit value followed by a space, break line if needed. */
+  void Write(unsigned short val)
+  {
+    if (val < 256) {
+      Write((unsigned char)val);
+      return;
+    }
+    if (pos_ + 6 > BLOCK_SIZE)
+      WriteBuffer_();
+    char digits[6];
+    int len = 0;
+    for (int v = val; v > 0; v /= 10)
+      digits[len++] = (char)('0' + v % 10);
+    if (lineLength_ + len + 1 > 71) {
+      // Replace previous separator by line break
+      buffer_[pos_-1] = '\n';
+      lineLength_ = 0;
+    }
+    for (int i = len - 1; i >= 0; i--)
+      buffer_[pos_++] = digits[i];
+    buffer_[pos_++] = ' ';
+    lineLength_ += len + 1;
+  }
+
+  /** @brief Terminate current line and write buffer to stream. */
+  void Flush()
+  {
+    if (lineLength_ > 0) {
+      buffer_[pos_-1] = '\n';
+      lineLength_ = 0;
+    }
+    WriteBuffer_();
+  }
+
+private:
+
+  static const size_t BLOCK_SIZE = 1 << 16;
+
+  void WriteBuffer_()
+  {
+    // Keep last separator in buffer, it may be replaced by a line break
+    size_t count = (lineLength_ > 0) ? pos_ - 1 : pos_;
+    stream_.write(&buffer_[0], count);
+    memmove(&buffer_[0], &buffer_[count], pos_ - count);
+    pos_ -= count;
+  }
+
+  ostream &stream_;
+  vector<char> buffer_;
+  size_t pos_;
+  int lineLength_;
+  char digits_[256][4];
+  int length_[256];
+};
+
+/** @brief Read-only stream buffer over a block of memory, used to read
+           images with ImageIO::LoadFromMemory() without copying the data. */
+class MemoryInputBuffer : public streambuf
+{
+public:
+
+  MemoryInputBuffer(const unsigned char *data, size_t size)
+  {
+    char *begin = (char*)data;
+    setg(begin, begin, begin + size);
+  }
+
+protected:
+
+  pos_type seekoff(off_type off, ios_base::seekdir dir,
+                   ios_base::openmode which = ios_base::in)
+  {
+    off_type pos = off;
+    if (dir == ios_base::cur)
+      pos += gptr() - eback();
+    else if (dir == ios_base::end)
+      pos += egptr() - eback();
+    if (!(which & ios_base::in) || pos < 0 || pos > egptr() - eback())
+      return pos_type(off_type(-1));
+    setg(eback(), eback() + pos, egptr());
+    return pos_type(pos);
+  }
+
+  pos_type seekpos(pos_type pos, ios_base::openmode which = ios_base::in)
+  {
+    return seekoff(off_type(pos), ios_base::beg, which);
+  }
+};
+
+/** @brief Stream buffer appending to a byte vector, used to write images
+           with ImageIO::SaveToMemory(). The vector keeps its capacity, so
+           writing images of the same size again does not allocate memory. */
+class VectorOutputBuffer : public streambuf
+{
+public:
+
+  explicit VectorOutputBuffer(vector<unsigned char> &buffer) : buffer_(buffer)
+  {
+    buffer_.clear();
+  }
+
+protected:
+
+  int_type overflow(int_type c)
+  {
+    if (c != traits_type::eof())
+      buffer_.push_back((unsigned char)c);
+    return traits_type::not_eof(c);
+  }
+
+  streamsize xsputn(const char *s, streamsize n)
+  {
+    buffer_.insert(buffer_.end(), (const unsigned char*)s, (const unsigned char*)s + n);
+    return n;
+  }
+
+private:
+
+  vector<unsigned char> &buffer_;
+};
+
+#ifdef BUILD_WITH_FREEIMAGE
+
+/** @brief Last FreeImage error message of each thread. FreeImage reports
+           errors through a global callback in the thread which caused them,
+           so messages of concurrent loads do not mix. */
+thread_local string freeImageError;
+
+void StoreFreeImageError(FREE_IMAGE_FORMAT fif, const char *message)
+{
+  // Prefix the message with the name of the format reporting it, if known
+  const char *format = (fif != FIF_UNKNOWN) ? FreeImage_GetFormatFromFIF(fif) : NULL;
+  freeImageError = (format != NULL) ? string(format) + ": " : string();
+  freeImageError += (message != NULL) ? message : "";
+}
+
+/** @brief Returns last FreeImage error message of the calling thread
+           formatted for error output and clears it. */
+string TakeFreeImageError()
+{
+  string message;
+  if (!freeImageError.empty())
+    message = " (" + freeImageError + ")";
+  freeImageError.clear();
+  return message;
+}
+
+/** @brief Initialize FreeImage library and install error callback. */
+bool InitFreeImageLib()
+{
+  FreeImage_Initialise();
+  FreeImage_SetOutputMessage(StoreFreeImageError);
+  return true;
+}
+
+/** @brief Copy row of width pixels with srcStep (3 or 4) bytes in FreeImage
+           byte order (BGR(A) on little endian systems) to RGB pixels or vice
+           versa (srcStep 3). Source and target may be the same row. */
+void SwapRedBlueRowScalar(const unsigned char *src, unsigned char *dst,
+                          int width, int srcStep)
+{
+  for (int x = 0; x < width; x++, src += srcStep, dst += 3) {
+    unsigned char r = src[FI_RGBA_RED], g = src[FI_RGBA_GREEN], b = src[FI_RGBA_BLUE];
+    dst[0] = r;
+    dst[1] = g;
+    dst[2] = b;
+  }
+}
+
+#if defined(SIMD_X86) && FI_RGBA_RED == 2 && FI_RGBA_GREEN == 1 && FI_RGBA_BLUE == 0
+
+/** @brief SSSE3 version of SwapRedBlueRowScalar(). Each block is loaded
+           before it is stored and stores never overtake loads, so rows may
+           be converted in place. */
+SIMD_TARGET_SSSE3 void SwapRedBlueRowSSSE3(const unsigned char *src, unsigned char *dst,
+                                           int width, int srcStep)
+{
+  // 16 bytes are loaded and stored per block, the bytes behind the converted
+  // pixels are rewritten by the next block
+  int x = 0;
+  if (srcStep == 3) {
+    const __m128i mask = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+    for (; x + 6 <= width; x += 5)
+      _mm_storeu_si128((__m128i *)(dst + 3 * x),
+        _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + 3 * x)), mask));
+  } else {
+    const __m128i mask = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    for (; x + 6 <= width; x += 4)
+      _mm_storeu_si128((__m128i *)(dst + 3 * x),
+        _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + srcStep * x)), mask));
+  }
+  SwapRedBlueRowScalar(src + srcStep * x, dst + 3 * x, width - x, srcStep);
+}
+
+#endif
+
+/** @brief Convert pixels between FreeImage byte order and RGB order (see
+           SwapRedBlueRowScalar()), using SSSE3 instructions if supported. */
+void SwapRedBlueRow(const unsigned char *src, unsigned char *dst, int width, int srcStep)
+{
+#if defined(SIMD_X86) && FI_RGBA_RED == 2 && FI_RGBA_GREEN == 1 && FI_RGBA_BLUE == 0
+  static const bool hasSSSE3 = CpuFeatures::HasSSSE3();
+  if (hasSSSE3) {
+    SwapRedBlueRowSSSE3(src, dst, width, srcStep);
+    return;
+  }
+#endif
+  SwapRedBlueRowScalar(src, dst, width, srcStep);
+}
+
+#endif // BUILD_WITH_FREEIMAGE
+
+} // namespace
+
 ImageIO::ImageIO()
 {
 }
 
-bool ImageIO::Load(const string &filename, Image &image)
+bool ImageIO::Load(const string &filename, Image &image, int rowAlignment,
+                   Image::PixelLayout layout)
 {
   // Get file extension from filename
   size_t pos = filename.find_last_of('.');
@@ -17,18 +462,111 @@ bool ImageIO::Load(const string &filename, Image &image)
   // Call LoadPPM() or LoadFreeImage() depending on the extension
   if (format.compare(".ppm") == 0 || format.compare(".pgm") == 0 ||
       format.compare(".PPM") == 0 || format.compare(".PGM") == 0) {
-    return LoadPPM(filename, image);
+    return LoadPPM(filename, image, rowAlignment, layout);
   } else {
 #ifdef BUILD_WITH_FREEIMAGE
-    return LoadFreeImage(filename, image);
+    return LoadFreeImage(filename, image, rowAlignment, layout);
 #else
     cerr << "ImageIO::Load() : Only Portable PixMap images are supported!" << endl;
+    image.Release();
     return false;
 #endif
   }
 }
 
+bool ImageIO::ReadInfo(const string &filename, ImageInfo &info)
+{
+  // Get file extension from filename
+  size_t pos = filename.find_last_of('.');
+  string format = (pos != string::npos) ? filename.substr(pos) : "";
+  // Read PPM header or FreeImage header depending on the extension as in Load()
+  if (format.compare(".ppm") == 0 || format.compare(".pgm") == 0 ||
+      format.compare(".PPM") == 0 || format.compare(".PGM") == 0) {
+    ifstream file(filename.c_str(), ios::in | ios::binary);
+    if (!file.good()) {
+      cerr << "ImageIO::ReadInfo() : Failed to open file!" << endl;
+      return false;
+    }
+    PPMHeader header;
+    PPMError error = ReadPPMHeader(file, header);
+    if (error != PPM_OK) {
+      cerr << "ImageIO::ReadInfo() : " << GetPPMErrorString(error) << "!" << endl;
+      return false;
+    }
+    info.width = header.width;
+    info.height = header.height;
+    info.channels = header.channels;
+    info.colorModel = header.colorModel;
+    info.pixelType = header.pixelType;
+    return true;
+  }
+#ifdef BUILD_WITH_FREEIMAGE
+  // Initialize FreeImage library (once for all threads)
+  InitFreeImage_();
+  // Get image format from file or filename extension
+  FREE_IMAGE_FORMAT tmpFormat = FreeImage_GetFileType(filename.c_str(), 0);
+  if (tmpFormat == FIF_UNKNOWN)
+    tmpFormat = FreeImage_GetFIFFromFilename(filename.c_str());
+  if (tmpFormat == FIF_UNKNOWN || !FreeImage_FIFSupportsReading(tmpFormat)) {
+    cerr << "ImageIO::ReadInfo() : Failed to get image format using FreeImage!" << endl;
+    return false;
+  }
+  // Load header only, formats without header-only support load all pixels
+  FIBITMAP *tmpImage = FreeImage_Load(tmpFormat, filename.c_str(), FIF_LOAD_NOPIXELS);
+  if (!tmpImage) {
+    cerr << "ImageIO::ReadInfo() : Failed to load image using FreeImage"
+         << TakeFreeImageError() << "!" << endl;
+    return false;
+  }
+  // Determine properties of the image created by CreateFromFreeImage_()
+  info.width = FreeImage_GetWidth(tmpImage);
+  info.height = FreeImage_GetHeight(tmpImage);
+  info.pixelType = Image::PT_UInt8;
+  switch (FreeImage_GetImageType(tmpImage)) {
+    case FIT_BITMAP:
+      // Bitmaps with less than 8 bits per pixel are not supported
+      if (FreeImage_GetBPP(tmpImage) < 8)
+        info.channels = 0;
+      else
+        info.channels = (FreeImage_GetColorType(tmpImage) == FIC_PALETTE ||
+                         FreeImage_GetBPP(tmpImage) >= 24) ? 3 : 1;
+      break;
+    case FIT_UINT16:
+      info.channels = 1; info.pixelType = Image::PT_UInt16; break;
+    case FIT_RGB16:
+    case FIT_RGBA16:
+      info.channels = 3; info.pixelType = Image::PT_UInt16; break;
+    case FIT_FLOAT:
+      info.channels = 1; info.pixelType = Image::PT_Float; break;
+    case FIT_RGBF:
+    case FIT_RGBAF:
+      info.channels = 3; info.pixelType = Image::PT_Float; break;
+    default:
+      info.channels = 1; break;
+  }
+  info.colorModel = (info.channels == 1) ? Image::CM_Gray : Image::CM_RGB;
+  FreeImage_Unload(tmpImage);
+  if (info.channels == 0) {
+    cerr << "ImageIO::ReadInfo() : Unsupported bits per pixel found!" << endl;
+    return false;
+  }
+  if (info.width <= 0 || info.height <= 0) {
+    cerr << "ImageIO::ReadInfo() : Invalid image size found!" << endl;
+    return false;
+  }
+  return true;
+#else
+  cerr << "ImageIO::ReadInfo() : Only Portable PixMap images are supported!" << endl;
+  return false;
+#endif
+}
+
 bool ImageIO::Save(const string &filename, const Image &image)
+{
+  return Save(filename, ImageView(image));
+}
+
+bool ImageIO::Save(const string &filename, const ImageView &image)
 {
   // Get file extension from filename
   size_t pos = filename.find_last_of('.');
@@ -47,94 +585,237 @@ bool ImageIO::Save(const string &filename, const Image &image)
   }
 }
 
-bool ImageIO::LoadPPM(const string &filename, Image &image)
+bool ImageIO::LoadFromMemory(const unsigned char *data, size_t size, Image &image,
+                             int rowAlignment, Image::PixelLayout layout)
 {
-  // Release current image
+  if (data == NULL || size == 0) {
+    cerr << "ImageIO::LoadFromMemory() : No data given!" << endl;
+    image.Release();
+    return false;
+  }
+  // Read Portable PixMap data (detected by the magic number) or use the
+  // FreeImage library for other formats
+  if (size >= 2 && data[0] == 'P' &&
+      (data[1] == '2' || data[1] == '3' || data[1] == '5' || data[1] == '6')) {
+    MemoryInputBuffer buffer(data, size);
+    istream stream(&buffer);
+    return LoadPPM_(stream, image, rowAlignment, layout, "ImageIO::LoadFromMemory()");
+  }
+#ifdef BUILD_WITH_FREEIMAGE
+  // Initialize FreeImage library (once for all threads)
+  InitFreeImage_();
+  // Wrap data in a FreeImage memory stream (which does not copy the data)
+  FIMEMORY *memory = FreeImage_OpenMemory((BYTE*)data, (DWORD)size);
+  if (memory == NULL) {
+    cerr << "ImageIO::LoadFromMemory() : Failed to open memory stream!" << endl;
+    image.Release();
+    return false;
+  }
+  FREE_IMAGE_FORMAT tmpFormat = FreeImage_GetFileTypeFromMemory(memory, 0);
+  FIBITMAP *tmpImage = NULL;
+  if (tmpFormat != FIF_UNKNOWN && FreeImage_FIFSupportsReading(tmpFormat))
+    tmpImage = FreeImage_LoadFromMemory(tmpFormat, memory);
+  FreeImage_CloseMemory(memory);
+  if (!tmpImage) {
+    cerr << "ImageIO::LoadFromMemory() : Failed to load image using FreeImage"
+         << TakeFreeImageError() << "!" << endl;
+    image.Release();
+    return false;
+  }
+  if (!WrapFreeImage_(tmpImage, image, rowAlignment, layout)) {
+    CreateFromFreeImage_(tmpImage, image, rowAlignment, layout);
+    FreeImage_Unload(tmpImage);
+  }
+  if (image.IsEmpty()) {
+    cerr << "ImageIO::LoadFromMemory() : Failed to convert image from FreeImage!" << endl;
+    return false;
+  }
+  return true;
+#else
+  cerr << "ImageIO::LoadFromMemory() : Only Portable PixMap images are supported!" << endl;
   image.Release();
+  return false;
+#endif
+}
+
+bool ImageIO::SaveToMemory(const Image &image, vector<unsigned char> &buffer,
+                           const string &format)
+{
+  return SaveToMemory(ImageView(image), buffer, format);
+}
+
+bool ImageIO::SaveToMemory(const ImageView &image, vector<unsigned char> &buffer,
+                           const string &format)
+{
+  buffer.clear();
+  if (image.IsEmpty()) {
+    cerr << "ImageIO::SaveToMemory() : Image is empty!" << endl;
+    return false;
+  }
+  // Write Portable PixMap data or use the FreeImage library depending on the
+  // format given as file extension (with or without dot)
+  string extension = (!format.empty() && format[0] == '.') ? format.substr(1) : format;
+  if (extension.compare("ppm") == 0 || extension.compare("pgm") == 0 ||
+      extension.compare("PPM") == 0 || extension.compare("PGM") == 0) {
+    // Reserve memory for header and data (no-op if the buffer is reused)
+    size_t valueSize = (image.GetPixelType() == Image::PT_UInt8) ? 1 : 2;
+    buffer.reserve(64 + (size_t)image.GetWidth() * image.GetHeight() *
+                   image.GetChannels() * valueSize);
+    VectorOutputBuffer output(buffer);
+    ostream stream(&output);
+    if (!SavePPM_(stream, image, false)) {
+      cerr << "ImageIO::SaveToMemory() : Failed to write image data!" << endl;
+      return false;
+    }
+    return true;
+  }
+#ifdef BUILD_WITH_FREEIMAGE
+  // Initialize FreeImage library (once for all threads)
+  InitFreeImage_();
+  FREE_IMAGE_FORMAT tmpFormat = FreeImage_GetFIFFromFilename(("image." + extension).c_str());
+  if (tmpFormat == FIF_UNKNOWN || !FreeImage_FIFSupportsWriting(tmpFormat)) {
+    cerr << "ImageIO::SaveToMemory() : Format is not supported by FreeImage!" << endl;
+    return false;
+  }
+  FIBITMAP *tmpImage = NULL;
+  ConvertToFreeImage_(image, tmpImage);
+  if (!tmpImage) {
+    cerr << "ImageIO::SaveToMemory() : Failed to convert image to FreeImage!" << endl;
+    return false;
+  }
+  // Encode into a FreeImage memory stream and copy the encoded data
+  FIMEMORY *memory = FreeImage_OpenMemory();
+  BYTE *data = NULL;
+  DWORD size = 0;
+  bool success = memory != NULL &&
+                 FreeImage_SaveToMemory(tmpFormat, tmpImage, memory) &&
+                 FreeImage_AcquireMemory(memory, &data, &size);
+  if (success)
+    buffer.assign(data, data + size);
+  if (memory != NULL)
+    FreeImage_CloseMemory(memory);
+  FreeImage_Unload(tmpImage);
+  if (!success) {
+    cerr << "ImageIO::SaveToMemory() : Failed to save image using FreeImage"
+         << TakeFreeImageError() << "!" << endl;
+    return false;
+  }
+  return true;
+#else
+  cerr << "ImageIO::SaveToMemory() : Only Portable PixMap images are supported!" << endl;
+  return false;
+#endif
+}
+
+bool ImageIO::LoadPPM(const string &filename, Image &image, int rowAlignment,
+                      Image::PixelLayout layout)
+{
   // Open file for input (support binary output)
   ifstream file;
   file.open(filename.c_str(), ios::in | ios::binary);
   // Check if file was opened successfully
   if (!file.good()) {
     cerr << "ImageIO::LoadPPM() : Failed to open file!" << endl;
+    image.Release();
     return false;
   }
-  // Create string buffer for the comment and header
-  string buffer;
-  // Read header and check if PPM format is supported
-  getline(file, buffer);
-  if (buffer[0] != 'P' ||
-      (buffer[1] != '2' && buffer[1] != '3' && buffer[1] != '5' && buffer[1] != '6')) {
-    cerr << "ImageIO::LoadPPM() : Unknown image format found!" << endl;
-    file.close();
+  // The image is re-initialized, which reuses its memory if it is large
+  // enough, and released in case of failure
+  return LoadPPM_(file, image, rowAlignment, layout, "ImageIO::LoadPPM()");
+}
+
+bool ImageIO::LoadPPM_(istream &file, Image &image, int rowAlignment,
+                       Image::PixelLayout layout, const char *method)
+{
+  // Read and validate header, check if file contains all binary data
+  PPMHeader header;
+  PPMError error = ReadPPMHeader(file, header);
+  if (error != PPM_OK) {
+    cerr << method << " : " << GetPPMErrorString(error) << "!" << endl;
+    image.Release();
     return false;
   }
-  // Check if gray image (P2, P5) or color image (P3, P6) is given
-  bool isGray = false;
-  if (buffer[1] == '2' || buffer[1] == '5') {
-    isGray = true;
-  }
-  // Check if plain text data (P2, P3) or binary data (P5, P6) is given
-  bool isBinary = false;
-  if (buffer[1] == '5' || buffer[1] == '6') {
-    isBinary = true;
-  }
-  // Set color model for image
-  Image::ColorModel colorModel = isGray ? Image::CM_Gray : Image::CM_RGB;
-  // Check comment lines (in case they contain a color model specification)
-  while (file.peek() == '#') {
-    getline(file, buffer);
-    if (buffer.compare("# CM_RGB") == 0) {
-      if (!isGray)
-        colorModel = Image::CM_RGB; // should be set already, but anyway...
-      else
-        cerr << "ImageIO::LoadPPM() : Ignoring incompatible color model!" << endl;
-    } else if (buffer.compare("# CM_Gray") == 0) {
-      if (isGray)
-        colorModel = Image::CM_Gray; // should be set already, but anyway...
-      else
-        cerr << "ImageIO::LoadPPM() : Ignoring incompatible color model!" << endl;
-    } else if (buffer.compare("# CM_HSV") == 0) {
-      if (!isGray)
-        colorModel = Image::CM_HSV; // set HSV instead of RGB color model
-      else
-        cerr << "ImageIO::LoadPPM() : Ignoring incompatible color model!" << endl;
-    }
-  }
-  // Read width, height and max. value (the latter is ignored because we only use
-  // unsigned char images and assume that max. value = 255)
-  int w, h, maxVal;
-  file >> w >> h >> maxVal;
-  if (w <= 0 || h <= 0) {
-    cerr << "ImageIO::LoadPPM() : Invalid image size found!" << endl;
-    file.close();
+  if (header.ignoredColorModel)
+    cerr << method << " : Ignoring incompatible color model!" << endl;
+  // Images with max. values above 255 are loaded as 16-bit images, all
+  // values are scaled to the full range
+  int w = header.width, h = header.height, maxVal = header.maxVal;
+  Image::ColorModel colorModel = header.colorModel;
+  bool isBinary = header.isBinary;
+  Image::PixelType type = header.pixelType;
+  // Initialize image of size w x h with 1 or 3 channels
+  image.Init(w, h, colorModel, rowAlignment, layout, type);
+  if (image.IsEmpty()) {
     return false;
   }
-  // Initialize image of size w x h with 1 or 3 channels
-  image.Init(w, h, colorModel);
-  // Read image data
-  int numBytes = image.GetNumBytes();
-  unsigned char *dataPtr = image.GetData();
+  // Read image data row by row, rows of planar color images are read into
+  // a temporary row and split into the planes
+  int rowValues = w * image.GetChannels();
+  int rowBytes = rowValues * image.GetBytesPerValue();
+  bool planar = image.IsPlanar() && image.GetChannels() == 3;
+  vector<unsigned char> rowBuffer(planar ? rowBytes : 0);
+  ImageView row(planar ? &rowBuffer[0] : NULL, w, 1, rowBytes, colorModel, false, type);
   if (!isBinary) {
     // Read image data in plain text format
+    PlainTextReader reader(file);
     int val;
-    for (int i = 0; i < numBytes; i++, dataPtr++) {
-      // Read next integer value from file stream
-      file >> val;
-      // Store as unsigned char
-      *dataPtr = (unsigned char)val;
+    for (int y = 0; y < h; y++) {
+      unsigned char *dataPtr = planar ? &rowBuffer[0] : image.GetRow(y);
+      for (int i = 0; i < rowValues; i++) {
+        // Read next integer value from file buffer
+        if (!reader.Next(val)) {
+          cerr << method << " : File does not contain all image data!" << endl;
+          image.Release();
+          return false;
+        }
+        // Store in the byte order of binary data, saturated to max. value
+        if (val > maxVal)
+          val = maxVal;
+        if (type == Image::PT_UInt16) {
+          dataPtr[2*i] = (unsigned char)(val >> 8);
+          dataPtr[2*i+1] = (unsigned char)val;
+        } else {
+          dataPtr[i] = (unsigned char)val;
+        }
+      }
+      DecodePPMRow(dataPtr, rowValues, maxVal);
+      if (planar)
+        ColorConversion::ConvertLayout(row, ImageView(image, 0, y, w, 1));
     }
   } else {
-    // Skip to next line where the binary data starts
-    getline(file, buffer);
-    // Read data bytes from file
-    file.read((char*)dataPtr, numBytes);
+    // Read data bytes from file, which is positioned at the data already
+    if (image.IsContiguous() && !planar) {
+      file.read((char*)image.GetData(), image.GetNumBytes());
+      if (maxVal != 255 && file.good())
+        for (int y = 0; y < h; y++)
+          DecodePPMRow(image.GetRow(y), rowValues, maxVal);
+    } else if (!planar) {
+      for (int y = 0; y < h && file.good(); y++) {
+        file.read((char*)image.GetRow(y), rowBytes);
+        DecodePPMRow(image.GetRow(y), rowValues, maxVal);
+      }
+    } else {
+      for (int y = 0; y < h && file.good(); y++) {
+        file.read((char*)&rowBuffer[0], rowBytes);
+        DecodePPMRow(&rowBuffer[0], rowValues, maxVal);
+        ColorConversion::ConvertLayout(row, ImageView(image, 0, y, w, 1));
+      }
+    }
+    if (!file.good()) {
+      cerr << method << " : " << GetPPMErrorString(PPM_TruncatedData) << "!" << endl;
+      image.Release();
+      return false;
+    }
   }
-  file.close();
   return true;
 }
 
-bool ImageIO::SavePPM(const string &filename, const Image &image)
+bool ImageIO::SavePPM(const string &filename, const Image &image, bool plainText)
+{
+  return SavePPM(filename, ImageView(image), plainText);
+}
+
+bool ImageIO::SavePPM(const string &filename, const ImageView &image, bool plainText)
 {
   // Check image
   if (image.IsEmpty()) {
@@ -149,43 +830,333 @@ bool ImageIO::SavePPM(const string &filename, const Image &image)
     cerr << "ImageIO::SavePPM() : Failed to write to file!" << endl;
     return false;
   }
+  if (!SavePPM_(file, image, plainText)) {
+    cerr << "ImageIO::SavePPM() : Failed to write to file!" << endl;
+    return false;
+  }
+  return true;
+}
+
+bool ImageIO::SavePPM_(ostream &file, const ImageView &image, bool plainText)
+{
   // Write header
-  if (image.GetColorModel() == Image::CM_Gray)
-    file << "P5" << endl;
+  int maxVal = (image.GetPixelType() == Image::PT_UInt8) ? 255 : 65535;
+  file << FormatPPMHeader(image.GetWidth(), image.GetHeight(),
+                          image.GetColorModel(), maxVal, plainText);
+  // Write data bytes into file row by row, rows of planar color images are
+  // interleaved into a temporary row first
+  int rowBytes = image.GetWidth() * image.GetChannels();
+  if (image.GetPixelType() != Image::PT_UInt8) {
+    // Write 16-bit values (float values are converted to 16 bits) most
+    // significant byte first, interleaved rows are converted to 16 bits
+    // first if needed
+    int w = image.GetWidth(), rowValues = rowBytes;
+    vector<unsigned short> row16(rowValues);
+    vector<unsigned char> rowBuffer(image.GetPixelType() == Image::PT_Float ? 4 * rowValues : 0);
+    vector<unsigned char> outBuffer(2 * rowValues);
+    ImageView rowView((unsigned char*)&row16[0], w, 1, 2 * rowValues,
+                      image.GetColorModel(), false, Image::PT_UInt16);
+    ImageView floatView(rowBuffer.empty() ? NULL : &rowBuffer[0], w, 1, 4 * rowValues,
+                        image.GetColorModel(), false, Image::PT_Float);
+    PlainTextWriter writer(file);
+    for (int y = 0; y < image.GetHeight(); y++) {
+      ImageView src = image.GetSubView(0, y, w, 1);
+      if (image.GetPixelType() == Image::PT_UInt16) {
+        ColorConversion::ConvertLayout(src, rowView);
+      } else if (image.IsPlanar() && image.GetChannels() == 3) {
+        ColorConversion::ConvertLayout(src, floatView);
+        ColorConversion::ConvertDepth(floatView, rowView);
+      } else {
+        ColorConversion::ConvertDepth(src, rowView);
+      }
+      if (plainText) {
+        for (int i = 0; i < rowValues; i++)
+          writer.Write(row16[i]);
+      } else {
+        for (int i = 0; i < rowValues; i++) {
+          outBuffer[2*i] = (unsigned char)(row16[i] >> 8);
+          outBuffer[2*i+1] = (unsigned char)row16[i];
+        }
+        file.write((const char*)&outBuffer[0], 2 * rowValues);
+      }
+    }
+  } else if (image.IsPlanar() && image.GetChannels() == 3) {
+    vector<unsigned char> rowBuffer(rowBytes);
+    ImageView row(&rowBuffer[0], image.GetWidth(), 1, rowBytes, image.GetColorModel());
+    PlainTextWriter writer(file);
+    for (int y = 0; y < image.GetHeight(); y++) {
+      ColorConversion::ConvertLayout(image.GetSubView(0, y, image.GetWidth(), 1), row);
+      if (plainText) {
+        for (int i = 0; i < rowBytes; i++)
+          writer.Write(rowBuffer[i]);
+      } else {
+        file.write((const char*)&rowBuffer[0], rowBytes);
+      }
+    }
+  } else if (plainText) {
+    PlainTextWriter writer(file);
+    for (int y = 0; y < image.GetHeight(); y++) {
+      const unsigned char *dataPtr = image.GetRow(y);
+      for (int i = 0; i < rowBytes; i++)
+        writer.Write(dataPtr[i]);
+    }
+  } else if (image.GetStride() == rowBytes) {
+    file.write((const char*)image.GetData(), rowBytes * image.GetHeight());
+  } else {
+    for (int y = 0; y < image.GetHeight(); y++)
+      file.write((const char*)image.GetRow(y), rowBytes);
+  }
+  return file.good();
+}
+
+bool ImageIO::LoadPPMMapped(const string &filename, Image &image, bool copyOnWrite)
+{
+  // Release current image
+  image.Release();
+  // Map file into memory
+  MappedFile *mapped = MapFile(filename);
+  if (mapped == NULL) {
+    cerr << "ImageIO::LoadPPMMapped() : Failed to map file!" << endl;
+    return false;
+  }
+  // Parse header from mapped memory
+  PPMHeader header;
+  PPMError error = ParsePPMHeader(mapped->base, mapped->size, header);
+  if (error != PPM_OK) {
+    cerr << "ImageIO::LoadPPMMapped() : " << GetPPMErrorString(error) << "!" << endl;
+    UnmapFile(mapped);
+    return false;
+  }
+  // Plain text data and values which must be scaled or swapped cannot be
+  // wrapped, so read them the usual way
+  if (!header.isBinary || header.maxVal != 255) {
+    UnmapFile(mapped);
+    return LoadPPM(filename, image);
+  }
+  // Check if file contains all image data
+  if ((mapped->size - header.dataOffset) / header.rowBytes < (size_t)header.height) {
+    cerr << "ImageIO::LoadPPMMapped() : " << GetPPMErrorString(PPM_TruncatedData) << "!" << endl;
+    UnmapFile(mapped);
+    return false;
+  }
+  // Wrap mapped image data, file is unmapped when the image is released
+  image.Attach(header.width, header.height, header.colorModel,
+               mapped->base + header.dataOffset,
+               UnmapPPM_, mapped, !copyOnWrite);
+  return !image.IsEmpty();
+}
+
+ImageIO::PPMError ImageIO::ParsePPMHeader(const unsigned char *data, size_t size,
+                                          PPMHeader &header)
+{
+  // Check if PPM format is supported
+  if (size < 2)
+    return PPM_IncompleteHeader;
+  if (data[0] != 'P' ||
+      (data[1] != '2' && data[1] != '3' && data[1] != '5' && data[1] != '6'))
+    return PPM_UnknownFormat;
+  // Check if gray image (P2, P5) or color image (P3, P6) is given and if
+  // plain text data (P2, P3) or binary data (P5, P6) is given
+  bool isGray = (data[1] == '2' || data[1] == '5');
+  header.isBinary = (data[1] == '5' || data[1] == '6');
+  header.channels = isGray ? 1 : 3;
+  header.colorModel = isGray ? Image::CM_Gray : Image::CM_RGB;
+  header.ignoredColorModel = false;
+  // Read width, height and max. value, skipping whitespace and comments,
+  // values must be separated from the magic number by whitespace
+  static const int MAX_VALUE[3] = { INT_MAX, INT_MAX, 65535 };
+  int values[3];
+  size_t pos = 2;
+  for (int n = 0; n < 3; n++) {
+    size_t start = pos;
+    while (pos < size) {
+      unsigned char c = data[pos];
+      if (c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f') {
+        pos++;
+      } else if (c == '#') {
+        // Check comment line (in case it contains a color model specification)
+        const unsigned char *end = (const unsigned char*)
+          memchr(data + pos, '\n', size - pos);
+        if (end == NULL)
+          return PPM_IncompleteHeader;
+        size_t length = end - (data + pos);
+        if (length > 0 && end[-1] == '\r')
+          length--;
+        if (length == 8 && memcmp(data + pos, "# CM_RGB", 8) == 0) {
+          if (isGray) header.ignoredColorModel = true;
+          else header.colorModel = Image::CM_RGB;
+        } else if (length == 8 && memcmp(data + pos, "# CM_HSV", 8) == 0) {
+          if (isGray) header.ignoredColorModel = true;
+          else header.colorModel = Image::CM_HSV;
+        } else if (length == 9 && memcmp(data + pos, "# CM_Gray", 9) == 0) {
+          if (!isGray) header.ignoredColorModel = true;
+          else header.colorModel = Image::CM_Gray;
+        }
+        pos = end - data;
+      } else {
+        break;
+      }
+    }
+    if (pos >= size)
+      return PPM_IncompleteHeader;
+    if (pos == start || data[pos] < '0' || data[pos] > '9')
+      return PPM_InvalidHeader;
+    // Accumulate digits, rejecting values above the maximum
+    long long val = 0;
+    while (pos < size && data[pos] >= '0' && data[pos] <= '9') {
+      val = 10 * val + (data[pos++] - '0');
+      if (val > MAX_VALUE[n])
+        return (n < 2) ? PPM_InvalidSize : PPM_InvalidMaxValue;
+    }
+    values[n] = (int)val;
+  }
+  // Image data starts after a single whitespace character
+  if (pos >= size)
+    return PPM_IncompleteHeader;
+  if (!isspace(data[pos]))
+    return PPM_InvalidHeader;
+  header.width = values[0];
+  header.height = values[1];
+  header.maxVal = values[2];
+  if (header.width <= 0 || header.height <= 0)
+    return PPM_InvalidSize;
+  if (header.maxVal <= 0)
+    return PPM_InvalidMaxValue;
+  header.pixelType = (header.maxVal > 255) ? Image::PT_UInt16 : Image::PT_UInt8;
+  // Reject sizes whose rows or data do not fit into memory
+  size_t valueSize = Image::GetBytesPerValue(header.pixelType);
+  if ((size_t)header.width > (size_t)INT_MAX / (header.channels * valueSize))
+    return PPM_InvalidSize;
+  header.rowBytes = (size_t)header.width * header.channels * valueSize;
+  if ((size_t)header.height > ((size_t)-1 - (pos + 1)) / header.rowBytes)
+    return PPM_InvalidSize;
+  header.dataOffset = pos + 1;
+  return PPM_OK;
+}
+
+ImageIO::PPMError ImageIO::ReadPPMHeader(istream &file, PPMHeader &header)
+{
+  // Read a small block first, which contains the header of most files, and
+  // more data for headers with long comments
+  const size_t MAX_HEADER_SIZE = 1 << 16;
+  streampos start = file.tellg();
+  vector<unsigned char> buffer(512);
+  size_t size = 0;
+  PPMError error = PPM_IncompleteHeader;
+  while (error == PPM_IncompleteHeader && file.good()) {
+    file.read((char*)&buffer[size], buffer.size() - size);
+    size += (size_t)file.gcount();
+    error = ParsePPMHeader(&buffer[0], size, header);
+    if (buffer.size() >= MAX_HEADER_SIZE)
+      break;
+    buffer.resize(4 * buffer.size());
+  }
+  if (error != PPM_OK)
+    return (error == PPM_IncompleteHeader && file.bad()) ? PPM_FileError : error;
+  file.clear();
+  // Check if file contains all binary data
+  if (header.isBinary) {
+    file.seekg(0, ios::end);
+    streamoff available = file.tellg() - start - (streamoff)header.dataOffset;
+    if (!file.good() || available < 0 ||
+        (size_t)available / header.rowBytes < (size_t)header.height)
+      return file.good() ? PPM_TruncatedData : PPM_FileError;
+  }
+  file.seekg(start + (streamoff)header.dataOffset, ios::beg);
+  return file.good() ? PPM_OK : PPM_FileError;
+}
+
+const char *ImageIO::GetPPMErrorString(PPMError error)
+{
+  switch (error) {
+    case PPM_OK:
+      return "No error";
+    case PPM_FileError:
+      return "Failed to read from file";
+    case PPM_UnknownFormat:
+      return "Unknown image format found";
+    case PPM_IncompleteHeader:
+      return "Incomplete image header found";
+    case PPM_InvalidHeader:
+      return "Invalid image header found";
+    case PPM_InvalidSize:
+      return "Invalid image size found";
+    case PPM_InvalidMaxValue:
+      return "Invalid max. value found";
+    case PPM_TruncatedData:
+      return "File does not contain all image data";
+    default:
+      return "Unknown error";
+  }
+}
+
+string ImageIO::FormatPPMHeader(int w, int h, Image::ColorModel cm, int maxVal,
+                                bool plainText)
+{
+  ostringstream header;
+  if (cm == Image::CM_Gray)
+    header << (plainText ? "P2" : "P5") << "\n";
   else
-    file << "P6" << endl;
-  switch (image.GetColorModel()) {
+    header << (plainText ? "P3" : "P6") << "\n";
+  switch (cm) {
     case Image::CM_Gray:
-      file << "# CM_Gray" << endl;
+      header << "# CM_Gray\n";
       break;
     case Image::CM_RGB:
-      file << "# CM_RGB" << endl;
+      header << "# CM_RGB\n";
       break;
     case Image::CM_HSV:
-      file << "# CM_HSV" << endl;
+      header << "# CM_HSV\n";
+      break;
+    default:
       break;
   }
-  file << image.GetWidth() << " " << image.GetHeight() << endl;
-  file << 255 << endl;
-  // Write data bytes into file
-  int numBytes = image.GetNumBytes();
-  const unsigned char *dataPtr = image.GetData();
-  file.write((char*)dataPtr, numBytes);
-  file.close();
-  return true;
+  header << w << " " << h << "\n" << maxVal << "\n";
+  return header.str();
+}
+
+void ImageIO::DecodePPMRow(unsigned char *row, int n, int maxVal)
+{
+  if (maxVal > 255) {
+    unsigned short *d = (unsigned short*)row;
+    for (int i = 0; i < n; i++) {
+      unsigned int v = ((unsigned int)row[2*i] << 8) | row[2*i+1];
+      if (maxVal != 65535) {
+        if (v > (unsigned int)maxVal) v = maxVal;
+        v = (v * 65535 + maxVal / 2) / maxVal;
+      }
+      d[i] = (unsigned short)v;
+    }
+  } else if (maxVal < 255) {
+    for (int i = 0; i < n; i++) {
+      unsigned int v = row[i];
+      if (v > (unsigned int)maxVal) v = maxVal;
+      row[i] = (unsigned char)((v * 255 + maxVal / 2) / maxVal);
+    }
+  }
+}
+
+void ImageIO::UnmapPPM_(unsigned char * /* data */, void *context)
+{
+  UnmapFile((MappedFile*)context);
 }
 
 #ifdef BUILD_WITH_FREEIMAGE
 
-bool ImageIO::initFreeImageLib_ = false;
+void ImageIO::InitFreeImage_()
+{
+  // Initialization of local statics is thread-safe
+  static const bool initialized = InitFreeImageLib();
+  (void)initialized;
+  // Forget error messages of previous calls in this thread
+  freeImageError.clear();
+}
 
-bool ImageIO::LoadFreeImage(const string &filename, Image &image)
+bool ImageIO::LoadFreeImage(const string &filename, Image &image, int rowAlignment,
+                            Image::PixelLayout layout)
 {
-  // Initialize FreeImage library
-  if (!initFreeImageLib_) {
-    FreeImage_Initialise();
-    initFreeImageLib_ = true;
-  }
+  // Initialize FreeImage library (once for all threads)
+  InitFreeImage_();
 
   // Get image format from file or filename extension
   FREE_IMAGE_FORMAT tmpFormat = FreeImage_GetFileType(filename.c_str(), 0);
@@ -201,12 +1172,17 @@ bool ImageIO::LoadFreeImage(const string &filename, Image &image)
   if (FreeImage_FIFSupportsReading(tmpFormat))
     tmpImage = FreeImage_Load(tmpFormat, filename.c_str());
   if (!tmpImage) {
-    cerr << "ImageIO::LoadFreeImage() : Failed to load image using FreeImage!" << endl;
+    cerr << "ImageIO::LoadFreeImage() : Failed to load image using FreeImage"
+         << TakeFreeImageError() << "!" << endl;
     image.Release();
     return false;
   }
-  CreateFromFreeImage_(tmpImage, image);
-  FreeImage_Unload(tmpImage);
+  // Convert the FreeImage image in place and keep it as image data if its
+  // layout allows, copy it otherwise
+  if (!WrapFreeImage_(tmpImage, image, rowAlignment, layout)) {
+    CreateFromFreeImage_(tmpImage, image, rowAlignment, layout);
+    FreeImage_Unload(tmpImage);
+  }
   if (image.IsEmpty()) {
     cerr << "ImageIO::LoadFreeImage() : Failed to convert image from FreeImage!" << endl;
     return false;
@@ -215,6 +1191,11 @@ bool ImageIO::LoadFreeImage(const string &filename, Image &image)
 }
 
 bool ImageIO::SaveFreeImage(const string &filename, const Image &image)
+{
+  return SaveFreeImage(filename, ImageView(image));
+}
+
+bool ImageIO::SaveFreeImage(const string &filename, const ImageView &image)
 {
   // Check if image is empty
   if (image.IsEmpty()) {
@@ -222,11 +1203,8 @@ bool ImageIO::SaveFreeImage(const string &filename, const Image &image)
    return false;
   }
 
-  // Initialize FreeImage library
-  if (!initFreeImageLib_) {
-    FreeImage_Initialise();
-    initFreeImageLib_ = true;
-  }
+  // Initialize FreeImage library (once for all threads)
+  InitFreeImage_();
 
   // Get image format from file or filename extension
   FREE_IMAGE_FORMAT tmpFormat = FreeImage_GetFileType(filename.c_str(), 0);
@@ -246,13 +1224,14 @@ bool ImageIO::SaveFreeImage(const string &filename, const Image &image)
   BOOL success = FreeImage_Save(tmpFormat, tmpImage, filename.c_str());
   FreeImage_Unload(tmpImage);
   if (!success) {
-    cerr << "ImageIO::SaveFreeImage() : Failed to save image using FreeImage!" << endl;
+    cerr << "ImageIO::SaveFreeImage() : Failed to save image using FreeImage"
+         << TakeFreeImageError() << "!" << endl;
     return false;
   }
   return true;
 }
 
-void ImageIO::ConvertToFreeImage_(const Image &src, FIBITMAP* &dst)
+void ImageIO::ConvertToFreeImage_(const ImageView &src, FIBITMAP* &dst)
 {
   // Check if image is empty
   if (dst != NULL) {
@@ -262,33 +1241,58 @@ void ImageIO::ConvertToFreeImage_(const Image &src, FIBITMAP* &dst)
   if (src.IsEmpty())
     return;
 
-  // Create target image instance
+  // Create target image instance, 16-bit and float images are stored with
+  // the FreeImage types of the same precision (in RGB order)
   int w = src.GetWidth(), h = src.GetHeight(), ch = src.GetChannels();
+  if (src.GetPixelType() != Image::PT_UInt8) {
+    bool isFloat = (src.GetPixelType() == Image::PT_Float);
+    FREE_IMAGE_TYPE type = (ch == 3) ? (isFloat ? FIT_RGBF : FIT_RGB16)
+                                     : (isFloat ? FIT_FLOAT : FIT_UINT16);
+    int size = src.GetBytesPerValue();
+    dst = FreeImage_AllocateT(type, w, h, 8 * size * ch);
+    if (!dst) return;
+    int step = src.IsPlanar() ? size : ch * size;
+    for (int row = 0; row < h; row++) {
+      BYTE *bits = FreeImage_GetScanLine(dst, h-row-1);
+      if (!src.IsPlanar() || ch == 1) {
+        memcpy(bits, src.GetRow(row), w * ch * size);
+        continue;
+      }
+      for (int c = 0; c < ch; c++) {
+        const unsigned char *s = src.GetPlaneRow(c, row);
+        for (int col = 0; col < w; col++)
+          memcpy(bits + (col * ch + c) * size, s + col * step, size);
+      }
+    }
+    return;
+  }
   dst = FreeImage_Allocate(w, h, 8 * ch);
   if (!dst) return;
 
-  // Copy target image data from source image
+  // Copy target image data from source image (in interleaved or planar
+  // layout), planar rows are interleaved into the scanline first
   BYTE *bits = NULL;
-  const unsigned char *s = src.GetData();
   if (ch == 3) {
     for (int row = 0; row < h; row++) {
       bits = FreeImage_GetScanLine(dst, h-row-1);
-      for (int col = 0; col < w; col++, bits += ch) {
-        bits[FI_RGBA_RED] = *(s++);
-        bits[FI_RGBA_GREEN] = *(s++);
-        bits[FI_RGBA_BLUE] = *(s++);
+      if (src.IsPlanar()) {
+        ColorConversion::ConvertLayout(src.GetSubView(0, row, w, 1),
+                                       ImageView(bits, w, 1, 3 * w, src.GetColorModel()));
+        SwapRedBlueRow(bits, bits, w, 3);
+      } else {
+        SwapRedBlueRow(src.GetRow(row), bits, w, 3);
       }
     }
   } else {
     for (int row = 0; row < h; row++) {
       bits = FreeImage_GetScanLine(dst, h-row-1);
-      memcpy(bits, s, w * ch);
-      s += w * ch;
+      memcpy(bits, src.GetRow(row), w * ch);
     }
   }
 }
 
-void ImageIO::CreateFromFreeImage_(FIBITMAP* src, Image &dst)
+void ImageIO::CreateFromFreeImage_(FIBITMAP* src, Image &dst, int rowAlignment,
+                                   Image::PixelLayout layout)
 {
   // Check if image is empty
   if (src == NULL) {
@@ -296,6 +1300,49 @@ void ImageIO::CreateFromFreeImage_(FIBITMAP* src, Image &dst)
     return;
   }
 
+  // Copy 16-bit and float images into images of the same precision, convert
+  // other types to 8-bit images
+  FREE_IMAGE_TYPE imageType = FreeImage_GetImageType(src);
+  if (imageType != FIT_BITMAP) {
+    int ch = 0;
+    Image::PixelType type = Image::PT_UInt16;
+    switch (imageType) {
+      case FIT_UINT16: ch = 1; break;
+      case FIT_RGB16:  ch = 3; break;
+      case FIT_RGBA16: ch = 4; break;
+      case FIT_FLOAT:  ch = 1; type = Image::PT_Float; break;
+      case FIT_RGBF:   ch = 3; type = Image::PT_Float; break;
+      case FIT_RGBAF:  ch = 4; type = Image::PT_Float; break;
+      default: {
+        FIBITMAP *tmp = FreeImage_ConvertToStandardType(src, TRUE);
+        CreateFromFreeImage_(tmp, dst, rowAlignment, layout);
+        if (tmp != NULL)
+          FreeImage_Unload(tmp);
+        return;
+      }
+    }
+    int w = FreeImage_GetWidth(src), h = FreeImage_GetHeight(src);
+    dst.Init(w, h, (ch == 1) ? Image::CM_Gray : Image::CM_RGB, rowAlignment, layout, type);
+    if (dst.IsEmpty())
+      return;
+    // Values are stored in RGB(A) order, copy the first (up to) 3 channels
+    int size = dst.GetBytesPerValue();
+    int step = dst.IsPlanar() ? size : dst.GetChannels() * size;
+    for (int row = 0; row < h; row++) {
+      const BYTE *bits = FreeImage_GetScanLine(src, h-row-1);
+      if (ch == dst.GetChannels() && (!dst.IsPlanar() || ch == 1)) {
+        memcpy(dst.GetRow(row), bits, w * ch * size);
+        continue;
+      }
+      for (int c = 0; c < dst.GetChannels(); c++) {
+        unsigned char *d = dst.GetPlaneRow(c, row);
+        for (int col = 0; col < w; col++)
+          memcpy(d + col * step, bits + (col * ch + c) * size, size);
+      }
+    }
+    return;
+  }
+
   // Retrieve source image data
   BYTE *bits = FreeImage_GetBits(src);
   int w = FreeImage_GetWidth(src);
@@ -312,34 +1359,108 @@ void ImageIO::CreateFromFreeImage_(FIBITMAP* src, Image &dst)
 
   // Copy source image data to target image
   Image::ColorModel cm = (ch < 3) ? Image::CM_Gray : Image::CM_RGB;
-  dst.Init(w, h, cm);
-  unsigned char *d = dst.GetData();
+  dst.Init(w, h, cm, rowAlignment, layout);
+  if (dst.IsEmpty())
+    return;
+  int step = dst.IsPlanar() ? 1 : 3;
   if (colorType == FIC_PALETTE) {
     RGBQUAD *pal = FreeImage_GetPalette(src);
     for (int row = 0; row < h; row++) {
+      unsigned char *r = dst.GetPlaneRow(0, row), *g = dst.GetPlaneRow(1, row),
+                    *b = dst.GetPlaneRow(2, row);
       bits = FreeImage_GetScanLine(src, h-row-1);
-      for (int col = 0; col < w; col++, bits++) {
-        *(d++) = pal[*bits].rgbRed;
-        *(d++) = pal[*bits].rgbGreen;
-        *(d++) = pal[*bits].rgbBlue;
+      for (int col = 0, i = 0; col < w; col++, i += step, bits++) {
+        r[i] = pal[*bits].rgbRed;
+        g[i] = pal[*bits].rgbGreen;
+        b[i] = pal[*bits].rgbBlue;
       }
     }
+  } else if ((ch == 3 || ch == 4) && !dst.IsPlanar()) {
+    for (int row = 0; row < h; row++)
+      SwapRedBlueRow(FreeImage_GetScanLine(src, h-row-1), dst.GetRow(row), w, ch);
   } else if (ch == 3 || ch == 4) {
     for (int row = 0; row < h; row++) {
+      unsigned char *r = dst.GetPlaneRow(0, row), *g = dst.GetPlaneRow(1, row),
+                    *b = dst.GetPlaneRow(2, row);
       bits = FreeImage_GetScanLine(src, h-row-1);
-      for (int col = 0; col < w; col++, bits += ch) {
-        *(d++) = bits[FI_RGBA_RED];
-        *(d++) = bits[FI_RGBA_GREEN];
-        *(d++) = bits[FI_RGBA_BLUE];
+      for (int col = 0, i = 0; col < w; col++, i += step, bits += ch) {
+        r[i] = bits[FI_RGBA_RED];
+        g[i] = bits[FI_RGBA_GREEN];
+        b[i] = bits[FI_RGBA_BLUE];
       }
     }
   } else {
     for (int row = 0; row < h; row++) {
+      unsigned char *d = dst.GetRow(row);
       bits = FreeImage_GetScanLine(src, h-row-1);
+      if (ch == 1) {
+        memcpy(d, bits, w);
+        continue;
+      }
       for (int col = 0; col < w; col++, bits += ch)
         *(d++) = *bits;
     }
   }
 }
 
+bool ImageIO::WrapFreeImage_(FIBITMAP* src, Image &dst, int rowAlignment,
+                             Image::PixelLayout layout)
+{
+  // Check if the bitmap stores interleaved gray or RGB(A) values which can
+  // be converted in place (palette images are copied)
+  int w = FreeImage_GetWidth(src), h = FreeImage_GetHeight(src);
+  int ch = 0, size = 1, srcStep = 0;
+  Image::PixelType type = Image::PT_UInt8;
+  bool swap = false;
+  switch (FreeImage_GetImageType(src)) {
+    case FIT_BITMAP:
+      if (FreeImage_GetBPP(src) == 8 && FreeImage_GetColorType(src) == FIC_MINISBLACK) {
+        ch = 1;
+      } else if ((FreeImage_GetBPP(src) == 24 || FreeImage_GetBPP(src) == 32) &&
+                 FreeImage_GetColorType(src) != FIC_PALETTE) {
+        ch = 3;
+        srcStep = FreeImage_GetBPP(src) / 8;
+        swap = true;
+      }
+      break;
+    case FIT_UINT16: ch = 1; size = 2; type = Image::PT_UInt16; break;
+    case FIT_RGB16:  ch = 3; size = 2; type = Image::PT_UInt16; break;
+    case FIT_FLOAT:  ch = 1; size = 4; type = Image::PT_Float; break;
+    case FIT_RGBF:   ch = 3; size = 4; type = Image::PT_Float; break;
+    default: break;
+  }
+  BYTE *bits = FreeImage_GetBits(src);
+  int pitch = (int)FreeImage_GetPitch(src);
+  if (ch == 0 || bits == NULL || w <= 0 || h <= 0 ||
+      (layout == Image::PL_Planar && ch == 3) ||
+      (size_t)bits % (size_t)rowAlignment != 0 || pitch % rowAlignment != 0)
+    return false;
+  // Flip rows (FreeImage stores the bottom row first) by exchanging pairs of
+  // rows, swapping the color channels on the way
+  int rowBytes = w * ch * size;
+  vector<unsigned char> tmp(swap ? w * srcStep : rowBytes);
+  for (int top = 0, bottom = h - 1; top <= bottom; top++, bottom--) {
+    unsigned char *t = bits + (size_t)top * pitch, *b = bits + (size_t)bottom * pitch;
+    memcpy(&tmp[0], t, tmp.size());
+    if (swap) {
+      if (top < bottom)
+        SwapRedBlueRow(b, t, w, srcStep);
+      SwapRedBlueRow(&tmp[0], b, w, srcStep);
+    } else {
+      if (top < bottom)
+        memcpy(t, b, rowBytes);
+      memcpy(b, &tmp[0], rowBytes);
+    }
+  }
+  // The bitmap is unloaded when the image is released
+  dst.Attach(w, h, (ch == 1) ? Image::CM_Gray : Image::CM_RGB, bits,
+             UnloadFreeImage_, src, false, pitch, type);
+  return true;
+}
+
+void ImageIO::UnloadFreeImage_(unsigned char * /* data */, void *context)
+{
+  FreeImage_Unload((FIBITMAP*)context);
+}
+
 #endif // BUILD_WITH_FREEIMAGE
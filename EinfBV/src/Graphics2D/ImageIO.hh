@@ -6,7 +6,12 @@
 #endif
 
 #include "Image.hh"
+#include "ImageView.hh"
 #include <string>
+#include <istream>
+#include <ostream>
+#include <vector>
+#include <cstddef>
 
 /** @class ImageIO
     @brief Abstract class containing static methods to load and save images
@@ -23,53 +28,251 @@ class ImageIO
 {
 public:
 
-  /** @brief Load image from file.
+  /** @brief Load image from file. Rows of the loaded image are aligned to
+             the given row alignment and color images are stored in the
+             given pixel layout (see Image::Init()). For PPM/PGM files the
+             memory of the image is reused if it is large enough, e.g. when
+             loading a sequence of images of the same size (see ImageLoader).
+             Other formats are decoded by FreeImage into a new bitmap, which
+             usually replaces the memory of the image.
       @return Returns true in case of success. */
-  static bool Load(const std::string &filename, Image &image);
+  static bool Load(const std::string &filename, Image &image,
+                   int rowAlignment = 1,
+                   Image::PixelLayout layout = Image::PL_Interleaved);
+
+  /** @brief Properties of an image file as returned by ReadInfo() */
+  struct ImageInfo
+  {
+    int width, height, channels;
+    Image::ColorModel colorModel;
+    /** @brief Pixel type of the image loaded by Load() */
+    Image::PixelType pixelType;
+  };
+
+  /** @brief Read size, number of channels, color model and pixel type of
+             the image which Load() would load from the file, without
+             reading pixel data, e.g. to allocate buffers before loading.
+             Only the header of Portable PixMap files is read, other formats
+             are read with FreeImage's header-only load flag if supported
+             by the format.
+      @return Returns true in case of success. */
+  static bool ReadInfo(const std::string &filename, ImageInfo &info);
 
   /** @brief Save image to file.
       @return Returns true in case of success. */
   static bool Save(const std::string &filename, const Image &image);
 
+  /** @brief Save image region referenced by the view to file.
+      @return Returns true in case of success. */
+  static bool Save(const std::string &filename, const ImageView &image);
+
+  /** @brief Load image from encoded image data in memory, e.g. received
+             from a network connection. Portable PixMap data is detected by
+             its magic number, other formats are decoded by the FreeImage
+             library (see LoadFreeImage()). Rows are aligned to the given row
+             alignment, color images are stored in the given pixel layout.
+      @return Returns true in case of success. */
+  static bool LoadFromMemory(const unsigned char *data, size_t size, Image &image,
+                             int rowAlignment = 1,
+                             Image::PixelLayout layout = Image::PL_Interleaved);
+
+  /** @brief Encode image into the buffer in the format given by a file
+             extension, e.g. "ppm" (binary data) or "png" (using FreeImage).
+             The buffer is resized to the encoded size, it keeps its
+             capacity, so reusing it for images of similar size avoids
+             allocating memory for every image.
+      @return Returns true in case of success. */
+  static bool SaveToMemory(const Image &image, std::vector<unsigned char> &buffer,
+                           const std::string &format = "ppm");
+
+  /** @brief Encode image region referenced by the view into the buffer
+             (see SaveToMemory(const Image&, std::vector<unsigned char>&, const std::string&)).
+      @return Returns true in case of success. */
+  static bool SaveToMemory(const ImageView &image, std::vector<unsigned char> &buffer,
+                           const std::string &format = "ppm");
+
   /** @brief Load image from Portable PixMap or Portable GrayMap file.
+             Rows are aligned to the given row alignment, color images are
+             stored in the given pixel layout. Files with a max. value above
+             255 are loaded as 16-bit images (see Image::PixelType), values
+             are scaled to the full range of the pixel type.
       @return Returns true in case of success. */
-  static bool LoadPPM(const std::string &filename, Image &image);
+  static bool LoadPPM(const std::string &filename, Image &image,
+                      int rowAlignment = 1,
+                      Image::PixelLayout layout = Image::PL_Interleaved);
 
   /** @brief Save image to Portable PixMap or Portable GrayMap file.
+             Image data is written in binary format (P5/P6) by default, or
+             in plain text format (P2/P3) if plainText is set. 16-bit and
+             float images are written with 16-bit values (max. value 65535).
+      @return Returns true in case of success. */
+  static bool SavePPM(const std::string &filename, const Image &image,
+                      bool plainText = false);
+
+  /** @brief Save image region referenced by the view to Portable PixMap or
+             Portable GrayMap file (see SavePPM(const std::string&, const Image&, bool)).
+      @return Returns true in case of success. */
+  static bool SavePPM(const std::string &filename, const ImageView &image,
+                      bool plainText = false);
+
+  /** @brief Load image from binary Portable PixMap or Portable GrayMap file
+             (P5/P6) by mapping the file into memory. The image wraps the
+             mapped pixel data without copying it (see Image::Attach()), so
+             pixels are only read from disk when they are accessed, and the
+             image always uses interleaved layout. The file is unmapped when
+             the image is released.
+             The file is mapped copy-on-write, so modifying the image never
+             changes the file. If copyOnWrite is not set, the image is
+             read-only (see Image::IsReadOnly()). Plain text files
+             (P2/P3) and files with a max. value other than 255 are loaded
+             with LoadPPM() instead.
       @return Returns true in case of success. */
-  static bool SavePPM(const std::string &filename, const Image &image);
+  static bool LoadPPMMapped(const std::string &filename, Image &image,
+                            bool copyOnWrite = false);
+
+  /** @brief Result codes of ParsePPMHeader() and ReadPPMHeader() */
+  enum PPMError {
+    PPM_OK,               ///< Header is valid
+    PPM_FileError,        ///< File could not be opened or read
+    PPM_UnknownFormat,    ///< Magic number is not P2, P3, P5 or P6
+    PPM_IncompleteHeader, ///< Data ends before the end of the header
+    PPM_InvalidHeader,    ///< Unexpected character in the header
+    PPM_InvalidSize,      ///< Width or height is 0 or the data size overflows
+    PPM_InvalidMaxValue,  ///< Max. value is not in range [1, 65535]
+    PPM_TruncatedData     ///< File does not contain all binary image data
+  };
+
+  /** @brief Properties of a Portable PixMap or Portable GrayMap file as
+             given by its header */
+  struct PPMHeader
+  {
+    int width, height, channels, maxVal;
+    /** @brief Color model including color model comments (see LoadPPM()) */
+    Image::ColorModel colorModel;
+    /** @brief Pixel type of loaded images, PT_UInt16 for max. values above 255 */
+    Image::PixelType pixelType;
+    /** @brief Set for binary data (P5/P6), unset for plain text (P2/P3) */
+    bool isBinary;
+    /** @brief Set if a color model comment did not match the number of
+               channels and was ignored */
+    bool ignoredColorModel;
+    /** @brief Offset of the first data byte in the file */
+    size_t dataOffset;
+    /** @brief Number of bytes per row of binary data */
+    size_t rowBytes;
+  };
+
+  /** @brief Parse header of Portable PixMap or Portable GrayMap file from
+             memory in a single pass, including the color model comments
+             written by SavePPM(). Validates the magic number, size and max.
+             value and rejects sizes whose binary data size overflows. Does
+             not check if the data contains all pixel data and does not print
+             errors. Used by LoadPPMMapped() and ReadPPMHeader().
+      @return Returns PPM_OK in case of success, PPM_IncompleteHeader if
+              more data is needed to parse the header. */
+  static PPMError ParsePPMHeader(const unsigned char *data, size_t size,
+                                 PPMHeader &header);
+
+  /** @brief Read and parse header of Portable PixMap or Portable GrayMap
+             file from the current position of the stream, reading only as
+             much of the file as needed. For binary data, checks if the file
+             contains all image data. In case of success, the stream is
+             positioned at the first data byte. Used by LoadPPM() and
+             PPMReader.
+      @return Returns PPM_OK in case of success. */
+  static PPMError ReadPPMHeader(std::istream &file, PPMHeader &header);
+
+  /** @brief Returns description of the given result code. */
+  static const char *GetPPMErrorString(PPMError error);
+
+  /** @brief Returns header of Portable PixMap or Portable GrayMap file with
+             given size, color model (written as comment, see LoadPPM())
+             and max. value, for binary (P5/P6) or plain text (P2/P3) data.
+             Used by SavePPM() and PPMWriter. */
+  static std::string FormatPPMHeader(int w, int h, Image::ColorModel cm,
+                                     int maxVal, bool plainText = false);
+
+  /** @brief Convert row of n binary values as stored in a PPM file with
+             given max. value to full range values in place, i.e. to 8-bit
+             values for max. values up to 255 and to 16-bit values in native
+             byte order otherwise. 16-bit values are stored most significant
+             byte first in PPM files. Values above the max. value are
+             saturated. */
+  static void DecodePPMRow(unsigned char *row, int n, int maxVal);
 
 #ifdef BUILD_WITH_FREEIMAGE
 
   /** @brief Load image from file using the FreeImage library.
+             Rows are aligned to the given row alignment, color images are
+             stored in the given pixel layout. 16-bit and float images are
+             loaded as images of the same pixel type, other images as 8-bit
+             images.
       @return Returns true in case of success. */
-  static bool LoadFreeImage(const std::string &filename, Image &image);
+  static bool LoadFreeImage(const std::string &filename, Image &image,
+                            int rowAlignment = 1,
+                            Image::PixelLayout layout = Image::PL_Interleaved);
 
-  /** @brief Save image to file using the FreeImage library.
+  /** @brief Save image to file using the FreeImage library. 16-bit and float
+             images are only supported by some formats, e.g. PNG or TIFF.
       @return Returns true in case of success. */
   static bool SaveFreeImage(const std::string &filename, const Image &image);
 
+  /** @brief Save image region referenced by the view to file using the
+             FreeImage library.
+      @return Returns true in case of success. */
+  static bool SaveFreeImage(const std::string &filename, const ImageView &image);
+
 #endif
 
 private:
 
 #ifdef BUILD_WITH_FREEIMAGE
 
-  /** @brief Stores if FreeImage library has been initialized */
-  static bool initFreeImageLib_;
+  /** @brief Initialize FreeImage library on first use, thread-safe. All
+             other methods keep their state in local variables, so images
+             can be loaded and saved from several threads concurrently. */
+  static void InitFreeImage_();
 
-  /** @brief Create FreeImage image from given image.
+  /** @brief Create FreeImage image from given image region.
       @attention If pointer dst is not NULL, it is released first!
    */
-  static void ConvertToFreeImage_(const Image &src, FIBITMAP* &dst);
+  static void ConvertToFreeImage_(const ImageView &src, FIBITMAP* &dst);
 
-  /** @brief Convert given FreeImage image to image.
+  /** @brief Convert given FreeImage image to image with given row alignment
+             and pixel layout.
       @attention If pointer src is NULL, an empty image dst is returned!
    */
-  static void CreateFromFreeImage_(FIBITMAP* src, Image &dst);
+  static void CreateFromFreeImage_(FIBITMAP* src, Image &dst, int rowAlignment,
+                                   Image::PixelLayout layout);
+
+  /** @brief Convert given FreeImage image in place to the row order, channel
+             order and layout of an image and attach it to the image, which
+             unloads it when released. Only interleaved gray and RGB(A)
+             images whose data is aligned to the given row alignment are
+             converted, the alpha channel is dropped.
+      @return Returns false if the FreeImage image was not converted, it
+              must then be copied by CreateFromFreeImage_() and unloaded. */
+  static bool WrapFreeImage_(FIBITMAP* src, Image &dst, int rowAlignment,
+                             Image::PixelLayout layout);
+
+  /** @brief Release callback for images created by WrapFreeImage_(). */
+  static void UnloadFreeImage_(unsigned char *data, void *context);
 
 #endif
 
+  /** @brief Load image from Portable PixMap data read from the stream, the
+             method name is used for error messages. The image is released
+             in case of failure. */
+  static bool LoadPPM_(std::istream &file, Image &image, int rowAlignment,
+                       Image::PixelLayout layout, const char *method);
+
+  /** @brief Write image region as Portable PixMap data to the stream.
+      @return Returns true in case of success. */
+  static bool SavePPM_(std::ostream &file, const ImageView &image, bool plainText);
+
+  /** @brief Release callback for images created by LoadPPMMapped(). */
+  static void UnmapPPM_(unsigned char *data, void *context);
+
   /** @brief Constructor is private for pure static class. */
   ImageIO();
 
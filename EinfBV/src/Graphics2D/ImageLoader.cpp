@@ -0,0 +1,170 @@
+#include "ImageLoader.hh"
+#include "ImageIO.hh"
+#include <chrono>
+#include <iostream>
+
+using namespace std;
+
+ImageLoader::ImageLoader(int numBuffers, int numThreads)
+  : buffers_(numBuffers > 0 ? numBuffers : 0),
+    numThreads_(numThreads > 0 ? numThreads : 1),
+    rowAlignment_(1), layout_(Image::PL_Interleaved),
+    nextLoad_(0), nextOut_(0), stop_(false), stallMs_(0.0), numStalls_(0)
+{
+  for (size_t i = 0; i < buffers_.size(); i++) {
+    buffers_[i].index = -1;
+    buffers_[i].state = BS_Free;
+  }
+}
+
+ImageLoader::~ImageLoader()
+{
+  Close();
+}
+
+bool ImageLoader::Open(const vector<string> &filenames, int rowAlignment,
+                       Image::PixelLayout layout)
+{
+  Close();
+  if (buffers_.empty()) {
+    cerr << "ImageLoader::Open() : No image buffers available!" << endl;
+    return false;
+  }
+  filenames_ = filenames;
+  rowAlignment_ = rowAlignment;
+  layout_ = layout;
+  nextLoad_ = nextOut_ = 0;
+  stop_ = false;
+  stallMs_ = 0.0;
+  numStalls_ = 0;
+  for (int i = 0; i < numThreads_; i++)
+    threads_.push_back(thread(&ImageLoader::LoadFiles_, this));
+  return true;
+}
+
+void ImageLoader::Close()
+{
+  {
+    lock_guard<mutex> lock(mutex_);
+    stop_ = true;
+  }
+  changed_.notify_all();
+  for (size_t i = 0; i < threads_.size(); i++)
+    threads_[i].join();
+  threads_.clear();
+  for (size_t i = 0; i < buffers_.size(); i++) {
+    buffers_[i].index = -1;
+    buffers_[i].state = BS_Free;
+  }
+  filenames_.clear();
+  nextLoad_ = nextOut_ = 0;
+}
+
+Image *ImageLoader::Next(string *filename)
+{
+  unique_lock<mutex> lock(mutex_);
+  if (nextOut_ >= (int)filenames_.size())
+    return NULL;
+  // Wait until the next file is loaded
+  chrono::steady_clock::time_point start;
+  bool stalled = false;
+  Buffer_ *next = NULL;
+  for (;;) {
+    bool pending = false, free = false;
+    for (size_t i = 0; i < buffers_.size(); i++) {
+      Buffer_ &buffer = buffers_[i];
+      if (buffer.index == nextOut_ && buffer.state == BS_Ready)
+        next = &buffer;
+      else if (buffer.index == nextOut_ && buffer.state == BS_Loading)
+        pending = true;
+      else if (buffer.state == BS_Free)
+        free = true;
+    }
+    if (next != NULL)
+      break;
+    if (!pending && !free) {
+      cerr << "ImageLoader::Next() : All image buffers are in use, release images first!" << endl;
+      return NULL;
+    }
+    if (!stalled) {
+      start = chrono::steady_clock::now();
+      stalled = true;
+    }
+    changed_.wait(lock);
+  }
+  if (stalled) {
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+    stallMs_ += elapsed.count();
+    numStalls_++;
+  }
+  next->state = BS_InUse;
+  if (filename != NULL)
+    *filename = filenames_[nextOut_];
+  nextOut_++;
+  return &next->image;
+}
+
+void ImageLoader::Release(Image *image)
+{
+  {
+    lock_guard<mutex> lock(mutex_);
+    size_t i = 0;
+    while (i < buffers_.size() && &buffers_[i].image != image)
+      i++;
+    if (i == buffers_.size() || buffers_[i].state != BS_InUse) {
+      cerr << "ImageLoader::Release() : Image was not returned by Next()!" << endl;
+      return;
+    }
+    // Keep the image memory for the next file
+    buffers_[i].index = -1;
+    buffers_[i].state = BS_Free;
+  }
+  changed_.notify_all();
+}
+
+int ImageLoader::GetNumFiles() const
+{
+  lock_guard<mutex> lock(mutex_);
+  return (int)filenames_.size();
+}
+
+double ImageLoader::GetStallMs() const
+{
+  lock_guard<mutex> lock(mutex_);
+  return stallMs_;
+}
+
+int ImageLoader::GetNumStalls() const
+{
+  lock_guard<mutex> lock(mutex_);
+  return numStalls_;
+}
+
+void ImageLoader::LoadFiles_()
+{
+  unique_lock<mutex> lock(mutex_);
+  for (;;) {
+    // Wait for a free buffer while files are left to load
+    Buffer_ *buffer = NULL;
+    while (!stop_ && nextLoad_ < (int)filenames_.size()) {
+      for (size_t i = 0; i < buffers_.size() && buffer == NULL; i++)
+        if (buffers_[i].state == BS_Free)
+          buffer = &buffers_[i];
+      if (buffer != NULL)
+        break;
+      changed_.wait(lock);
+    }
+    if (buffer == NULL)
+      return;
+    // Load file without holding the lock
+    int index = nextLoad_++;
+    buffer->index = index;
+    buffer->state = BS_Loading;
+    const string &filename = filenames_[index];
+    lock.unlock();
+    ImageIO::Load(filename, buffer->image, rowAlignment_, layout_);
+    lock.lock();
+    buffer->state = BS_Ready;
+    changed_.notify_all();
+  }
+}
@@ -0,0 +1,119 @@
+#ifndef __ImageLoader_hh__
+#define __ImageLoader_hh__
+
+#include "Image.hh"
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** @class ImageLoader
+    @brief Loads a sequence of image files in order with ImageIO::Load(),
+           prefetching the next files on background threads, e.g. to process
+           the frames of a video stored as single files without waiting for
+           the disk.
+
+    The loader owns a fixed number of image buffers. Next() returns the next
+    image of the sequence and Release() hands it back to the loader, which
+    then loads a following file into the same buffer, so PPM/PGM images of
+    the same size are loaded without allocating memory. Other formats are
+    decoded by FreeImage into a new bitmap for every file, which usually
+    replaces the buffer. The time Next() had to wait for a file being loaded is
+    reported as stall time.
+
+    @code
+    ImageLoader loader(4);
+    loader.Open(filenames);
+    while (Image *image = loader.Next()) {
+      if (!image->IsEmpty())
+        ; // process image
+      loader.Release(image);
+    }
+    @endcode
+
+    @attention Next() and Release() must be called from one thread only.
+ */
+class ImageLoader
+{
+public:
+
+  /** @brief Create loader with numBuffers image buffers, i.e. up to
+             numBuffers images are prefetched or held by the caller, loaded
+             by numThreads background threads. */
+  explicit ImageLoader(int numBuffers = 4, int numThreads = 1);
+
+  /** @brief Destructor stops loading (see Close()). */
+  ~ImageLoader();
+
+  /** @brief Start loading the given files in order, images are loaded with
+             the given row alignment and pixel layout (see ImageIO::Load()).
+             Stops loading the previous sequence first.
+      @return Returns false if the loader has no image buffers. */
+  bool Open(const std::vector<std::string> &filenames, int rowAlignment = 1,
+            Image::PixelLayout layout = Image::PL_Interleaved);
+
+  /** @brief Stop loading and wait for the background threads. Images
+             returned by Next() become invalid, the memory of the image
+             buffers is kept for the next sequence. */
+  void Close();
+
+  /** @brief Returns next image of the sequence, waiting until it is loaded,
+             and stores its file name in filename if given. The image is
+             empty if the file could not be loaded. The image remains valid
+             until it is handed back with Release().
+      @return Returns NULL after the last image or if all image buffers are
+              held by the caller. */
+  Image *Next(std::string *filename = NULL);
+
+  /** @brief Hand image returned by Next() back to the loader. */
+  void Release(Image *image);
+
+  /** @brief Returns number of files of the sequence. */
+  int GetNumFiles() const;
+
+  /** @brief Returns total time in milliseconds Next() waited for images
+             being loaded since Open(). */
+  double GetStallMs() const;
+
+  /** @brief Returns number of calls of Next() which had to wait since
+             Open(). */
+  int GetNumStalls() const;
+
+private:
+
+  /** @brief States of image buffers */
+  enum BufferState_ { BS_Free, BS_Loading, BS_Ready, BS_InUse };
+
+  /** @brief Image buffer with index of the file loaded into it */
+  struct Buffer_
+  {
+    Image image;
+    int index;
+    BufferState_ state;
+  };
+
+  /** @brief Load files into free buffers until the sequence is complete. */
+  void LoadFiles_();
+
+  std::vector<Buffer_> buffers_;
+  std::vector<std::thread> threads_;
+  int numThreads_;
+  std::vector<std::string> filenames_;
+  int rowAlignment_;
+  Image::PixelLayout layout_;
+  /** @brief Index of next file to be loaded and returned by Next() */
+  int nextLoad_, nextOut_;
+  bool stop_;
+  double stallMs_;
+  int numStalls_;
+  mutable std::mutex mutex_;
+  std::condition_variable changed_;
+
+  /** @brief Loader cannot be copied. */
+  ImageLoader(const ImageLoader&);
+  ImageLoader &operator=(const ImageLoader&);
+
+};
+
+#endif // __ImageLoader_hh__
@@ -0,0 +1,517 @@
+#include "ImageView.hh"
+#include "CpuFeatures.hh"
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+
+#ifdef SIMD_X86
+#  include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+/** Blend function for n 8-bit values with given source values and opacities. */
+typedef void (*BlendFunction)(unsigned char *d, const unsigned char *src,
+                              const unsigned char *alpha, int n);
+
+/** Reference implementation, SIMD versions compute identical results. */
+void BlendScalar(unsigned char *d, const unsigned char *src,
+                 const unsigned char *alpha, int n)
+{
+  for (int i = 0; i < n; i++)
+    d[i] = (unsigned char)((src[i] * alpha[i] + d[i] * (255 - alpha[i]) + 127) / 255);
+}
+
+#ifdef SIMD_X86
+
+/** Blend 16 values per step in 16 bit integers, division by 255 is done as
+    floor(y / 255) = (y + 1 + (y >> 8)) >> 8, exact for y < 65535. */
+SIMD_TARGET_SSSE3 void BlendSSSE3(unsigned char *d, const unsigned char *src,
+                                  const unsigned char *alpha, int n)
+{
+  const __m128i zero = _mm_setzero_si128(), one = _mm_set1_epi16(1);
+  const __m128i full = _mm_set1_epi16(255), round = _mm_set1_epi16(127);
+  int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(d + i));
+    __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+    __m128i a = _mm_loadu_si128((const __m128i *)(alpha + i));
+    __m128i result[2];
+    for (int j = 0; j < 2; j++) {
+      __m128i vj = j ? _mm_unpackhi_epi8(v, zero) : _mm_unpacklo_epi8(v, zero);
+      __m128i sj = j ? _mm_unpackhi_epi8(s, zero) : _mm_unpacklo_epi8(s, zero);
+      __m128i aj = j ? _mm_unpackhi_epi8(a, zero) : _mm_unpacklo_epi8(a, zero);
+      __m128i y = _mm_add_epi16(_mm_mullo_epi16(sj, aj),
+                                _mm_mullo_epi16(vj, _mm_sub_epi16(full, aj)));
+      y = _mm_add_epi16(y, round);
+      y = _mm_add_epi16(y, _mm_add_epi16(one, _mm_srli_epi16(y, 8)));
+      result[j] = _mm_srli_epi16(y, 8);
+    }
+    _mm_storeu_si128((__m128i *)(d + i), _mm_packus_epi16(result[0], result[1]));
+  }
+  BlendScalar(d + i, src + i, alpha + i, n - i);
+}
+
+#endif
+
+/** Returns the fastest supported blend function, selected on first use. */
+BlendFunction GetBlendFunction()
+{
+#ifdef SIMD_X86
+  static const BlendFunction function = CpuFeatures::HasSSSE3() ? BlendSSSE3 : BlendScalar;
+  return function;
+#else
+  return BlendScalar;
+#endif
+}
+
+/** Number of pixels blended per chunk with temporary buffers on the stack. */
+const int BLEND_CHUNK = 256;
+
+} // namespace
+
+ImageView::ImageView()
+  : data_(NULL), width_(0), height_(0), stride_(0), planeStride_(0), channels_(0),
+    colorModel_(Image::CM_None), pixelType_(Image::PT_UInt8), valueSize_(1),
+    readOnly_(false)
+{
+}
+
+ImageView::ImageView(Image &image)
+  : data_(NULL), width_(0), height_(0), stride_(0), planeStride_(0), channels_(0),
+    colorModel_(Image::CM_None), pixelType_(Image::PT_UInt8), valueSize_(1),
+    readOnly_(false)
+{
+  Init_(image.GetData(), image.GetWidth(), image.GetHeight(),
+        image.GetStride(), image.GetPlaneStride(), image.GetChannels(),
+        image.GetColorModel(), image.GetPixelType(), image.IsReadOnly(),
+        0, 0, image.GetWidth(), image.GetHeight());
+}
+
+ImageView::ImageView(const Image &image)
+  : data_(NULL), width_(0), height_(0), stride_(0), planeStride_(0), channels_(0),
+    colorModel_(Image::CM_None), pixelType_(Image::PT_UInt8), valueSize_(1),
+    readOnly_(false)
+{
+  Init_((unsigned char*)image.GetData(), image.GetWidth(), image.GetHeight(),
+        image.GetStride(), image.GetPlaneStride(), image.GetChannels(),
+        image.GetColorModel(), image.GetPixelType(), true,
+        0, 0, image.GetWidth(), image.GetHeight());
+}
+
+ImageView::ImageView(Image &image, int x, int y, int w, int h)
+  : data_(NULL), width_(0), height_(0), stride_(0), planeStride_(0), channels_(0),
+    colorModel_(Image::CM_None), pixelType_(Image::PT_UInt8), valueSize_(1),
+    readOnly_(false)
+{
+  Init_(image.GetData(), image.GetWidth(), image.GetHeight(),
+        image.GetStride(), image.GetPlaneStride(), image.GetChannels(),
+        image.GetColorModel(), image.GetPixelType(), image.IsReadOnly(),
+        x, y, w, h);
+}
+
+ImageView::ImageView(const Image &image, int x, int y, int w, int h)
+  : data_(NULL), width_(0), height_(0), stride_(0), planeStride_(0), channels_(0),
+    colorModel_(Image::CM_None), pixelType_(Image::PT_UInt8), valueSize_(1),
+    readOnly_(false)
+{
+  Init_((unsigned char*)image.GetData(), image.GetWidth(), image.GetHeight(),
+        image.GetStride(), image.GetPlaneStride(), image.GetChannels(),
+        image.GetColorModel(), image.GetPixelType(), true,
+        x, y, w, h);
+}
+
+ImageView::ImageView(unsigned char *data, int w, int h, int stride,
+                     Image::ColorModel cm, bool readOnly, Image::PixelType type)
+  : data_(NULL), width_(0), height_(0), stride_(0), planeStride_(0), channels_(0),
+    colorModel_(Image::CM_None), pixelType_(Image::PT_UInt8), valueSize_(1),
+    readOnly_(false)
+{
+  int channels = (cm == Image::CM_Gray) ? 1 : ((cm == Image::CM_None) ? 0 : 3);
+  if (stride < w * channels * Image::GetBytesPerValue(type)) {
+    cerr << "ImageView::ImageView() : Invalid stride!" << endl;
+    return;
+  }
+  Init_(data, w, h, stride, 0, channels, cm, type, readOnly, 0, 0, w, h);
+}
+
+ImageView::ImageView(Image &image, int ch)
+  : data_(NULL), width_(0), height_(0), stride_(0), planeStride_(0), channels_(0),
+    colorModel_(Image::CM_None), pixelType_(Image::PT_UInt8), valueSize_(1),
+    readOnly_(false)
+{
+  InitPlane_(image, ch, image.IsReadOnly());
+}
+
+ImageView::ImageView(const Image &image, int ch)
+  : data_(NULL), width_(0), height_(0), stride_(0), planeStride_(0), channels_(0),
+    colorModel_(Image::CM_None), pixelType_(Image::PT_UInt8), valueSize_(1),
+    readOnly_(false)
+{
+  InitPlane_(image, ch, true);
+}
+
+void ImageView::InitPlane_(const Image &image, int ch, bool readOnly)
+{
+  if (ch < 0 || ch >= image.GetChannels() ||
+      (image.GetChannels() > 1 && !image.IsPlanar())) {
+    cerr << "ImageView::ImageView() : Channel is no plane of the image!" << endl;
+    return;
+  }
+  Init_((unsigned char*)image.GetPlaneRow(ch, 0), image.GetWidth(), image.GetHeight(),
+        image.GetStride(), 0, 1, Image::CM_Gray, image.GetPixelType(), readOnly,
+        0, 0, image.GetWidth(), image.GetHeight());
+}
+
+void ImageView::Init_(unsigned char *data, int dataWidth, int dataHeight,
+                      int stride, int planeStride, int channels,
+                      Image::ColorModel cm, Image::PixelType type, bool readOnly,
+                      int x, int y, int w, int h)
+{
+  // Clip region to image data
+  if (x < 0) { w += x; x = 0; }
+  if (y < 0) { h += y; y = 0; }
+  if (x + w > dataWidth) w = dataWidth - x;
+  if (y + h > dataHeight) h = dataHeight - y;
+  if (data == NULL || w <= 0 || h <= 0 || cm == Image::CM_None)
+    return;
+  int valueSize = Image::GetBytesPerValue(type);
+  data_ = data + y * stride + ((planeStride > 0) ? x : x * channels) * valueSize;
+  width_ = w;
+  height_ = h;
+  stride_ = stride;
+  planeStride_ = planeStride;
+  channels_ = channels;
+  colorModel_ = cm;
+  pixelType_ = type;
+  valueSize_ = valueSize;
+  readOnly_ = readOnly;
+}
+
+ImageView ImageView::GetSubView(int x, int y, int w, int h) const
+{
+  ImageView view;
+  view.Init_(data_, width_, height_, stride_, planeStride_, channels_,
+             colorModel_, pixelType_, readOnly_, x, y, w, h);
+  return view;
+}
+
+void ImageView::CopyTo(Image &image) const
+{
+  if (IsEmpty()) {
+    image.Release();
+    return;
+  }
+  image.Init(width_, height_, colorModel_, image.GetRowAlignment(),
+             IsPlanar() ? Image::PL_Planar : Image::PL_Interleaved, pixelType_);
+  if (image.IsEmpty())
+    return;
+  if (IsPlanar()) {
+    for (int c = 0; c < channels_; c++)
+      for (int y = 0; y < height_; y++)
+        memcpy(image.GetPlaneRow(c, y), GetPlaneRow(c, y), width_ * valueSize_);
+  } else {
+    int rowBytes = width_ * channels_ * valueSize_;
+    for (int y = 0; y < height_; y++)
+      memcpy(image.GetRow(y), GetRow(y), rowBytes);
+  }
+}
+
+bool ImageView::IsEmpty() const
+{
+  return data_ == NULL;
+}
+
+bool ImageView::IsReadOnly() const
+{
+  return readOnly_;
+}
+
+int ImageView::GetWidth() const
+{
+  return width_;
+}
+
+int ImageView::GetHeight() const
+{
+  return height_;
+}
+
+int ImageView::GetChannels() const
+{
+  return channels_;
+}
+
+int ImageView::GetStride() const
+{
+  return stride_;
+}
+
+bool ImageView::IsPlanar() const
+{
+  return planeStride_ > 0;
+}
+
+int ImageView::GetPlaneStride() const
+{
+  return planeStride_;
+}
+
+Image::PixelType ImageView::GetPixelType() const
+{
+  return pixelType_;
+}
+
+int ImageView::GetBytesPerValue() const
+{
+  return valueSize_;
+}
+
+Image::ColorModel ImageView::GetColorModel() const
+{
+  return colorModel_;
+}
+
+unsigned char *ImageView::GetData() const
+{
+  return data_;
+}
+
+void ImageView::Clear(unsigned char value) const
+{
+  if (readOnly_) return;
+  if (pixelType_ != Image::PT_UInt8) {
+    Clear(Color(value, value, value));
+  } else if (IsPlanar()) {
+    for (int c = 0; c < channels_; c++)
+      for (int y = 0; y < height_; y++)
+        memset(GetPlaneRow(c, y), value, width_);
+  } else {
+    int rowBytes = width_ * channels_;
+    for (int y = 0; y < height_; y++)
+      memset(GetRow(y), value, rowBytes);
+  }
+}
+
+void ImageView::Clear(const Color &color) const
+{
+  if (readOnly_) return;
+  if (colorModel_ == Image::CM_Gray && pixelType_ == Image::PT_UInt8) {
+    Clear(color.red);
+  } else if (pixelType_ != Image::PT_UInt8) {
+    // Fill first row of each plane (or first row) and copy it to all rows
+    int numPlanes = IsPlanar() ? channels_ : 1;
+    int numValues = IsPlanar() ? width_ : width_ * channels_;
+    const unsigned char values[3] = { color.red, color.green, color.blue };
+    for (int c = 0; c < numPlanes; c++) {
+      unsigned char *d = GetPlaneRow(c, 0);
+      for (int i = 0; i < numValues; i++)
+        Image::WriteUInt8(d + i * valueSize_, pixelType_,
+                          (numPlanes > 1) ? values[c] : values[i % channels_]);
+      for (int y = 1; y < height_; y++)
+        memcpy(GetPlaneRow(c, y), d, numValues * valueSize_);
+    }
+  } else if (IsPlanar()) {
+    for (int y = 0; y < height_; y++) {
+      memset(GetPlaneRow(0, y), color.red, width_);
+      memset(GetPlaneRow(1, y), color.green, width_);
+      memset(GetPlaneRow(2, y), color.blue, width_);
+    }
+  } else {
+    for (int y = 0; y < height_; y++) {
+      unsigned char *d = GetRow(y);
+      for (int x = 0; x < width_; x++, d += 3) {
+        d[0] = color.red;
+        d[1] = color.green;
+        d[2] = color.blue;
+      }
+    }
+  }
+}
+
+void ImageView::FillRow(int y, int x0, int x1, const Color &color) const
+{
+  if (readOnly_) return;
+  if (y < 0 || y >= height_) return;
+  if (x0 < 0) x0 = 0;
+  if (x1 >= width_) x1 = width_ - 1;
+  if (x0 > x1) return;
+  int n = x1 - x0 + 1;
+  if (pixelType_ == Image::PT_UInt8 && colorModel_ == Image::CM_Gray) {
+    memset(GetRow(y) + x0, color.red, n);
+  } else if (pixelType_ == Image::PT_UInt8 && IsPlanar()) {
+    memset(GetPlaneRow(0, y) + x0, color.red, n);
+    memset(GetPlaneRow(1, y) + x0, color.green, n);
+    memset(GetPlaneRow(2, y) + x0, color.blue, n);
+  } else {
+    // Write first pixel of each plane (or of the row) and double the
+    // filled part with memcpy until the span is complete
+    int numPlanes = IsPlanar() ? channels_ : 1;
+    int pixelBytes = IsPlanar() ? valueSize_ : channels_ * valueSize_;
+    int numBytes = n * pixelBytes;
+    const unsigned char values[3] = { color.red, color.green, color.blue };
+    for (int c = 0; c < numPlanes; c++) {
+      unsigned char *d = GetPlaneRow(c, y) + x0 * pixelBytes;
+      if (numPlanes > 1 || channels_ == 1)
+        Image::WriteUInt8(d, pixelType_, values[c]);
+      else
+        for (int i = 0; i < channels_; i++)
+          Image::WriteUInt8(d + i * valueSize_, pixelType_, values[i]);
+      for (int filled = pixelBytes; filled < numBytes; filled *= 2)
+        memcpy(d + filled, d, min(filled, numBytes - filled));
+    }
+  }
+}
+
+void ImageView::BlendRow(int y, int x0, int n, const unsigned char *alpha,
+                         const Color &color) const
+{
+  if (readOnly_) return;
+  if (y < 0 || y >= height_) return;
+  if (x0 < 0) { alpha -= x0; n += x0; x0 = 0; }
+  if (x0 + n > width_) n = width_ - x0;
+  if (n <= 0) return;
+  const unsigned char values[3] = { color.red, color.green, color.blue };
+  if (pixelType_ != Image::PT_UInt8) {
+    for (int i = 0; i < n; i++)
+      if (alpha[i] > 0)
+        BlendPixel(x0 + i, y, color, alpha[i]);
+    return;
+  }
+
+  // Blend each plane (or the gray row) with constant source values, or
+  // interleaved pixels with replicated opacities, in chunks
+  BlendFunction blend = GetBlendFunction();
+  unsigned char src[3 * BLEND_CHUNK], chunkAlpha[3 * BLEND_CHUNK];
+  if (colorModel_ == Image::CM_Gray || IsPlanar()) {
+    for (int c = 0; c < channels_; c++) {
+      memset(src, values[c], min(n, BLEND_CHUNK));
+      unsigned char *d = GetPlaneRow(c, y) + x0;
+      for (int i = 0; i < n; i += BLEND_CHUNK)
+        blend(d + i, src, alpha + i, min(BLEND_CHUNK, n - i));
+    }
+  } else {
+    for (int i = 0; i < 3 * min(n, BLEND_CHUNK); i++)
+      src[i] = values[i % 3];
+    unsigned char *d = GetRow(y) + 3 * x0;
+    for (int i = 0; i < n; i += BLEND_CHUNK) {
+      int count = min(BLEND_CHUNK, n - i);
+      for (int j = 0; j < count; j++)
+        chunkAlpha[3*j] = chunkAlpha[3*j+1] = chunkAlpha[3*j+2] = alpha[i + j];
+      blend(d + 3 * i, src, chunkAlpha, 3 * count);
+    }
+  }
+}
+
+void ImageView::BlendPixel(int x, int y, const Color &color, unsigned char alpha,
+                           bool check) const
+{
+  if (readOnly_) return;
+  if (check) {
+    if (x < 0 || x >= width_ || y < 0 || y >= height_) return;
+  }
+  const unsigned char values[3] = { color.red, color.green, color.blue };
+  unsigned char *d = &data_[GetOffset_(x, y, 0)];
+  int step = IsPlanar() ? planeStride_ : valueSize_;
+  if (pixelType_ == Image::PT_UInt8) {
+    for (int c = 0; c < channels_; c++)
+      BlendScalar(d + c * step, &values[c], &alpha, 1);
+  } else {
+    float a = alpha / 255.0f;
+    for (int c = 0; c < channels_; c++) {
+      float v = Image::ReadFloat(d + c * step, pixelType_);
+      Image::WriteFloat(d + c * step, pixelType_, v + (Image::UInt8ToFloat(values[c]) - v) * a);
+    }
+  }
+}
+
+unsigned char ImageView::GetPixel(int x, int y, int ch, bool check) const
+{
+  if (check) {
+    if (data_ == NULL) return 0;
+    if (x < 0) x = 0; else if (x >= width_) x = width_-1;
+    if (y < 0) y = 0; else if (y >= height_) y = height_-1;
+  }
+  if (pixelType_ == Image::PT_UInt8)
+    return data_[GetOffset_(x, y, ch)];
+  return Image::ReadUInt8(&data_[GetOffset_(x, y, ch)], pixelType_);
+}
+
+void ImageView::GetPixel(int x, int y, Color &color, bool check) const
+{
+  if (check) {
+    if (data_ == NULL) return;
+    if (x < 0) x = 0; else if (x >= width_) x = width_-1;
+    if (y < 0) y = 0; else if (y >= height_) y = height_-1;
+  }
+  unsigned char *d = &data_[GetOffset_(x, y, 0)];
+  if (colorModel_ == Image::CM_Gray) {
+    unsigned char v = Image::ReadUInt8(d, pixelType_);
+    color.Set(v, v, v);
+  } else if (pixelType_ != Image::PT_UInt8) {
+    int step = IsPlanar() ? planeStride_ : valueSize_;
+    color.Set(Image::ReadUInt8(d, pixelType_), Image::ReadUInt8(d + step, pixelType_),
+              Image::ReadUInt8(d + 2 * step, pixelType_));
+  } else if (IsPlanar())
+    color.Set(d[0], d[planeStride_], d[2 * planeStride_]);
+  else
+    color.Set(d[0], d[1], d[2]);
+}
+
+void ImageView::SetPixel(int x, int y, int ch, unsigned char value, bool check) const
+{
+  if (readOnly_) return;
+  if (check) {
+    if (x < 0 || x >= width_ || y < 0 || y >= height_) return;
+  }
+  if (pixelType_ == Image::PT_UInt8)
+    data_[GetOffset_(x, y, ch)] = value;
+  else
+    Image::WriteUInt8(&data_[GetOffset_(x, y, ch)], pixelType_, value);
+}
+
+void ImageView::SetPixel(int x, int y, const Color &color, bool check) const
+{
+  if (readOnly_) return;
+  if (check) {
+    if (x < 0 || x >= width_ || y < 0 || y >= height_) return;
+  }
+  unsigned char *d = &data_[GetOffset_(x, y, 0)];
+  if (colorModel_ == Image::CM_Gray)
+    Image::WriteUInt8(d, pixelType_, color.red); // set only 1-st channel for gray images
+  else if (pixelType_ != Image::PT_UInt8) {
+    int step = IsPlanar() ? planeStride_ : valueSize_;
+    Image::WriteUInt8(d, pixelType_, color.red);
+    Image::WriteUInt8(d + step, pixelType_, color.green);
+    Image::WriteUInt8(d + 2 * step, pixelType_, color.blue);
+  } else if (IsPlanar()) {
+    d[0] = color.red;
+    d[planeStride_] = color.green;
+    d[2 * planeStride_] = color.blue;
+  } else {
+    d[0] = color.red;
+    d[1] = color.green;
+    d[2] = color.blue;
+  }
+}
+
+float ImageView::GetValue(int x, int y, int ch, bool check) const
+{
+  if (check) {
+    if (data_ == NULL) return 0.0f;
+    if (x < 0) x = 0; else if (x >= width_) x = width_-1;
+    if (y < 0) y = 0; else if (y >= height_) y = height_-1;
+  }
+  return Image::ReadFloat(&data_[GetOffset_(x, y, ch)], pixelType_);
+}
+
+void ImageView::SetValue(int x, int y, int ch, float value, bool check) const
+{
+  if (readOnly_) return;
+  if (check) {
+    if (x < 0 || x >= width_ || y < 0 || y >= height_) return;
+  }
+  Image::WriteFloat(&data_[GetOffset_(x, y, ch)], pixelType_, value);
+}
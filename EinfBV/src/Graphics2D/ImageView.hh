@@ -0,0 +1,199 @@
+#ifndef __ImageView_hh__
+#define __ImageView_hh__
+
+#include "Color.hh"
+#include "Image.hh"
+
+/** @class ImageView
+    @brief Lightweight non-owning reference to a rectangular region of image
+           data, e.g. a crop or a tile of an Image. Creating and copying a
+           view never copies pixel data, so regions can be processed in place
+           by functions accepting views (see ColorConversion, ImageIO::Save()
+           and PrimitiveBase::Draw()).
+
+    A view stores a pointer to its first pixel, its size, the stride of the
+    underlying image data, the number of channels and the color model. Pixel
+    coordinates are relative to the top left corner of the view. Views of
+    planar images (see Image::PixelLayout) also store the plane stride, and
+    a single channel of a planar image can be viewed as a gray image.
+    Views keep the pixel type of the image (see Image::PixelType).
+    Views of const or read-only images are read-only and handled like
+    read-only images (see Image).
+
+    @attention The view does not keep the referenced image alive. It becomes
+               invalid when the image is released or re-initialized.
+ */
+class ImageView
+{
+public:
+
+  /** @brief Create an empty view. */
+  ImageView();
+
+  /** @brief Create a view of the whole image. */
+  ImageView(Image &image);
+
+  /** @brief Create a read-only view of the whole image. */
+  ImageView(const Image &image);
+
+  /** @brief Create a view of the region of the image with top left corner
+             (x, y) and size w x h. The region is clipped to the image. */
+  ImageView(Image &image, int x, int y, int w, int h);
+
+  /** @brief Create a read-only view of the region of the image with top left
+             corner (x, y) and size w x h. The region is clipped to the image. */
+  ImageView(const Image &image, int x, int y, int w, int h);
+
+  /** @brief Create a view of channel ch of the image as gray image. The
+             image must be a gray image or use planar layout. */
+  ImageView(Image &image, int ch);
+
+  /** @brief Create a read-only view of channel ch of the image as gray
+             image (see ImageView(Image&, int)). */
+  ImageView(const Image &image, int ch);
+
+  /** @brief Create a view of external image data with given size, stride
+             (bytes per row), color model and pixel type. */
+  ImageView(unsigned char *data, int w, int h, int stride,
+            Image::ColorModel cm, bool readOnly = false,
+            Image::PixelType type = Image::PT_UInt8);
+
+  /** @brief Returns a view of the region of this view with top left corner
+             (x, y) and size w x h. The region is clipped to this view. */
+  ImageView GetSubView(int x, int y, int w, int h) const;
+
+  /** @brief Copy viewed pixels into given image, e.g. to crop an image. */
+  void CopyTo(Image &image) const;
+
+  /** @brief Returns if the view is empty. */
+  bool IsEmpty() const;
+
+  /** @brief Returns if pixel data must not be modified via this view. */
+  bool IsReadOnly() const;
+
+  /** @brief Returns view width in pixels. */
+  int GetWidth() const;
+
+  /** @brief Returns view height in pixels. */
+  int GetHeight() const;
+
+  /** @brief Returns number of channels (see Image::GetChannels()). */
+  int GetChannels() const;
+
+  /** @brief Returns number of bytes between the starts of two rows. */
+  int GetStride() const;
+
+  /** @brief Returns if color channels are stored in separate planes. */
+  bool IsPlanar() const;
+
+  /** @brief Returns number of bytes between the starts of two planes, 0 for
+             interleaved layout. */
+  int GetPlaneStride() const;
+
+  /** @brief Returns pixel type of the viewed image. */
+  Image::PixelType GetPixelType() const;
+
+  /** @brief Returns number of bytes per value (see Image::GetBytesPerValue()). */
+  int GetBytesPerValue() const;
+
+  /** @brief Returns color model of the viewed image. */
+  Image::ColorModel GetColorModel() const;
+
+  /** @brief Returns pointer to first value of the view. */
+  unsigned char *GetData() const;
+
+  /** @brief Returns pointer to first value in row y of the view. */
+  unsigned char *GetRow(int y) const
+  {
+    return data_ + y * stride_;
+  }
+
+  /** @brief Returns pointer to the value of channel ch of the first pixel in
+             row y of the view (see Image::GetPlaneRow()). */
+  unsigned char *GetPlaneRow(int ch, int y) const
+  {
+    return data_ + y * stride_ + (planeStride_ > 0 ? ch * planeStride_ : ch * valueSize_);
+  }
+
+  /** @brief Set all viewed values to the given 8-bit value (converted to
+             the pixel type). Does nothing for read-only views, like all
+             methods writing pixels. */
+  void Clear(unsigned char value = 0) const;
+
+  /** @brief Set all viewed pixels to the given color (see Image::Clear()). */
+  void Clear(const Color &color) const;
+
+  /** @brief Set pixels x0 to x1 (inclusive) in row y to the given color.
+             The span is clipped to the view and written with memset-style
+             row fills, so this is the fast path for filling primitives.
+             Does nothing for read-only views. */
+  void FillRow(int y, int x0, int x1, const Color &color) const;
+
+  /** @brief Blend color into n pixels of row y starting at x0, where
+             alpha[i] in [0, 255] is the opacity for pixel x0 + i. The span
+             is clipped to the view. 8-bit values are blended with SIMD
+             instructions if supported (see CpuFeatures) and compute
+             (color * alpha + value * (255 - alpha) + 127) / 255.
+             Does nothing for read-only views. */
+  void BlendRow(int y, int x0, int n, const unsigned char *alpha,
+                const Color &color) const;
+
+  /** @brief Blend color into pixel (x, y) with opacity alpha in [0, 255]
+             (see BlendRow()). If check is set, the coordinates are checked
+             for validity. */
+  void BlendPixel(int x, int y, const Color &color, unsigned char alpha,
+                  bool check = false) const;
+
+  /** @brief Get image value from channel ch at pixel (x, y) converted to
+             8 bits. If check is set, the coordinates are checked for
+             validity. */
+  unsigned char GetPixel(int x, int y, int ch, bool check = false) const;
+
+  /** @brief Get image values from all channels at pixel (x, y).
+             If check is set, the coordinates are checked for validity. */
+  void GetPixel(int x, int y, Color &color, bool check = false) const;
+
+  /** @brief Set image value in channel ch at pixel (x, y) from an 8-bit
+             value. If check is set, the coordinates are checked for
+             validity. */
+  void SetPixel(int x, int y, int ch, unsigned char value, bool check = false) const;
+
+  /** @brief Set image values in all channels at pixel (x, y).
+             If check is set, the coordinates are checked for validity. */
+  void SetPixel(int x, int y, const Color &color, bool check = false) const;
+
+  /** @brief Get image value from channel ch at pixel (x, y) in range [0, 1]
+             (see Image::GetValue()). */
+  float GetValue(int x, int y, int ch, bool check = false) const;
+
+  /** @brief Set image value in channel ch at pixel (x, y) from a value in
+             range [0, 1] (see Image::SetValue()). */
+  void SetValue(int x, int y, int ch, float value, bool check = false) const;
+
+private:
+
+  /** @brief Initialize view of clipped region of given image data. */
+  void Init_(unsigned char *data, int dataWidth, int dataHeight, int stride,
+             int planeStride, int channels, Image::ColorModel cm,
+             Image::PixelType type, bool readOnly, int x, int y, int w, int h);
+
+  /** @brief Initialize view of channel ch of given image. */
+  void InitPlane_(const Image &image, int ch, bool readOnly);
+
+  /** @brief Returns offset of channel ch at pixel (x, y) in view data. */
+  int GetOffset_(int x, int y, int ch) const
+  {
+    return (planeStride_ > 0) ? y * stride_ + x * valueSize_ + ch * planeStride_
+                              : y * stride_ + (x * channels_ + ch) * valueSize_;
+  }
+
+  unsigned char *data_;
+  int width_, height_, stride_, planeStride_, channels_;
+  Image::ColorModel colorModel_;
+  Image::PixelType pixelType_;
+  int valueSize_;
+  bool readOnly_;
+
+};
+
+#endif // __ImageView_hh__
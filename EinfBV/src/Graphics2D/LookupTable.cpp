@@ -0,0 +1,171 @@
+#include "LookupTable.hh"
+#include <iostream>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+/** Map width values with given steps in bytes using a single table. */
+void ApplyTable(const unsigned char *s, int srcStep, unsigned char *d, int dstStep,
+                const unsigned char *table, int width)
+{
+  int x = 0;
+  if (srcStep == 1 && dstStep == 1) {
+    for (; x + 4 <= width; x += 4) {
+      d[x] = table[s[x]];
+      d[x + 1] = table[s[x + 1]];
+      d[x + 2] = table[s[x + 2]];
+      d[x + 3] = table[s[x + 3]];
+    }
+  }
+  for (; x < width; x++)
+    d[x * dstStep] = table[s[x * srcStep]];
+}
+
+} // namespace
+
+LookupTable::LookupTable()
+{
+  SetIdentity();
+}
+
+void LookupTable::SetIdentity(int channel)
+{
+  unsigned char table[256];
+  for (int i = 0; i < 256; i++)
+    table[i] = (unsigned char)i;
+  SetTable(table, channel);
+}
+
+void LookupTable::SetTable(const unsigned char *table, int channel)
+{
+  if (!CheckChannel_(channel, "SetTable"))
+    return;
+  int first, last;
+  GetChannelRange_(channel, first, last);
+  for (int c = first; c <= last; c++)
+    memcpy(tables_[c], table, 256);
+}
+
+const unsigned char *LookupTable::GetTable(int channel) const
+{
+  if (channel < 0 || channel >= NUM_CHANNELS) {
+    cerr << "LookupTable::GetTable() : Invalid channel!" << endl;
+    return NULL;
+  }
+  return tables_[channel];
+}
+
+void LookupTable::SetGamma(double gamma, int channel)
+{
+  if (gamma <= 0.0) {
+    cerr << "LookupTable::SetGamma() : Invalid gamma!" << endl;
+    return;
+  }
+  unsigned char table[256];
+  for (int i = 0; i < 256; i++)
+    table[i] = (unsigned char)floor(255.0 * pow(i / 255.0, 1.0 / gamma) + 0.5);
+  SetTable(table, channel);
+}
+
+void LookupTable::SetContrastStretch(int low, int high, int channel)
+{
+  if (low < 0 || high > 255 || low >= high) {
+    cerr << "LookupTable::SetContrastStretch() : Invalid range!" << endl;
+    return;
+  }
+  double scale = 255.0 / (high - low);
+  SetLinear(scale, -low * scale, channel);
+}
+
+void LookupTable::SetLinear(double scale, double offset, int channel)
+{
+  unsigned char table[256];
+  for (int i = 0; i < 256; i++) {
+    double value = floor(scale * i + offset + 0.5);
+    table[i] = (unsigned char)(value < 0.0 ? 0.0 : (value > 255.0 ? 255.0 : value));
+  }
+  SetTable(table, channel);
+}
+
+void LookupTable::Append(const LookupTable &next)
+{
+  for (int c = 0; c < NUM_CHANNELS; c++)
+    for (int i = 0; i < 256; i++)
+      tables_[c][i] = next.tables_[c][tables_[c][i]];
+}
+
+bool LookupTable::Apply(const Image &src, Image &dst) const
+{
+  if (src.IsEmpty()) {
+    cerr << "LookupTable::Apply() : Source image is empty!" << endl;
+    return false;
+  }
+  if (&src != &dst) {
+    dst.Init(src.GetWidth(), src.GetHeight(), src.GetColorModel(),
+             dst.GetRowAlignment(), src.GetLayout());
+    if (dst.IsEmpty())
+      return false;
+  }
+  return Apply(ImageView(src), ImageView(dst));
+}
+
+bool LookupTable::Apply(const ImageView &src, const ImageView &dst) const
+{
+  if (src.IsEmpty() || src.GetWidth() != dst.GetWidth() ||
+      src.GetHeight() != dst.GetHeight() || src.GetChannels() != dst.GetChannels()) {
+    cerr << "LookupTable::Apply() : Invalid image size!" << endl;
+    return false;
+  }
+  if (src.GetPixelType() != Image::PT_UInt8 || dst.GetPixelType() != Image::PT_UInt8) {
+    cerr << "LookupTable::Apply() : Only 8-bit images are supported!" << endl;
+    return false;
+  }
+  if (dst.IsReadOnly()) {
+    cerr << "LookupTable::Apply() : Target image is read-only!" << endl;
+    return false;
+  }
+  int width = src.GetWidth();
+  if (src.IsPlanar() || dst.IsPlanar()) {
+    // Apply table of each channel to its plane (or interleaved values)
+    int srcStep = src.IsPlanar() ? 1 : src.GetChannels();
+    int dstStep = dst.IsPlanar() ? 1 : dst.GetChannels();
+    for (int c = 0; c < src.GetChannels(); c++)
+      for (int y = 0; y < src.GetHeight(); y++)
+        ApplyTable(src.GetPlaneRow(c, y), srcStep, dst.GetPlaneRow(c, y), dstStep,
+                   tables_[c], width);
+    return true;
+  }
+  for (int y = 0; y < src.GetHeight(); y++) {
+    const unsigned char *s = src.GetRow(y);
+    unsigned char *d = dst.GetRow(y);
+    if (src.GetChannels() == 1) {
+      ApplyTable(s, 1, d, 1, tables_[0], width);
+    } else {
+      const unsigned char *t0 = tables_[0], *t1 = tables_[1], *t2 = tables_[2];
+      for (int x = 0; x < width; x++, s += 3, d += 3) {
+        d[0] = t0[s[0]];
+        d[1] = t1[s[1]];
+        d[2] = t2[s[2]];
+      }
+    }
+  }
+  return true;
+}
+
+bool LookupTable::CheckChannel_(int channel, const char *method)
+{
+  if (channel < -1 || channel >= NUM_CHANNELS) {
+    cerr << "LookupTable::" << method << "() : Invalid channel!" << endl;
+    return false;
+  }
+  return true;
+}
+
+void LookupTable::GetChannelRange_(int channel, int &first, int &last)
+{
+  first = (channel < 0) ? 0 : channel;
+  last = (channel < 0) ? NUM_CHANNELS - 1 : channel;
+}
@@ -0,0 +1,75 @@
+#ifndef __LookupTable_hh__
+#define __LookupTable_hh__
+
+#include "Image.hh"
+#include "ImageView.hh"
+
+/** @class LookupTable
+    @brief Per-channel lookup tables with 256 entries, mapping each 8-bit
+           channel value of an image to a new value in a single pass.
+
+    Tables are initialized to identity and set with the Set methods for a
+    single channel or all channels (channel -1). Gray images use the table
+    of channel 0, RGB and HSV images the tables of channel 0 to 2, e.g. use
+    channel 2 to adjust the value of HSV images. Several tables are combined
+    into one with Append(). Planar images (see Image::PixelLayout) are
+    processed plane by plane, which is the fastest layout for lookups.
+ */
+class LookupTable
+{
+public:
+
+  /** @brief Maximum number of channels */
+  static const int NUM_CHANNELS = 3;
+
+  /** @brief Create identity lookup table. */
+  LookupTable();
+
+  /** @brief Set table of given channel or of all channels to identity. */
+  void SetIdentity(int channel = -1);
+
+  /** @brief Copy 256 entries into table of given channel or all channels. */
+  void SetTable(const unsigned char *table, int channel = -1);
+
+  /** @brief Returns the 256 entries of the table of given channel. */
+  const unsigned char *GetTable(int channel) const;
+
+  /** @brief Set gamma correction out = 255 (in / 255)^(1 / gamma). */
+  void SetGamma(double gamma, int channel = -1);
+
+  /** @brief Set contrast stretch mapping [low, high] linearly to [0, 255],
+             values outside are clamped. */
+  void SetContrastStretch(int low, int high, int channel = -1);
+
+  /** @brief Set linear mapping out = scale in + offset, clamped to
+             [0, 255], e.g. to scale the value of HSV images. */
+  void SetLinear(double scale, double offset, int channel = -1);
+
+  /** @brief Combine with table that is applied after this table. */
+  void Append(const LookupTable &next);
+
+  /** @brief Apply tables to source image and store result in target image
+             (which may be the source image itself) with the same layout.
+      @return Returns false if the source image is empty. */
+  bool Apply(const Image &src, Image &dst) const;
+
+  /** @brief Apply tables to source view and store result in target view
+             of the same size and color model (which may be the same view).
+             The views may use different layouts, but must be 8-bit views.
+      @return Returns false if the views do not match. */
+  bool Apply(const ImageView &src, const ImageView &dst) const;
+
+private:
+
+  /** @brief Returns false and prints error if channel is invalid. */
+  static bool CheckChannel_(int channel, const char *method);
+
+  /** @brief Get range of channels addressed by channel (-1 for all). */
+  static void GetChannelRange_(int channel, int &first, int &last);
+
+  /** @brief Lookup tables per channel */
+  unsigned char tables_[NUM_CHANNELS][256];
+
+};
+
+#endif // __LookupTable_hh__
@@ -0,0 +1,208 @@
+#include "PPMReader.hh"
+#include "ImageIO.hh"
+#include "ColorConversion.hh"
+#include <iostream>
+
+using namespace std;
+
+PPMReader::PPMReader()
+  : width_(0), height_(0), maxVal_(0), nextRow_(0),
+    colorModel_(Image::CM_None), pixelType_(Image::PT_UInt8),
+    rowBytes_(0), dataOffset_(0)
+{
+}
+
+PPMReader::~PPMReader()
+{
+  Close();
+}
+
+bool PPMReader::Open(const string &filename)
+{
+  Close();
+  // Open file for input (support binary input)
+  file_.open(filename.c_str(), ios::in | ios::binary);
+  if (!file_.good()) {
+    cerr << "PPMReader::Open() : Failed to read from file!" << endl;
+    Close();
+    return false;
+  }
+  // Read header, which also recognizes the color model comments, and check
+  // if the file contains all image data
+  ImageIO::PPMHeader header;
+  ImageIO::PPMError error = ImageIO::ReadPPMHeader(file_, header);
+  if (error != ImageIO::PPM_OK) {
+    cerr << "PPMReader::Open() : " << ImageIO::GetPPMErrorString(error) << "!" << endl;
+    Close();
+    return false;
+  }
+  if (!header.isBinary) {
+    cerr << "PPMReader::Open() : Only binary files (P5/P6) are supported!" << endl;
+    Close();
+    return false;
+  }
+  width_ = header.width;
+  height_ = header.height;
+  maxVal_ = header.maxVal;
+  colorModel_ = header.colorModel;
+  pixelType_ = header.pixelType;
+  rowBytes_ = (int)header.rowBytes;
+  dataOffset_ = (streamoff)header.dataOffset;
+  nextRow_ = 0;
+  return true;
+}
+
+void PPMReader::Close()
+{
+  if (file_.is_open())
+    file_.close();
+  file_.clear();
+  width_ = height_ = maxVal_ = nextRow_ = rowBytes_ = 0;
+  colorModel_ = Image::CM_None;
+  pixelType_ = Image::PT_UInt8;
+  dataOffset_ = 0;
+}
+
+bool PPMReader::IsOpen() const
+{
+  return file_.is_open();
+}
+
+int PPMReader::GetWidth() const
+{
+  return width_;
+}
+
+int PPMReader::GetHeight() const
+{
+  return height_;
+}
+
+Image::ColorModel PPMReader::GetColorModel() const
+{
+  return colorModel_;
+}
+
+Image::PixelType PPMReader::GetPixelType() const
+{
+  return pixelType_;
+}
+
+int PPMReader::GetMaxValue() const
+{
+  return maxVal_;
+}
+
+int PPMReader::GetNextRow() const
+{
+  return nextRow_;
+}
+
+bool PPMReader::SeekRow(int y)
+{
+  if (!IsOpen() || y < 0 || y > height_) {
+    cerr << "PPMReader::SeekRow() : Invalid row!" << endl;
+    return false;
+  }
+  file_.clear();
+  file_.seekg(dataOffset_ + (streamoff)y * rowBytes_, ios::beg);
+  if (!file_.good()) {
+    cerr << "PPMReader::SeekRow() : Failed to read from file!" << endl;
+    return false;
+  }
+  nextRow_ = y;
+  return true;
+}
+
+int PPMReader::ReadRows(Image &band, int numRows, int rowAlignment,
+                        Image::PixelLayout layout)
+{
+  if (!IsOpen() || numRows <= 0)
+    return 0;
+  if (numRows > height_ - nextRow_)
+    numRows = height_ - nextRow_;
+  if (numRows == 0)
+    return 0;
+  band.Init(width_, numRows, colorModel_, rowAlignment, layout, pixelType_);
+  if (band.IsEmpty())
+    return 0;
+  return ReadRows(ImageView(band));
+}
+
+int PPMReader::ReadRows(const ImageView &band)
+{
+  if (!IsOpen())
+    return 0;
+  if (band.GetWidth() != width_ || band.GetChannels() != (colorModel_ == Image::CM_Gray ? 1 : 3)) {
+    cerr << "PPMReader::ReadRows() : Band does not match image size or color model!" << endl;
+    return 0;
+  }
+  if (band.IsReadOnly()) {
+    cerr << "PPMReader::ReadRows() : Band is read-only!" << endl;
+    return 0;
+  }
+  int numRows = band.GetHeight();
+  if (numRows > height_ - nextRow_)
+    numRows = height_ - nextRow_;
+  if (numRows <= 0)
+    return 0;
+  // Read rows directly into interleaved bands of the file's pixel type,
+  // other bands are read row by row and converted
+  if (!band.IsPlanar() && band.GetPixelType() == pixelType_) {
+    if (!ReadData_(band.GetData(), band.GetStride(), numRows))
+      return 0;
+  } else {
+    rowBuffer_.resize(rowBytes_);
+    ImageView row(&rowBuffer_[0], width_, 1, rowBytes_, band.GetColorModel(),
+                  false, pixelType_);
+    // Planar bands of another pixel type are converted to the pixel type
+    // in interleaved layout first
+    ImageView converted;
+    bool convertBoth = band.IsPlanar() && band.GetChannels() == 3 &&
+                       band.GetPixelType() != pixelType_;
+    if (convertBoth) {
+      int convertedBytes = width_ * band.GetChannels() * band.GetBytesPerValue();
+      convertBuffer_.resize(convertedBytes);
+      converted = ImageView(&convertBuffer_[0], width_, 1, convertedBytes,
+                            band.GetColorModel(), false, band.GetPixelType());
+    }
+    for (int y = 0; y < numRows; y++) {
+      if (!ReadData_(&rowBuffer_[0], rowBytes_, 1))
+        return 0;
+      ImageView dst = band.GetSubView(0, y, width_, 1);
+      if (convertBoth) {
+        ColorConversion::ConvertDepth(row, converted);
+        ColorConversion::ConvertLayout(converted, dst);
+      } else if (band.GetPixelType() != pixelType_) {
+        ColorConversion::ConvertDepth(row, dst);
+      } else {
+        ColorConversion::ConvertLayout(row, dst);
+      }
+    }
+  }
+  return numRows;
+}
+
+bool PPMReader::ReadData_(unsigned char *data, int stride, int numRows)
+{
+  // Read contiguous rows at once
+  if (stride == rowBytes_) {
+    file_.read((char*)data, (streamsize)rowBytes_ * numRows);
+  } else {
+    for (int y = 0; y < numRows && file_.good(); y++)
+      file_.read((char*)data + (size_t)y * stride, rowBytes_);
+  }
+  if (!file_.good()) {
+    cerr << "PPMReader::ReadRows() : File does not contain all image data!" << endl;
+    nextRow_ = height_;
+    return false;
+  }
+  nextRow_ += numRows;
+  // Convert values to the full range of the pixel type
+  if (maxVal_ != 255) {
+    int rowValues = width_ * (colorModel_ == Image::CM_Gray ? 1 : 3);
+    for (int y = 0; y < numRows; y++)
+      ImageIO::DecodePPMRow(data + (size_t)y * stride, rowValues, maxVal_);
+  }
+  return true;
+}
@@ -0,0 +1,114 @@
+#ifndef __PPMReader_hh__
+#define __PPMReader_hh__
+
+#include "Image.hh"
+#include "ImageView.hh"
+#include <fstream>
+#include <string>
+#include <vector>
+
+/** @class PPMReader
+    @brief Reads binary Portable PixMap or Portable GrayMap files (P5/P6) in
+           bands of rows, e.g. to convert or filter images which do not fit
+           into memory with a bounded memory footprint.
+
+    The header is parsed by ImageIO::ParsePPMHeader(), so the color model
+    comments written by ImageIO::SavePPM() (e.g. "# CM_HSV") are recognized.
+    Rows are read from top to bottom, SeekRow() moves to an arbitrary row.
+    Files with a max. value above 255 are read as 16-bit values, all values
+    are scaled to the full range of the pixel type as by ImageIO::LoadPPM().
+    Bands are written back with PPMWriter.
+
+    @code
+    PPMReader reader;
+    Image band;
+    if (reader.Open("input.ppm"))
+      while (reader.ReadRows(band, 64) > 0)
+        ; // process band of up to 64 rows
+    @endcode
+ */
+class PPMReader
+{
+public:
+
+  /** @brief Create reader without open file. */
+  PPMReader();
+
+  /** @brief Destructor closes the file. */
+  ~PPMReader();
+
+  /** @brief Open binary PPM file and read its header. Any previously opened
+             file is closed first.
+      @return Returns true in case of success. */
+  bool Open(const std::string &filename);
+
+  /** @brief Close the file. */
+  void Close();
+
+  /** @brief Returns if a file is open. */
+  bool IsOpen() const;
+
+  /** @brief Returns image width in pixels. */
+  int GetWidth() const;
+
+  /** @brief Returns image height in pixels. */
+  int GetHeight() const;
+
+  /** @brief Returns color model given by the file header. */
+  Image::ColorModel GetColorModel() const;
+
+  /** @brief Returns pixel type of the values read, i.e. PT_UInt16 for files
+             with a max. value above 255 and PT_UInt8 otherwise. */
+  Image::PixelType GetPixelType() const;
+
+  /** @brief Returns max. value given by the file header. */
+  int GetMaxValue() const;
+
+  /** @brief Returns index of the next row to be read. */
+  int GetNextRow() const;
+
+  /** @brief Move to row y, i.e. the next band starts at row y.
+      @return Returns true in case of success. */
+  bool SeekRow(int y);
+
+  /** @brief Read the next numRows rows (fewer at the end of the file) into
+             the band, which is initialized with the width, color model and
+             pixel type of the file and given row alignment and layout.
+             Memory of the band is reused if it is large enough.
+      @return Returns the number of rows read, 0 at the end of the file or
+              in case of failure. */
+  int ReadRows(Image &band, int numRows, int rowAlignment = 1,
+               Image::PixelLayout layout = Image::PL_Interleaved);
+
+  /** @brief Read the next rows into the view (fewer at the end of the file),
+             which must have the width and number of channels of the file.
+             Values are converted to the layout and pixel type of the view.
+      @return Returns the number of rows read, 0 at the end of the file or
+              in case of failure. */
+  int ReadRows(const ImageView &band);
+
+private:
+
+  /** @brief Read given number of rows of file values into memory with
+             given stride and convert them to the full range.
+      @return Returns true in case of success. */
+  bool ReadData_(unsigned char *data, int stride, int numRows);
+
+  std::ifstream file_;
+  int width_, height_, maxVal_, nextRow_;
+  Image::ColorModel colorModel_;
+  Image::PixelType pixelType_;
+  /** @brief Number of bytes of one row in the file */
+  int rowBytes_;
+  /** @brief Offset of first data byte in the file */
+  std::streamoff dataOffset_;
+  /** @brief Buffers for rows which are converted after reading */
+  std::vector<unsigned char> rowBuffer_, convertBuffer_;
+
+  /** @brief Reader cannot be copied. */
+  PPMReader(const PPMReader&);
+  PPMReader &operator=(const PPMReader&);
+
+};
+
+#endif // __PPMReader_hh__
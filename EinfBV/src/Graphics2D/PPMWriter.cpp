@@ -0,0 +1,146 @@
+#include "PPMWriter.hh"
+#include "ImageIO.hh"
+#include "ColorConversion.hh"
+#include <iostream>
+
+using namespace std;
+
+PPMWriter::PPMWriter()
+  : width_(0), height_(0), channels_(0), nextRow_(0),
+    colorModel_(Image::CM_None), pixelType_(Image::PT_UInt8)
+{
+}
+
+PPMWriter::~PPMWriter()
+{
+  Close();
+}
+
+bool PPMWriter::Open(const string &filename, int w, int h, Image::ColorModel cm,
+                     Image::PixelType type)
+{
+  Close();
+  if (w <= 0 || h <= 0 || cm == Image::CM_None) {
+    cerr << "PPMWriter::Open() : Invalid image size or color model!" << endl;
+    return false;
+  }
+  // Open file for output (support binary output)
+  file_.open(filename.c_str(), ios::out | ios::binary);
+  if (!file_.good()) {
+    cerr << "PPMWriter::Open() : Failed to write to file!" << endl;
+    file_.close();
+    file_.clear();
+    return false;
+  }
+  width_ = w;
+  height_ = h;
+  channels_ = (cm == Image::CM_Gray) ? 1 : 3;
+  nextRow_ = 0;
+  colorModel_ = cm;
+  pixelType_ = (type == Image::PT_UInt8) ? Image::PT_UInt8 : Image::PT_UInt16;
+  file_ << ImageIO::FormatPPMHeader(w, h, cm, (pixelType_ == Image::PT_UInt8) ? 255 : 65535);
+  return file_.good();
+}
+
+bool PPMWriter::WriteRows(const ImageView &band)
+{
+  if (!IsOpen())
+    return false;
+  if (band.GetWidth() != width_ || band.GetChannels() != channels_) {
+    cerr << "PPMWriter::WriteRows() : Band does not match image size or color model!" << endl;
+    return false;
+  }
+  int numRows = band.GetHeight();
+  if (numRows > height_ - nextRow_) {
+    cerr << "PPMWriter::WriteRows() : Band exceeds image height!" << endl;
+    return false;
+  }
+  int rowValues = width_ * channels_;
+  int rowBytes = rowValues * Image::GetBytesPerValue(pixelType_);
+  if (pixelType_ == Image::PT_UInt8 && band.GetPixelType() == Image::PT_UInt8 &&
+      (!band.IsPlanar() || channels_ == 1)) {
+    // Write interleaved 8-bit rows directly, contiguous rows at once
+    if (band.GetStride() == rowBytes) {
+      file_.write((const char*)band.GetData(), (streamsize)rowBytes * numRows);
+    } else {
+      for (int y = 0; y < numRows; y++)
+        file_.write((const char*)band.GetRow(y), rowBytes);
+    }
+  } else {
+    // Convert rows to interleaved values of the file's pixel type first,
+    // planar rows of another pixel type are interleaved before converting
+    rowBuffer_.resize(rowBytes);
+    ImageView row(&rowBuffer_[0], width_, 1, rowBytes, band.GetColorModel(),
+                  false, pixelType_);
+    ImageView interleaved;
+    bool convertBoth = band.IsPlanar() && channels_ == 3 &&
+                       band.GetPixelType() != pixelType_;
+    if (convertBoth) {
+      int interleavedBytes = rowValues * band.GetBytesPerValue();
+      convertBuffer_.resize(interleavedBytes);
+      interleaved = ImageView(&convertBuffer_[0], width_, 1, interleavedBytes,
+                              band.GetColorModel(), false, band.GetPixelType());
+    }
+    if (pixelType_ == Image::PT_UInt16)
+      outBuffer_.resize(rowBytes);
+    for (int y = 0; y < numRows; y++) {
+      ImageView src = band.GetSubView(0, y, width_, 1);
+      if (convertBoth) {
+        ColorConversion::ConvertLayout(src, interleaved);
+        ColorConversion::ConvertDepth(interleaved, row);
+      } else if (band.GetPixelType() != pixelType_) {
+        ColorConversion::ConvertDepth(src, row);
+      } else {
+        ColorConversion::ConvertLayout(src, row);
+      }
+      if (pixelType_ == Image::PT_UInt16) {
+        // Write 16-bit values most significant byte first
+        const unsigned short *row16 = (const unsigned short*)&rowBuffer_[0];
+        for (int i = 0; i < rowValues; i++) {
+          outBuffer_[2*i] = (unsigned char)(row16[i] >> 8);
+          outBuffer_[2*i+1] = (unsigned char)row16[i];
+        }
+        file_.write((const char*)&outBuffer_[0], rowBytes);
+      } else {
+        file_.write((const char*)&rowBuffer_[0], rowBytes);
+      }
+    }
+  }
+  if (!file_.good()) {
+    cerr << "PPMWriter::WriteRows() : Failed to write to file!" << endl;
+    return false;
+  }
+  nextRow_ += numRows;
+  return true;
+}
+
+bool PPMWriter::Close()
+{
+  if (!IsOpen())
+    return true;
+  bool success = true;
+  if (nextRow_ < height_) {
+    cerr << "PPMWriter::Close() : Not all rows have been written!" << endl;
+    success = false;
+  }
+  file_.close();
+  if (!file_.good()) {
+    cerr << "PPMWriter::Close() : Failed to write to file!" << endl;
+    success = false;
+  }
+  file_.clear();
+  width_ = height_ = channels_ = nextRow_ = 0;
+  colorModel_ = Image::CM_None;
+  pixelType_ = Image::PT_UInt8;
+  return success;
+}
+
+bool PPMWriter::IsOpen() const
+{
+  return file_.is_open();
+}
+
+int PPMWriter::GetNextRow() const
+{
+  return nextRow_;
+}
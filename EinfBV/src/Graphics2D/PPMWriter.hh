@@ -0,0 +1,70 @@
+#ifndef __PPMWriter_hh__
+#define __PPMWriter_hh__
+
+#include "Image.hh"
+#include "ImageView.hh"
+#include <fstream>
+#include <string>
+#include <vector>
+
+/** @class PPMWriter
+    @brief Writes binary Portable PixMap or Portable GrayMap files (P5/P6) in
+           bands of rows, the counterpart of PPMReader.
+
+    The header is written by ImageIO::FormatPPMHeader() when the file is
+    opened, including the color model comment, so files are identical to
+    files written by ImageIO::SavePPM(). Bands are appended from top to
+    bottom and may use any layout and pixel type, values are converted to
+    the pixel type given to Open(). 16-bit and float images are written
+    with 16-bit values (max. value 65535).
+ */
+class PPMWriter
+{
+public:
+
+  /** @brief Create writer without open file. */
+  PPMWriter();
+
+  /** @brief Destructor closes the file (see Close()). */
+  ~PPMWriter();
+
+  /** @brief Create binary PPM file for an image of size w x h with given
+             color model and pixel type and write its header. Any previously
+             opened file is closed first.
+      @return Returns true in case of success. */
+  bool Open(const std::string &filename, int w, int h, Image::ColorModel cm,
+            Image::PixelType type = Image::PT_UInt8);
+
+  /** @brief Append the rows of the band, which must have the width and
+             number of channels given to Open().
+      @return Returns true in case of success. */
+  bool WriteRows(const ImageView &band);
+
+  /** @brief Close the file.
+      @return Returns false if not all rows have been written or if writing
+              failed. */
+  bool Close();
+
+  /** @brief Returns if a file is open. */
+  bool IsOpen() const;
+
+  /** @brief Returns index of the next row to be written. */
+  int GetNextRow() const;
+
+private:
+
+  std::ofstream file_;
+  int width_, height_, channels_, nextRow_;
+  Image::ColorModel colorModel_;
+  /** @brief Pixel type of written values, i.e. PT_UInt8 or PT_UInt16 */
+  Image::PixelType pixelType_;
+  /** @brief Buffers for rows which are converted before writing */
+  std::vector<unsigned char> rowBuffer_, convertBuffer_, outBuffer_;
+
+  /** @brief Writer cannot be copied. */
+  PPMWriter(const PPMWriter&);
+  PPMWriter &operator=(const PPMWriter&);
+
+};
+
+#endif // __PPMWriter_hh__
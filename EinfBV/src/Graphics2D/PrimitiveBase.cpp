@@ -4,7 +4,7 @@
 using namespace std;
 
 PrimitiveBase::PrimitiveBase(const Color &color, int numPoints)
-  : color_(color), points_(numPoints)
+  : color_(color), renderMode_(RM_Aliased), points_(numPoints)
 {
 }
 
@@ -22,6 +22,16 @@ void PrimitiveBase::SetColor(const Color &color)
   color_ = color;
 }
 
+PrimitiveBase::RenderMode PrimitiveBase::GetRenderMode() const
+{
+  return renderMode_;
+}
+
+void PrimitiveBase::SetRenderMode(RenderMode renderMode)
+{
+  renderMode_ = renderMode;
+}
+
 Float2D PrimitiveBase::GetPoint(int n) const
 {
   if (n >= 0 && n < (int)points_.size()) {
@@ -46,6 +56,11 @@ int PrimitiveBase::GetNumPoints() const
   return points_.size();
 }
 
+void PrimitiveBase::Draw(Image &image) const
+{
+  Draw(ImageView(image));
+}
+
 void PrimitiveBase::ApplyTransform(const AffineTransform &T)
 {
   for (int n = 0; n < (int)points_.size(); n++) {
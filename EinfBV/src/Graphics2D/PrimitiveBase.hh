@@ -3,6 +3,7 @@
 
 #include "Color.hh"
 #include "Image.hh"
+#include "ImageView.hh"
 #include "Vectors.hh"
 #include "AffineTransform.hh"
 #include <vector>
@@ -15,6 +16,12 @@ class PrimitiveBase
 {
 public:
 
+  /** @brief Define how primitives are rasterized. RM_Aliased sets every
+             covered pixel to the color of the primitive, RM_AntiAliased
+             blends the color into the existing image content weighted by
+             the coverage of each pixel, which is slower. */
+  enum RenderMode { RM_Aliased, RM_AntiAliased };
+
   /** @brief Destructor. Release dynamically allocated memory. */
   virtual ~PrimitiveBase();
 
@@ -33,11 +40,23 @@ public:
   /** @brief Set the color of this primitive. */
   void SetColor(const Color &color);
 
+  /** @brief Return how this primitive is rasterized. */
+  RenderMode GetRenderMode() const;
+
+  /** @brief Set how this primitive is rasterized. Primitives without an
+             anti-aliased implementation ignore the mode. */
+  void SetRenderMode(RenderMode renderMode);
+
   /** @brief Apply affine transformation to this primitive. */
   void ApplyTransform(const AffineTransform &T);
 
-  /** @brief Draw primitive into given image. Implement this in derived classes. */
-  virtual void Draw(Image &image) const = 0;
+  /** @brief Draw primitive into given image. */
+  void Draw(Image &image) const;
+
+  /** @brief Draw primitive into image region referenced by the view, using
+             coordinates relative to the top left corner of the view.
+             Implement this in derived classes. */
+  virtual void Draw(const ImageView &view) const = 0;
 
 protected:
 
@@ -47,6 +66,9 @@ protected:
   /** @brief Stores color for this primitive. */
   Color color_;
 
+  /** @brief Stores render mode for this primitive. */
+  RenderMode renderMode_;
+
 private:
 
   /** @brief Stores 2d points for this primitive. */
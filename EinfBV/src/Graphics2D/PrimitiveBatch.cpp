@@ -0,0 +1,402 @@
+#include "PrimitiveBatch.hh"
+#include "PrimitivePoint.hh"
+#include "PrimitiveLine.hh"
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <system_error>
+
+using namespace std;
+
+namespace {
+
+/** @brief Number of bits of keys used for the index within a type. */
+const int INDEX_BITS = 28;
+
+/** @brief Returns key of primitive with given type and index. */
+unsigned int MakeKey(PrimitiveBatch::PrimitiveType type, int index)
+{
+  return ((unsigned int)type << INDEX_BITS) | (unsigned int)index;
+}
+
+/** @brief Returns pixel index of coordinate v rounded down, clamped to
+           [lo, hi] to avoid overflows for coordinates far outside. */
+int ClampFloor(double v, int lo, int hi)
+{
+  v = floor(v);
+  return (v < lo) ? lo : (v > hi) ? hi : (int)v;
+}
+
+/** @brief Returns pixel index of coordinate v rounded up, clamped to
+           [lo, hi]. */
+int ClampCeil(double v, int lo, int hi)
+{
+  v = ceil(v);
+  return (v < lo) ? lo : (v > hi) ? hi : (int)v;
+}
+
+}
+
+PrimitiveBatch::PrimitiveBatch(int tileSize)
+  : tileSize_(256), numThreads_(0)
+{
+  SetTileSize(tileSize);
+}
+
+void PrimitiveBatch::Clear()
+{
+  pointX_.clear();
+  pointY_.clear();
+  pointColors_.clear();
+  lineX0_.clear();
+  lineY0_.clear();
+  lineX1_.clear();
+  lineY1_.clear();
+  lineColors_.clear();
+  lineRenderModes_.clear();
+  vertexX_.clear();
+  vertexY_.clear();
+  polygonStart_.clear();
+  polygonColors_.clear();
+  polygonFillModes_.clear();
+  polygonRenderModes_.clear();
+  order_.clear();
+}
+
+bool PrimitiveBatch::IsEmpty() const
+{
+  return order_.empty();
+}
+
+int PrimitiveBatch::GetNumPrimitives() const
+{
+  return order_.size();
+}
+
+int PrimitiveBatch::GetNumPrimitives(PrimitiveType type) const
+{
+  switch (type) {
+    case PT_Point:
+      return pointColors_.size();
+    case PT_Line:
+      return lineColors_.size();
+    default:
+      return polygonColors_.size();
+  }
+}
+
+int PrimitiveBatch::GetTileSize() const
+{
+  return tileSize_;
+}
+
+void PrimitiveBatch::SetTileSize(int tileSize)
+{
+  if (tileSize < 8) {
+    cerr << "PrimitiveBatch::SetTileSize() : Invalid tile size " << tileSize << "!" << endl;
+    return;
+  }
+  tileSize_ = tileSize;
+}
+
+int PrimitiveBatch::GetNumThreads() const
+{
+  int numThreads = numThreads_;
+  if (numThreads == 0)
+    numThreads = (int)thread::hardware_concurrency();
+  return numThreads > 0 ? numThreads : 1;
+}
+
+void PrimitiveBatch::SetNumThreads(int numThreads)
+{
+  numThreads_ = (numThreads > 0) ? numThreads : 0;
+}
+
+void PrimitiveBatch::AddPoint(const Color &color, const Float2D &pos)
+{
+  order_.push_back(MakeKey(PT_Point, pointColors_.size()));
+  pointX_.push_back(pos[0]);
+  pointY_.push_back(pos[1]);
+  pointColors_.push_back(color);
+}
+
+void PrimitiveBatch::AddLine(const Color &color, const Float2D &start, const Float2D &end,
+                             PrimitiveBase::RenderMode renderMode)
+{
+  order_.push_back(MakeKey(PT_Line, lineColors_.size()));
+  lineX0_.push_back(start[0]);
+  lineY0_.push_back(start[1]);
+  lineX1_.push_back(end[0]);
+  lineY1_.push_back(end[1]);
+  lineColors_.push_back(color);
+  lineRenderModes_.push_back((unsigned char)renderMode);
+}
+
+void PrimitiveBatch::AddPolygon(const Color &color, const vector<Float2D> &points,
+                                PrimitivePolygon::FillMode fillMode,
+                                PrimitiveBase::RenderMode renderMode)
+{
+  if (polygonStart_.empty())
+    polygonStart_.push_back(0);
+  order_.push_back(MakeKey(PT_Polygon, polygonColors_.size()));
+  for (size_t n = 0; n < points.size(); n++) {
+    vertexX_.push_back(points[n][0]);
+    vertexY_.push_back(points[n][1]);
+  }
+  polygonStart_.push_back(vertexX_.size());
+  polygonColors_.push_back(color);
+  polygonFillModes_.push_back((unsigned char)fillMode);
+  polygonRenderModes_.push_back((unsigned char)renderMode);
+}
+
+void PrimitiveBatch::AddRectangle(const Color &color, const Float2D &topLeft,
+                                  const Float2D &bottomRight,
+                                  PrimitivePolygon::FillMode fillMode,
+                                  PrimitiveBase::RenderMode renderMode)
+{
+  // Same points as PrimitiveRectangle
+  vector<Float2D> points(4);
+  points[0] = topLeft;
+  points[1] = Float2D(bottomRight[0], topLeft[1]);
+  points[2] = bottomRight;
+  points[3] = Float2D(topLeft[0], bottomRight[1]);
+  AddPolygon(color, points, fillMode, renderMode);
+}
+
+bool PrimitiveBatch::Add(const PrimitiveBase &primitive)
+{
+  if (const PrimitivePolygon *polygon = dynamic_cast<const PrimitivePolygon*>(&primitive)) {
+    vector<Float2D> points(polygon->GetNumPoints());
+    for (size_t n = 0; n < points.size(); n++)
+      points[n] = polygon->GetPoint(n);
+    AddPolygon(polygon->GetColor(), points, polygon->GetFillMode(),
+               polygon->GetRenderMode());
+  } else if (dynamic_cast<const PrimitiveLine*>(&primitive)) {
+    AddLine(primitive.GetColor(), primitive.GetPoint(0), primitive.GetPoint(1),
+            primitive.GetRenderMode());
+  } else if (dynamic_cast<const PrimitivePoint*>(&primitive)) {
+    AddPoint(primitive.GetColor(), primitive.GetPoint(0));
+  } else {
+    cerr << "PrimitiveBatch::Add() : Unsupported primitive type!" << endl;
+    return false;
+  }
+  return true;
+}
+
+void PrimitiveBatch::RemoveLast()
+{
+  if (order_.empty())
+    return;
+  PrimitiveType type = (PrimitiveType)(order_.back() >> INDEX_BITS);
+  order_.pop_back();
+  if (type == PT_Point) {
+    pointX_.pop_back();
+    pointY_.pop_back();
+    pointColors_.pop_back();
+  } else if (type == PT_Line) {
+    lineX0_.pop_back();
+    lineY0_.pop_back();
+    lineX1_.pop_back();
+    lineY1_.pop_back();
+    lineColors_.pop_back();
+    lineRenderModes_.pop_back();
+  } else {
+    polygonStart_.pop_back();
+    vertexX_.resize(polygonStart_.back());
+    vertexY_.resize(polygonStart_.back());
+    polygonColors_.pop_back();
+    polygonFillModes_.pop_back();
+    polygonRenderModes_.pop_back();
+  }
+}
+
+void PrimitiveBatch::ApplyTransform(const AffineTransform &T)
+{
+  vector<float> *xs[4] = { &pointX_, &lineX0_, &lineX1_, &vertexX_ };
+  vector<float> *ys[4] = { &pointY_, &lineY0_, &lineY1_, &vertexY_ };
+  for (int k = 0; k < 4; k++) {
+    float *x = xs[k]->data(), *y = ys[k]->data();
+    for (size_t i = 0; i < xs[k]->size(); i++) {
+      Float2D p(x[i], y[i]);
+      T.Transform(p);
+      x[i] = p[0];
+      y[i] = p[1];
+    }
+  }
+}
+
+void PrimitiveBatch::Draw(Image &image)
+{
+  Draw(ImageView(image));
+}
+
+void PrimitiveBatch::Draw(const ImageView &view)
+{
+  if (order_.empty() || view.IsEmpty() || view.IsReadOnly())
+    return;
+  int tilesX, tilesY;
+  BinPrimitives_(view.GetWidth(), view.GetHeight(), tilesX, tilesY);
+
+  // Use as many threads as there are tiles with primitives, but not more
+  // than one per MIN_PRIMITIVES_PER_THREAD binned primitives
+  int numTiles = tilesX * tilesY, numBusyTiles = 0;
+  for (int bin = 0; bin < numTiles; bin++)
+    if (binStart_[bin] < binStart_[bin + 1])
+      numBusyTiles++;
+  if (numBusyTiles == 0)
+    return;
+  int numThreads = min(GetNumThreads(), numBusyTiles);
+  numThreads = min(numThreads, max(1, binStart_[numTiles] / MIN_PRIMITIVES_PER_THREAD));
+
+  // Draw tiles in this thread and in new threads, each taking the next
+  // tile when done with the previous one
+  atomic<int> nextBin(0);
+  vector<thread> threads;
+  threads.reserve(numThreads - 1);
+  for (int i = 1; i < numThreads; i++) {
+    try {
+      threads.push_back(thread(&PrimitiveBatch::DrawTiles_, this, cref(view),
+                               tilesX, tilesY, ref(nextBin)));
+    } catch (const system_error &) {
+      break;
+    }
+  }
+  DrawTiles_(view, tilesX, tilesY, nextBin);
+  for (size_t i = 0; i < threads.size(); i++)
+    threads[i].join();
+}
+
+void PrimitiveBatch::BinPrimitives_(int width, int height, int &tilesX, int &tilesY)
+{
+  tilesX = (width + tileSize_ - 1) / tileSize_;
+  tilesY = (height + tileSize_ - 1) / tileSize_;
+  int numTiles = tilesX * tilesY;
+
+  // Compute bounding boxes in pixels, enlarged by three pixels to include
+  // rounding of all primitives (coordinates are rounded toward zero after
+  // adding 0.5) and the cross of points. Boxes outside the view are marked
+  // empty by x0 > x1
+  int numKeys = order_.size();
+  boxes_.resize(4 * numKeys);
+  for (int k = 0; k < numKeys; k++) {
+    int index = order_[k] & ((1u << INDEX_BITS) - 1);
+    const float *x, *y;
+    int numPoints;
+    float lineX[2], lineY[2];
+    switch ((PrimitiveType)(order_[k] >> INDEX_BITS)) {
+      case PT_Point:
+        x = &pointX_[index];
+        y = &pointY_[index];
+        numPoints = 1;
+        break;
+      case PT_Line:
+        lineX[0] = lineX0_[index];
+        lineY[0] = lineY0_[index];
+        lineX[1] = lineX1_[index];
+        lineY[1] = lineY1_[index];
+        x = lineX;
+        y = lineY;
+        numPoints = 2;
+        break;
+      default:
+        x = vertexX_.data() + polygonStart_[index];
+        y = vertexY_.data() + polygonStart_[index];
+        numPoints = polygonStart_[index + 1] - polygonStart_[index];
+    }
+    int *box = &boxes_[4 * k];
+    box[0] = box[1] = 1;
+    box[2] = box[3] = 0;
+    if (numPoints == 0)
+      continue;
+    float minX = x[0], maxX = x[0], minY = y[0], maxY = y[0];
+    for (int n = 1; n < numPoints; n++) {
+      minX = min(minX, x[n]);
+      maxX = max(maxX, x[n]);
+      minY = min(minY, y[n]);
+      maxY = max(maxY, y[n]);
+    }
+    if (maxX + 3.0 < 0.0 || maxY + 3.0 < 0.0 || minX - 3.0 > width - 1 ||
+        minY - 3.0 > height - 1)
+      continue;
+    box[0] = ClampFloor(minX - 3.0, 0, width - 1);
+    box[1] = ClampFloor(minY - 3.0, 0, height - 1);
+    box[2] = ClampCeil(maxX + 3.0, 0, width - 1);
+    box[3] = ClampCeil(maxY + 3.0, 0, height - 1);
+  }
+
+  // Count keys per tile, compute the end of each bin and place keys in
+  // reverse order, which leaves the start of each bin and keeps the keys
+  // of each bin in drawing order
+  binStart_.assign(numTiles + 1, 0);
+  for (int k = 0; k < numKeys; k++) {
+    const int *box = &boxes_[4 * k];
+    if (box[0] > box[2])
+      continue;
+    for (int ty = box[1] / tileSize_; ty <= box[3] / tileSize_; ty++)
+      for (int tx = box[0] / tileSize_; tx <= box[2] / tileSize_; tx++)
+        binStart_[ty * tilesX + tx]++;
+  }
+  for (int t = 1; t < numTiles; t++)
+    binStart_[t] += binStart_[t - 1];
+  binStart_[numTiles] = binStart_[numTiles - 1];
+  binKeys_.resize(binStart_[numTiles]);
+  for (int k = numKeys - 1; k >= 0; k--) {
+    const int *box = &boxes_[4 * k];
+    if (box[0] > box[2])
+      continue;
+    for (int ty = box[1] / tileSize_; ty <= box[3] / tileSize_; ty++)
+      for (int tx = box[0] / tileSize_; tx <= box[2] / tileSize_; tx++)
+        binKeys_[--binStart_[ty * tilesX + tx]] = order_[k];
+  }
+}
+
+void PrimitiveBatch::DrawTiles_(const ImageView &view, int tilesX, int tilesY,
+                                atomic<int> &nextBin) const
+{
+  int numTiles = tilesX * tilesY;
+  for (int bin = nextBin++; bin < numTiles; bin = nextBin++) {
+    if (binStart_[bin] == binStart_[bin + 1])
+      continue;
+    int x = (bin % tilesX) * tileSize_, y = (bin / tilesX) * tileSize_;
+    DrawTile_(view.GetSubView(x, y, tileSize_, tileSize_), bin, x, y);
+  }
+}
+
+void PrimitiveBatch::DrawTile_(const ImageView &tile, int bin, int originX, int originY) const
+{
+  for (int i = binStart_[bin]; i < binStart_[bin + 1]; i++)
+    DrawPrimitive_(tile, binKeys_[i], originX, originY);
+}
+
+void PrimitiveBatch::DrawPrimitive_(const ImageView &view, unsigned int key,
+                                    int originX, int originY) const
+{
+  int index = key & ((1u << INDEX_BITS) - 1);
+  switch ((PrimitiveType)(key >> INDEX_BITS)) {
+    case PT_Point:
+      PrimitivePoint::DrawPoint(view, Float2D(pointX_[index], pointY_[index]),
+                                pointColors_[index], originX, originY);
+      break;
+    case PT_Line:
+    {
+      Float2D start(lineX0_[index], lineY0_[index]), end(lineX1_[index], lineY1_[index]);
+      if (lineRenderModes_[index] == PrimitiveBase::RM_AntiAliased)
+        PrimitiveLine::DrawLineAntiAliased(view, start, end, lineColors_[index],
+                                           originX, originY);
+      else
+        PrimitiveLine::DrawLine(view, start, end, lineColors_[index], originX, originY);
+      break;
+    }
+    case PT_Polygon:
+    {
+      int start = polygonStart_[index];
+      PrimitivePolygon::DrawPolygon(view, vertexX_.data() + start, vertexY_.data() + start,
+                                    polygonStart_[index + 1] - start,
+                                    (PrimitivePolygon::FillMode)polygonFillModes_[index],
+                                    (PrimitiveBase::RenderMode)polygonRenderModes_[index],
+                                    polygonColors_[index], originX, originY);
+      break;
+    }
+  }
+}
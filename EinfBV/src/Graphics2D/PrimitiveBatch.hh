@@ -0,0 +1,176 @@
+#ifndef __PrimitiveBatch_hh__
+#define __PrimitiveBatch_hh__
+
+#include "Color.hh"
+#include "Image.hh"
+#include "ImageView.hh"
+#include "Vectors.hh"
+#include "AffineTransform.hh"
+#include "PrimitiveBase.hh"
+#include "PrimitivePolygon.hh"
+#include <vector>
+#include <atomic>
+
+/** @class PrimitiveBatch
+    @brief Display list of points, lines and polygons that are drawn
+           together tile by tile, e.g. to render many thousand annotations
+           into an overlay image.
+
+    Primitives are not stored as objects, but in contiguous arrays per type
+    with separate arrays for x and y coordinates, colors and modes, so
+    adding and transforming primitives touches no scattered heap objects.
+    Draw() computes the bounding box of each primitive, sorts the primitives
+    into bins of tiles of the image and then draws each tile in one pass
+    with the static drawing functions of the primitive classes, without
+    virtual calls, while the tile stays in the cache.
+
+    Primitives are drawn in the order they were added, also between types,
+    and give exactly the same pixels as PrimitiveBase::Draw(). Primitives
+    overlapping several tiles are clipped and set up once per tile, so the
+    tile size should be large compared to typical primitives.
+
+    Tiles do not overlap, so they are drawn in parallel by several threads
+    (see SetNumThreads()) which take the next tile until all are drawn.
+    Each pixel is written by one thread only, so the result does not depend
+    on the number of threads.
+
+    @code
+    PrimitiveBatch batch;
+    batch.AddRectangle(Color::RED, Float2D(10, 10), Float2D(50, 30),
+                       PrimitivePolygon::FM_NonZero);
+    batch.AddLine(Color::GREEN, Float2D(0, 0), Float2D(100, 80));
+    batch.Draw(image);
+    @endcode
+
+    @attention Draw() reuses buffers of the batch, so one batch must not be
+               drawn from several threads at the same time.
+ */
+class PrimitiveBatch
+{
+public:
+
+  /** @brief Types of primitives stored in the batch */
+  enum PrimitiveType { PT_Point, PT_Line, PT_Polygon };
+
+  /** @brief Create empty batch drawn in tiles of tileSize x tileSize pixels. */
+  explicit PrimitiveBatch(int tileSize = 256);
+
+  /** @brief Remove all primitives, memory is kept for new primitives. */
+  void Clear();
+
+  /** @brief Returns if the batch contains no primitives. */
+  bool IsEmpty() const;
+
+  /** @brief Returns number of primitives of all types. */
+  int GetNumPrimitives() const;
+
+  /** @brief Returns number of primitives of the given type. */
+  int GetNumPrimitives(PrimitiveType type) const;
+
+  /** @brief Returns tile size in pixels. */
+  int GetTileSize() const;
+
+  /** @brief Set tile size in pixels, e.g. 64 to 512. */
+  void SetTileSize(int tileSize);
+
+  /** @brief Returns maximum number of threads used by Draw(), i.e. the
+             number of processor cores if set to 0. */
+  int GetNumThreads() const;
+
+  /** @brief Set maximum number of threads used by Draw(). Passing 0 uses
+             one thread per processor core, which is the default. Few
+             primitives or tiles are always drawn by fewer threads. */
+  void SetNumThreads(int numThreads);
+
+  /** @brief Add point primitive (see PrimitivePoint). */
+  void AddPoint(const Color &color, const Float2D &pos);
+
+  /** @brief Add line primitive (see PrimitiveLine). */
+  void AddLine(const Color &color, const Float2D &start, const Float2D &end,
+               PrimitiveBase::RenderMode renderMode = PrimitiveBase::RM_Aliased);
+
+  /** @brief Add polygon primitive (see PrimitivePolygon). */
+  void AddPolygon(const Color &color, const std::vector<Float2D> &points,
+                  PrimitivePolygon::FillMode fillMode = PrimitivePolygon::FM_Outline,
+                  PrimitiveBase::RenderMode renderMode = PrimitiveBase::RM_Aliased);
+
+  /** @brief Add rectangle primitive (see PrimitiveRectangle). */
+  void AddRectangle(const Color &color, const Float2D &topLeft, const Float2D &bottomRight,
+                    PrimitivePolygon::FillMode fillMode = PrimitivePolygon::FM_Outline,
+                    PrimitiveBase::RenderMode renderMode = PrimitiveBase::RM_Aliased);
+
+  /** @brief Add copy of a point, line or polygon primitive object.
+      @return Returns false if the type of the primitive is not supported. */
+  bool Add(const PrimitiveBase &primitive);
+
+  /** @brief Remove the most recently added primitive. */
+  void RemoveLast();
+
+  /** @brief Apply affine transformation to all primitives. */
+  void ApplyTransform(const AffineTransform &T);
+
+  /** @brief Draw all primitives into given image. */
+  void Draw(Image &image);
+
+  /** @brief Draw all primitives into image region referenced by the view,
+             using coordinates relative to the top left corner of the view. */
+  void Draw(const ImageView &view);
+
+private:
+
+  /** @brief Compute bounding boxes of all primitives and sort them into
+             bins of tiles of a view with given size. Returns the number of
+             tiles per row and column. */
+  void BinPrimitives_(int width, int height, int &tilesX, int &tilesY);
+
+  /** @brief Draw tiles of the bins taken from nextBin until all tiles of
+             the view are drawn, called by each thread of Draw(). */
+  void DrawTiles_(const ImageView &view, int tilesX, int tilesY,
+                  std::atomic<int> &nextBin) const;
+
+  /** @brief Draw all primitives of bin into tile view with given origin. */
+  void DrawTile_(const ImageView &tile, int bin, int originX, int originY) const;
+
+  /** @brief Draw single primitive stored with given key (see order_). */
+  void DrawPrimitive_(const ImageView &view, unsigned int key,
+                      int originX, int originY) const;
+
+  /** @brief Minimum number of binned primitives drawn per thread */
+  static const int MIN_PRIMITIVES_PER_THREAD = 256;
+
+  /** @brief Tile size in pixels */
+  int tileSize_;
+
+  /** @brief Number of threads set by SetNumThreads() */
+  int numThreads_;
+
+  /** @brief Points: positions and colors */
+  std::vector<float> pointX_, pointY_;
+  std::vector<Color> pointColors_;
+
+  /** @brief Lines: start and end points, colors and render modes */
+  std::vector<float> lineX0_, lineY0_, lineX1_, lineY1_;
+  std::vector<Color> lineColors_;
+  std::vector<unsigned char> lineRenderModes_;
+
+  /** @brief Polygons: coordinates of all polygons, index of the first point
+             of each polygon (plus one past the last), colors and modes */
+  std::vector<float> vertexX_, vertexY_;
+  std::vector<int> polygonStart_;
+  std::vector<Color> polygonColors_;
+  std::vector<unsigned char> polygonFillModes_, polygonRenderModes_;
+
+  /** @brief Drawing order of all primitives, each key stores the type in
+             the upper 4 bits and the index within the type */
+  std::vector<unsigned int> order_;
+
+  /** @brief Bins of keys per tile, binStart_ holds the index of the first
+             key of each bin in binKeys_ (plus one past the last). Bounding
+             boxes in pixels (x0, y0, x1, y1) are stored per key of order_. */
+  std::vector<int> binStart_;
+  std::vector<unsigned int> binKeys_;
+  std::vector<int> boxes_;
+
+};
+
+#endif // __PrimitiveBatch_hh__
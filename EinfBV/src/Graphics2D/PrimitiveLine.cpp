@@ -1,8 +1,112 @@
 #include "PrimitiveLine.hh"
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 
 using namespace std;
 
+namespace {
+
+/** @brief Endpoint coordinates are clamped to this range before rounding,
+           so 64-bit clipping arithmetic cannot overflow. */
+const float MaxCoordinate = (float)(1 << 28);
+
+/** @brief Round coordinate to the nearest pixel like the original
+           Bresenham implementation. */
+int RoundCoordinate(float v)
+{
+  v += 0.5f;
+  return (int)max(-MaxCoordinate, min(MaxCoordinate, v));
+}
+
+/** @brief Clip segment from (x1, y1) to (x2, y2) to the square [lo, hi]^2
+           with the Liang-Barsky algorithm.
+    @return Returns false if the segment is completely outside. */
+bool ClipSegment(double &x1, double &y1, double &x2, double &y2, double lo, double hi)
+{
+  double dx = x2 - x1, dy = y2 - y1, t0 = 0.0, t1 = 1.0;
+  const double p[4] = { -dx, dx, -dy, dy };
+  const double q[4] = { x1 - lo, hi - x1, y1 - lo, hi - y1 };
+  for (int i = 0; i < 4; i++) {
+    if (p[i] == 0.0) {
+      if (q[i] < 0.0)
+        return false;
+    } else {
+      double t = q[i] / p[i];
+      if (p[i] < 0.0)
+        t0 = max(t0, t);
+      else
+        t1 = min(t1, t);
+    }
+  }
+  if (t0 > t1)
+    return false;
+  if (t0 > 0.0 || t1 < 1.0) {
+    double x = x1, y = y1;
+    x1 = x + t0 * dx;
+    y1 = y + t0 * dy;
+    x2 = x + t1 * dx;
+    y2 = y + t1 * dy;
+  }
+  return true;
+}
+
+/** @brief Returns a / b rounded up for b > 0. */
+long long CeilDiv(long long a, long long b)
+{
+  return (a >= 0) ? (a + b - 1) / b : -((-a) / b);
+}
+
+/** @brief Restrict the steps [i0, i1] along a coordinate starting at
+           start with direction step to pixels in [0, size). */
+void ClipSteps(int start, int step, int size, long long &i0, long long &i1)
+{
+  long long lo = (step > 0) ? -(long long)start : (long long)start - (size - 1);
+  long long hi = (step > 0) ? (long long)size - 1 - start : (long long)start;
+  i0 = max(i0, lo);
+  i1 = min(i1, hi);
+}
+
+/** @brief Write n pixels of a Bresenham line with precomputed values per
+           channel, starting at p. Pointer steps along the major and minor
+           axis are given in bytes. */
+template <typename T, int Channels>
+void DrawSteps(unsigned char *p, int n, int majorStep, int minorStep,
+               long long E, long long incE, long long decE,
+               const T *values, int channelStep)
+{
+  for (int i = 0; i < n; i++) {
+    for (int c = 0; c < Channels; c++)
+      *(T*)(p + c * channelStep) = values[c];
+    p += majorStep;
+    if (E <= 0) {
+      E += incE;
+    } else {
+      p += minorStep;
+      E += decE;
+    }
+  }
+}
+
+/** @brief Convert color to values of type T and draw steps. */
+template <typename T>
+void DrawSteps(const ImageView &view, unsigned char *p, int n, int majorStep,
+               int minorStep, long long E, long long incE, long long decE,
+               const Color &color)
+{
+  const unsigned char colorValues[3] = { color.red, color.green, color.blue };
+  T values[3];
+  for (int c = 0; c < 3; c++)
+    Image::WriteUInt8((unsigned char*)&values[c], view.GetPixelType(), colorValues[c]);
+  int channelStep = view.IsPlanar() ? view.GetPlaneStride() : (int)sizeof(T);
+  if (view.GetColorModel() == Image::CM_Gray)
+    DrawSteps<T, 1>(p, n, majorStep, minorStep, E, incE, decE, values, channelStep);
+  else
+    DrawSteps<T, 3>(p, n, majorStep, minorStep, E, incE, decE, values, channelStep);
+}
+
+}
+
 PrimitiveLine::PrimitiveLine(const Color &color, const Float2D &start, const Float2D &end)
   : PrimitiveBase(color, 2)
 {
@@ -14,46 +118,143 @@ PrimitiveLine::~PrimitiveLine()
 {
 }
 
-void PrimitiveLine::Draw(Image &image) const
+void PrimitiveLine::Draw(const ImageView &view) const
+{
+  if (renderMode_ == RM_AntiAliased)
+    DrawLineAntiAliased(view, GetPoint(0), GetPoint(1), color_);
+  else
+    DrawLine(view, GetPoint(0), GetPoint(1), color_);
+}
+
+void PrimitiveLine::DrawLine(const ImageView &view, const Float2D &start,
+                             const Float2D &end, const Color &color,
+                             int originX, int originY)
 {
-  // Compute integer coordinates of endpoints
-  int x1 = (int)(GetPoint(0)[0] + 0.5f);
-  int y1 = (int)(GetPoint(0)[1] + 0.5f);
-  int x2 = (int)(GetPoint(1)[0] + 0.5f);
-  int y2 = (int)(GetPoint(1)[1] + 0.5f);
+  if (view.IsEmpty() || view.IsReadOnly())
+    return;
+
+  // Compute integer coordinates of endpoints relative to the view
+  int x1 = RoundCoordinate(start[0]) - originX, y1 = RoundCoordinate(start[1]) - originY;
+  int x2 = RoundCoordinate(end[0]) - originX, y2 = RoundCoordinate(end[1]) - originY;
   // Compute absolute distance along x- and y-direction
   int dx = abs(x2 - x1), dy = abs(y2 - y1);
   // Compute direction of steps in x- and y-direction
   int sx = x1 < x2 ? 1 : -1, sy = y1 < y2 ? 1 : -1;
-  if (dx > dy) {
-    // Draw line along x-direction (slope <= 45 degree)
-    int E = 2*dy - dx;
-    for (int i = 0; i <= dx; i++) {
-      image.SetPixel(x1, y1, color_, true);
-      // Update coordinates and decision variable
-      if (E <= 0) {
-        x1 += sx;
-        E += 2*dy;
-      } else {
-        x1 += sx;
-        y1 += sy;
-        E += 2*(dy - dx);
-      }
-    }
-  } else {
-    // Draw line along y-direction (flip roles of x and y)
-    int E = 2*dx - dy;
-    for (int i = 0; i <= dy; i++) {
-      image.SetPixel(x1, y1, color_, true);
-      // Update coordinates and decision variable
-      if (E <= 0) {
-        y1 += sy;
-        E += 2*dx;
-      } else {
-        y1 += sy;
-        x1 += sx;
-        E += 2*(dx - dy);
-      }
-    }
+
+  // Flip roles of x and y for lines along y-direction (slope > 45 degree),
+  // so the major axis a is stepped every pixel and the minor axis b only
+  // if the decision variable E is positive
+  bool alongX = (dx > dy);
+  int a1 = alongX ? x1 : y1, b1 = alongX ? y1 : x1;
+  int da = alongX ? dx : dy, db = alongX ? dy : dx;
+  int sa = alongX ? sx : sy, sb = alongX ? sy : sx;
+  int sizeA = alongX ? view.GetWidth() : view.GetHeight();
+  int sizeB = alongX ? view.GetHeight() : view.GetWidth();
+
+  // After i steps the minor axis has advanced k(i) = floor((2 db i + da - 1) / (2 da))
+  // times. Clip the steps to the view along the major axis directly and along
+  // the minor axis by inverting k(i), so only visible pixels are visited
+  long long i0 = 0, i1 = da;
+  ClipSteps(a1, sa, sizeA, i0, i1);
+  long long k0 = 0, k1 = db;
+  ClipSteps(b1, sb, sizeB, k0, k1);
+  if (k0 > k1)
+    return;
+  if (k0 > 0)
+    i0 = max(i0, CeilDiv(2LL * da * k0 - da + 1, 2LL * db));
+  if (k1 < db)
+    i1 = min(i1, CeilDiv(2LL * da * (k1 + 1) - da + 1, 2LL * db) - 1);
+  if (i0 > i1)
+    return;
+
+  // Start at first visible step with the decision variable of that step
+  long long k = (da > 0) ? (2LL * db * i0 + da - 1) / (2LL * da) : 0;
+  long long E = 2LL * db * (i0 + 1) - da - 2LL * da * k;
+  int x = (int)(alongX ? a1 + sa * i0 : b1 + sb * k);
+  int y = (int)(alongX ? b1 + sb * k : a1 + sa * i0);
+
+  // Write pixels through the row pointer, stepping pixels along x and rows
+  // along y
+  int pixelStep = view.IsPlanar() ? view.GetBytesPerValue()
+                                  : view.GetChannels() * view.GetBytesPerValue();
+  int stepX = sx * pixelStep, stepY = sy * view.GetStride();
+  int majorStep = alongX ? stepX : stepY, minorStep = alongX ? stepY : stepX;
+  unsigned char *p = view.GetRow(y) + x * pixelStep;
+  int n = (int)(i1 - i0 + 1);
+  long long incE = 2LL * db, decE = 2LL * (db - da);
+  switch (view.GetPixelType()) {
+  case Image::PT_UInt8:
+    DrawSteps<unsigned char>(view, p, n, majorStep, minorStep, E, incE, decE, color);
+    break;
+  case Image::PT_UInt16:
+    DrawSteps<unsigned short>(view, p, n, majorStep, minorStep, E, incE, decE, color);
+    break;
+  case Image::PT_Float:
+    DrawSteps<float>(view, p, n, majorStep, minorStep, E, incE, decE, color);
+    break;
+  }
+}
+
+void PrimitiveLine::DrawLineAntiAliased(const ImageView &view, const Float2D &start,
+                                       const Float2D &end, const Color &color,
+                                       int originX, int originY)
+{
+  if (view.IsEmpty() || view.IsReadOnly())
+    return;
+
+  // Work in image coordinates, so drawing into tiles with an origin gives
+  // the same pixels as drawing at once, and keep coordinates in a range
+  // where fixed point arithmetic cannot overflow
+  double x1 = start[0], y1 = start[1], x2 = end[0], y2 = end[1];
+  if (!ClipSegment(x1, y1, x2, y2, -MaxCoordinate, MaxCoordinate))
+    return;
+
+  // Step along the major axis a from left to right (or top to bottom)
+  bool alongX = fabs(end[0] - start[0]) >= fabs(end[1] - start[1]);
+  double a1 = alongX ? x1 : y1, b1 = alongX ? y1 : x1;
+  double a2 = alongX ? x2 : y2, b2 = alongX ? y2 : x2;
+  if (a1 > a2) {
+    swap(a1, a2);
+    swap(b1, b2);
+  }
+  int originA = alongX ? originX : originY, originB = alongX ? originY : originX;
+  int sizeA = alongX ? view.GetWidth() : view.GetHeight();
+  int sizeB = alongX ? view.GetHeight() : view.GetWidth();
+  double gradient = (a2 > a1) ? (b2 - b1) / (a2 - a1) : 0.0;
+
+  // Clip steps to the view and to minor positions in (originB - 1,
+  // originB + sizeB), outside of which no pixel of the view is touched
+  double first = floor(a1 + 0.5);
+  double lo = max(first, (double)originA);
+  double hi = min(floor(a2 + 0.5), (double)originA + sizeA - 1);
+  if (gradient != 0.0) {
+    double t0 = a1 + (originB - 1.0 - b1) / gradient;
+    double t1 = a1 + (originB + sizeB - b1) / gradient;
+    if (t0 > t1)
+      swap(t0, t1);
+    lo = max(lo, floor(t0));
+    hi = min(hi, ceil(t1));
+  } else if (b1 <= originB - 1.0 || b1 >= originB + sizeB) {
+    return;
+  }
+  if (lo > hi)
+    return;
+
+  // Track the minor position in 32.32 fixed point from the first step of
+  // the line and split each step between the two nearest pixels by the
+  // fractional part (Wu's algorithm). The rounding error of the step stays
+  // far below a pixel even for starts 2^28 pixels outside of the view
+  const double ONE = 4294967296.0;
+  long long step = llround(gradient * ONE);
+  long long b = llround((b1 + gradient * (first - a1)) * ONE) +
+                (long long)(lo - first) * step;
+  int a0 = (int)lo - originA, n = (int)(hi - lo) + 1;
+  for (int i = 0; i < n; i++, b += step) {
+    int a = a0 + i, bi = (int)(b >> 32) - originB;
+    unsigned char frac = (unsigned char)((b >> 24) & 255);
+    if (frac < 255)
+      view.BlendPixel(alongX ? a : bi, alongX ? bi : a, color, 255 - frac, true);
+    if (frac > 0)
+      view.BlendPixel(alongX ? a : bi + 1, alongX ? bi + 1 : a, color, frac, true);
   }
 }
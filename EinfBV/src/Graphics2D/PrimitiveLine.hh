@@ -17,8 +17,31 @@ public:
   /** @brief Destructor. Release dynamically allocated memory. */
   virtual ~PrimitiveLine();
 
-  /** @brief Draw line into given image using the Bresenham algorithm. */
-  virtual void Draw(Image &image) const;
+  using PrimitiveBase::Draw;
+
+  /** @brief Draw line into given image view using the Bresenham algorithm,
+             or Wu's algorithm in anti-aliased render mode. */
+  virtual void Draw(const ImageView &view) const;
+
+  /** @brief Draw line between given points into the view. The line is
+             clipped to the view before rasterization, so only visible pixels
+             are visited, and pixels are written through row pointers instead
+             of SetPixel(). Draws the same pixels as an unclipped Bresenham
+             line with bounds checks per pixel. (originX, originY) are the
+             coordinates of the top left pixel of the view, so drawing into
+             tiles of an image gives the same pixels as drawing at once. */
+  static void DrawLine(const ImageView &view, const Float2D &start,
+                       const Float2D &end, const Color &color,
+                       int originX = 0, int originY = 0);
+
+  /** @brief Draw anti-aliased line between given points into the view with
+             Wu's algorithm. Each step along the major axis blends the color
+             into the two pixels nearest to the line, weighted by the
+             distance in fixed point arithmetic. Endpoints are rounded to
+             the nearest pixel along the major axis. */
+  static void DrawLineAntiAliased(const ImageView &view, const Float2D &start,
+                                  const Float2D &end, const Color &color,
+                                  int originX = 0, int originY = 0);
 
 };
 
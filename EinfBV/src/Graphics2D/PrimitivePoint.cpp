@@ -13,13 +13,21 @@ PrimitivePoint::~PrimitivePoint()
 {
 }
 
-void PrimitivePoint::Draw(Image &image) const
+void PrimitivePoint::Draw(const ImageView &view) const
 {
-  int x = (int)(GetPoint(0)[0] + 0.5f);
-  int y = (int)(GetPoint(0)[1] + 0.5f);
-  image.SetPixel(x, y, color_, true);
-  image.SetPixel(x-1, y, color_, true);
-  image.SetPixel(x+1, y, color_, true);
-  image.SetPixel(x, y-1, color_, true);
-  image.SetPixel(x, y+1, color_, true);
+  DrawPoint(view, GetPoint(0), color_);
+}
+
+void PrimitivePoint::DrawPoint(const ImageView &view, const Float2D &pos,
+                               const Color &color, int originX, int originY)
+{
+  if (view.IsReadOnly())
+    return;
+  int x = (int)(pos[0] + 0.5f) - originX;
+  int y = (int)(pos[1] + 0.5f) - originY;
+  view.SetPixel(x, y, color, true);
+  view.SetPixel(x-1, y, color, true);
+  view.SetPixel(x+1, y, color, true);
+  view.SetPixel(x, y-1, color, true);
+  view.SetPixel(x, y+1, color, true);
 }
@@ -17,8 +17,16 @@ public:
   /** @brief Destructor. Release dynamically allocated memory. */
   virtual ~PrimitivePoint();
 
-  /** @brief Draw point into given image. */
-  virtual void Draw(Image &image) const;
+  using PrimitiveBase::Draw;
+
+  /** @brief Draw point into given image view. */
+  virtual void Draw(const ImageView &view) const;
+
+  /** @brief Draw point at given position as small cross into the view,
+             where (originX, originY) are the coordinates of the top left
+             pixel of the view, e.g. to draw into a tile of the image. */
+  static void DrawPoint(const ImageView &view, const Float2D &pos, const Color &color,
+                        int originX = 0, int originY = 0);
 
 };
 
@@ -2,17 +2,118 @@
 #include "PrimitiveLine.hh"
 #include <algorithm>
 #include <iostream>
+#include <cmath>
 
 using namespace std;
 
-PrimitivePolygon::PrimitivePolygon(const Color &color, int numPoints)
-  : PrimitiveBase(color, numPoints)
+namespace {
+
+/** @brief Polygon edge in the edge table, covering rows yStart to yEnd. */
+struct Edge
+{
+  int yStart, yEnd;
+  /** @brief Upper end point, lower end y coordinate and inverse slope dx / dy */
+  double x, y, yBottom, slope;
+  /** @brief +1 for edges going down, -1 for edges going up */
+  int winding;
+};
+
+bool CompareEdges(const Edge &a, const Edge &b)
+{
+  return a.yStart < b.yStart;
+}
+
+/** @brief Edge crossing a scanline. */
+struct Crossing
+{
+  double x;
+  int winding;
+};
+
+bool CompareCrossings(const Crossing &a, const Crossing &b)
+{
+  return a.x < b.x;
+}
+
+/** @brief Buffers used while filling polygons, kept per thread so filling
+           many small polygons does not allocate memory. */
+struct FillBuffers
+{
+  vector<Edge> edges, active;
+  vector<Crossing> crossings;
+  vector<int> area, cover;
+  vector<unsigned char> alpha;
+};
+
+FillBuffers &GetFillBuffers()
+{
+  thread_local FillBuffers buffers;
+  return buffers;
+}
+
+/** @brief Returns first pixel index with center >= v relative to origin,
+           clamped to [-1, size] to avoid overflows for coordinates far
+           outside. */
+int FirstIndex(double v, int origin, int size)
+{
+  v = ceil(v) - origin;
+  return (v < -1.0) ? -1 : (v > size) ? size : (int)v;
+}
+
+/** @brief Number of sub-scanlines per row for anti-aliased filling. */
+const int SUBSAMPLES = 4;
+
+/** @brief Add coverage of span [xl, xr) of a sub-scanline to the row
+           buffers in 1/256 pixel units. Pixel i covers [i - 0.5, i + 0.5),
+           so only the pixels at both ends of the span are partially covered.
+           Fully covered pixels are added as differences to cover, which
+           is summed up once per row. The span is given in coordinates of
+           the image and clipped to the view starting at pixel origin. */
+void AddSpanCoverage(double xl, double xr, int origin, int width, vector<int> &area,
+                     vector<int> &cover, int &xMin, int &xMax)
+{
+  xl = max(origin - 0.5, min(origin + width - 0.5, xl));
+  xr = max(origin - 0.5, min(origin + width - 0.5, xr));
+  int l = (int)(lround((xl + 0.5) * 256.0) - 256LL * origin);
+  int r = (int)(lround((xr + 0.5) * 256.0) - 256LL * origin);
+  if (l >= r)
+    return;
+  int i0 = l >> 8, i1 = r >> 8;
+  if (i0 == i1) {
+    area[i0] += r - l;
+  } else {
+    area[i0] += 256 * (i0 + 1) - l;
+    area[i1] += r - 256 * i1;
+    cover[i0 + 1] += 256;
+    cover[i1] -= 256;
+  }
+  xMin = min(xMin, i0);
+  xMax = max(xMax, i1);
+}
+
+/** @brief Fill pixels with centers in [xl, xr) in row y of the view, where
+           xl and xr are image coordinates and origin is the image x
+           coordinate of the first pixel of the view. */
+void FillSpan(const ImageView &view, int y, double xl, double xr, int origin,
+              const Color &color)
+{
+  int width = view.GetWidth();
+  int x0 = FirstIndex(xl, origin, width), x1 = FirstIndex(xr, origin, width) - 1;
+  view.FillRow(y, x0, x1, color);
+}
+
+}
+
+PrimitivePolygon::PrimitivePolygon(const Color &color, int numPoints,
+                                   FillMode fillMode)
+  : PrimitiveBase(color, numPoints), fillMode_(fillMode)
 {
 }
 
 PrimitivePolygon::PrimitivePolygon(const Color &color,
-                                   const std::vector<Float2D> &points)
-  : PrimitiveBase(color, points.size())
+                                   const std::vector<Float2D> &points,
+                                   FillMode fillMode)
+  : PrimitiveBase(color, points.size()), fillMode_(fillMode)
 {
   for (int n = 0; n < (int)points.size(); n++) {
     SetPoint(n, points[n]);
@@ -23,13 +124,249 @@ PrimitivePolygon::~PrimitivePolygon()
 {
 }
 
-void PrimitivePolygon::Draw(Image &image) const
+PrimitivePolygon::FillMode PrimitivePolygon::GetFillMode() const
+{
+  return fillMode_;
+}
+
+void PrimitivePolygon::SetFillMode(FillMode fillMode)
+{
+  fillMode_ = fillMode;
+}
+
+void PrimitivePolygon::Draw(const ImageView &view) const
 {
   int numPoints = GetNumPoints();
+  vector<float> pointsX(numPoints), pointsY(numPoints);
+  for (int n = 0; n < numPoints; n++) {
+    pointsX[n] = GetPoint(n)[0];
+    pointsY[n] = GetPoint(n)[1];
+  }
+  DrawPolygon(view, pointsX.data(), pointsY.data(), numPoints, fillMode_,
+              renderMode_, color_);
+}
+
+void PrimitivePolygon::DrawPolygon(const ImageView &view, const float *pointsX,
+                                   const float *pointsY, int numPoints,
+                                   FillMode fillMode, RenderMode renderMode,
+                                   const Color &color, int originX, int originY)
+{
+  if (fillMode != FM_Outline) {
+    if (renderMode == RM_AntiAliased)
+      FillAntiAliased_(view, pointsX, pointsY, numPoints, fillMode, color, originX, originY);
+    else
+      Fill_(view, pointsX, pointsY, numPoints, fillMode, color, originX, originY);
+    return;
+  }
 
   // Draw lines between subsequent 2d points
   for (int n = 0; n < numPoints; n++) {
-    PrimitiveLine line(color_, GetPoint(n), GetPoint((n+1) % numPoints));
-    line.Draw(image);
+    int m = (n+1) % numPoints;
+    Float2D p(pointsX[n], pointsY[n]), q(pointsX[m], pointsY[m]);
+    if (renderMode == RM_AntiAliased)
+      PrimitiveLine::DrawLineAntiAliased(view, p, q, color, originX, originY);
+    else
+      PrimitiveLine::DrawLine(view, p, q, color, originX, originY);
+  }
+}
+
+void PrimitivePolygon::Fill_(const ImageView &view, const float *pointsX,
+                             const float *pointsY, int numPoints, FillMode fillMode,
+                             const Color &color, int originX, int originY)
+{
+  int height = view.GetHeight();
+  if (numPoints < 3 || view.IsEmpty() || view.IsReadOnly())
+    return;
+
+  // Build edge table of non-horizontal edges intersecting the view rows,
+  // edges cover rows with centers in [ymin, ymax) and count the changes of
+  // direction in y to detect monotone polygons
+  FillBuffers &buffers = GetFillBuffers();
+  vector<Edge> &edges = buffers.edges;
+  edges.clear();
+  int numTurns = 0, lastWinding = 0, firstWinding = 0;
+  for (int n = 0; n < numPoints; n++) {
+    int m = (n+1) % numPoints;
+    double px = pointsX[n], py = pointsY[n], qx = pointsX[m], qy = pointsY[m];
+    if (py == qy)
+      continue;
+    Edge edge;
+    edge.winding = (py < qy) ? 1 : -1;
+    if (edge.winding < 0) {
+      swap(px, qx);
+      swap(py, qy);
+    }
+    if (lastWinding != 0 && edge.winding != lastWinding)
+      numTurns++;
+    if (firstWinding == 0)
+      firstWinding = edge.winding;
+    lastWinding = edge.winding;
+    edge.x = px;
+    edge.y = py;
+    edge.yBottom = qy;
+    edge.slope = (qx - px) / (qy - py);
+    edge.yStart = max(FirstIndex(py, originY, height), 0);
+    edge.yEnd = min(FirstIndex(qy, originY, height), height) - 1;
+    if (edge.yStart <= edge.yEnd)
+      edges.push_back(edge);
+  }
+  if (lastWinding != firstWinding)
+    numTurns++;
+  if (edges.empty())
+    return;
+  bool monotone = (numTurns <= 2);
+  sort(edges.begin(), edges.end(), CompareEdges);
+
+  // Process rows from top to bottom, keeping the active edges in a list
+  vector<Edge> &active = buffers.active;
+  vector<Crossing> &crossings = buffers.crossings;
+  active.clear();
+  size_t next = 0;
+  for (int y = edges[0].yStart; y < height && (next < edges.size() || !active.empty()); y++) {
+    // Remove edges ending above this row and add edges starting in it
+    size_t numActive = 0;
+    for (size_t i = 0; i < active.size(); i++)
+      if (active[i].yEnd >= y)
+        active[numActive++] = active[i];
+    active.resize(numActive);
+    for (; next < edges.size() && edges[next].yStart == y; next++)
+      active.push_back(edges[next]);
+    if (active.empty()) {
+      if (next < edges.size())
+        y = edges[next].yStart - 1;
+      continue;
+    }
+
+    // Compute crossings in image coordinates, so drawing into tiles with
+    // an origin gives the same pixels as drawing at once
+    double yImage = y + originY;
+    if (monotone) {
+      // Single span between leftmost and rightmost crossing
+      double xl = active[0].x + (yImage - active[0].y) * active[0].slope, xr = xl;
+      for (size_t i = 1; i < active.size(); i++) {
+        double x = active[i].x + (yImage - active[i].y) * active[i].slope;
+        xl = min(xl, x);
+        xr = max(xr, x);
+      }
+      FillSpan(view, y, xl, xr, originX, color);
+      continue;
+    }
+
+    // Sort crossings and fill spans inside according to the fill rule
+    crossings.resize(active.size());
+    for (size_t i = 0; i < active.size(); i++) {
+      crossings[i].x = active[i].x + (yImage - active[i].y) * active[i].slope;
+      crossings[i].winding = active[i].winding;
+    }
+    sort(crossings.begin(), crossings.end(), CompareCrossings);
+    int winding = 0;
+    for (size_t i = 0; i + 1 < crossings.size(); i++) {
+      winding += (fillMode == FM_EvenOdd) ? 1 : crossings[i].winding;
+      bool inside = (fillMode == FM_EvenOdd) ? (winding & 1) != 0 : winding != 0;
+      if (inside)
+        FillSpan(view, y, crossings[i].x, crossings[i+1].x, originX, color);
+    }
+  }
+}
+
+void PrimitivePolygon::FillAntiAliased_(const ImageView &view, const float *pointsX,
+                                        const float *pointsY, int numPoints,
+                                        FillMode fillMode, const Color &color,
+                                        int originX, int originY)
+{
+  int width = view.GetWidth(), height = view.GetHeight();
+  if (numPoints < 3 || view.IsEmpty() || view.IsReadOnly())
+    return;
+
+  // Build edge table of non-horizontal edges, edges cover sub-scanlines in
+  // [ymin, ymax) and rows with any sub-scanline inside
+  double offset = 0.5 - 0.5 / SUBSAMPLES;
+  FillBuffers &buffers = GetFillBuffers();
+  vector<Edge> &edges = buffers.edges;
+  edges.clear();
+  for (int n = 0; n < numPoints; n++) {
+    int m = (n+1) % numPoints;
+    double px = pointsX[n], py = pointsY[n], qx = pointsX[m], qy = pointsY[m];
+    if (py == qy)
+      continue;
+    Edge edge;
+    edge.winding = (py < qy) ? 1 : -1;
+    if (edge.winding < 0) {
+      swap(px, qx);
+      swap(py, qy);
+    }
+    edge.x = px;
+    edge.y = py;
+    edge.yBottom = qy;
+    edge.slope = (qx - px) / (qy - py);
+    edge.yStart = max(FirstIndex(py - offset, originY, height), 0);
+    edge.yEnd = min(FirstIndex(qy + offset, originY, height), height) - 1;
+    if (edge.yStart <= edge.yEnd)
+      edges.push_back(edge);
+  }
+  if (edges.empty())
+    return;
+  sort(edges.begin(), edges.end(), CompareEdges);
+
+  // Accumulate coverage of all sub-scanlines of a row and blend the row
+  vector<int> &area = buffers.area, &cover = buffers.cover;
+  vector<unsigned char> &alpha = buffers.alpha;
+  area.assign(width + 1, 0);
+  cover.assign(width + 2, 0);
+  alpha.resize(width);
+  vector<Edge> &active = buffers.active;
+  vector<Crossing> &crossings = buffers.crossings;
+  active.clear();
+  size_t next = 0;
+  for (int y = edges[0].yStart; y < height && (next < edges.size() || !active.empty()); y++) {
+    // Remove edges ending above this row and add edges starting in it
+    size_t numActive = 0;
+    for (size_t i = 0; i < active.size(); i++)
+      if (active[i].yEnd >= y)
+        active[numActive++] = active[i];
+    active.resize(numActive);
+    for (; next < edges.size() && edges[next].yStart == y; next++)
+      active.push_back(edges[next]);
+    if (active.empty()) {
+      if (next < edges.size())
+        y = edges[next].yStart - 1;
+      continue;
+    }
+
+    int xMin = width, xMax = -1;
+    for (int s = 0; s < SUBSAMPLES; s++) {
+      double ys = (double)(y + originY) - offset + (double)s / SUBSAMPLES;
+      crossings.clear();
+      for (size_t i = 0; i < active.size(); i++) {
+        if (ys < active[i].y || ys >= active[i].yBottom)
+          continue;
+        Crossing crossing;
+        crossing.x = active[i].x + (ys - active[i].y) * active[i].slope;
+        crossing.winding = active[i].winding;
+        crossings.push_back(crossing);
+      }
+      sort(crossings.begin(), crossings.end(), CompareCrossings);
+      int winding = 0;
+      for (size_t i = 0; i + 1 < crossings.size(); i++) {
+        winding += (fillMode == FM_EvenOdd) ? 1 : crossings[i].winding;
+        bool inside = (fillMode == FM_EvenOdd) ? (winding & 1) != 0 : winding != 0;
+        if (inside)
+          AddSpanCoverage(crossings[i].x, crossings[i+1].x, originX, width, area,
+                          cover, xMin, xMax);
+      }
+    }
+    if (xMin > xMax)
+      continue;
+
+    // Convert coverage to opacities and clear the buffers for the next row
+    int x1 = min(xMax, width - 1), full = 0;
+    for (int x = xMin; x <= x1; x++) {
+      full += cover[x];
+      int value = area[x] + full;
+      alpha[x] = (unsigned char)((value * 255 + SUBSAMPLES * 128) / (SUBSAMPLES * 256));
+    }
+    fill(area.begin() + xMin, area.begin() + xMax + 1, 0);
+    fill(cover.begin() + xMin, cover.begin() + xMax + 2, 0);
+    view.BlendRow(y, xMin, x1 - xMin + 1, &alpha[xMin], color);
   }
 }
@@ -4,24 +4,71 @@
 #include "PrimitiveBase.hh"
 
 /** @class  PrimitivePolygon
-    @brief  Implements a 2d polygon primitive.
+    @brief  Implements a 2d polygon primitive, drawn as outline or filled.
     @author esquivel
  */
 class PrimitivePolygon : public PrimitiveBase
 {
 public:
 
+  /** @brief Define how the polygon is drawn. Filled polygons cover all
+             pixels whose center lies inside the polygon, where a pixel
+             center on the left or top edge is inside and on the right or
+             bottom edge is outside, so adjacent polygons sharing an edge do
+             not overlap. Inside is decided by the even-odd rule (odd number
+             of edge crossings to the left) or the nonzero rule (nonzero
+             winding number), both are equal for simple polygons. */
+  enum FillMode { FM_Outline, FM_EvenOdd, FM_NonZero };
+
   /** @brief Initialize polygon primitive with given number of points. */
-  PrimitivePolygon(const Color &color, int numPoints);
+  PrimitivePolygon(const Color &color, int numPoints,
+                   FillMode fillMode = FM_Outline);
 
   /** @brief Initialize polygon primitive with given points. */
-  PrimitivePolygon(const Color &color, const std::vector<Float2D> &points);
+  PrimitivePolygon(const Color &color, const std::vector<Float2D> &points,
+                   FillMode fillMode = FM_Outline);
 
   /** @brief Destructor. Release dynamically allocated memory. */
   virtual ~PrimitivePolygon();
 
-  /** @brief Draw polygon into given image. */
-  virtual void Draw(Image &image) const;
+  /** @brief Returns how the polygon is drawn. */
+  FillMode GetFillMode() const;
+
+  /** @brief Set how the polygon is drawn. */
+  void SetFillMode(FillMode fillMode);
+
+  using PrimitiveBase::Draw;
+
+  /** @brief Draw polygon outline or filled polygon into given image view. */
+  virtual void Draw(const ImageView &view) const;
+
+  /** @brief Draw polygon with given point coordinates into the view, where
+             (originX, originY) are the coordinates of the top left pixel of
+             the view, e.g. to draw into a tile of the image. */
+  static void DrawPolygon(const ImageView &view, const float *pointsX,
+                          const float *pointsY, int numPoints, FillMode fillMode,
+                          RenderMode renderMode, const Color &color,
+                          int originX = 0, int originY = 0);
+
+private:
+
+  /** @brief Fill polygon with a scanline algorithm using an edge table.
+             Spans are written with ImageView::FillRow(). Polygons whose
+             outline is monotone in y (e.g. convex polygons and rectangles)
+             have a single span per row, so crossings need no sorting. */
+  static void Fill_(const ImageView &view, const float *pointsX, const float *pointsY,
+                    int numPoints, FillMode fillMode, const Color &color,
+                    int originX, int originY);
+
+  /** @brief Fill polygon with anti-aliased edges. Coverage of each pixel is
+             accumulated in fixed point from several sub-scanlines per row,
+             using the exact horizontal overlap of each span, and the color
+             is blended into each row with ImageView::BlendRow(). */
+  static void FillAntiAliased_(const ImageView &view, const float *pointsX,
+                               const float *pointsY, int numPoints, FillMode fillMode,
+                               const Color &color, int originX, int originY);
+
+  FillMode fillMode_;
 
 };
 
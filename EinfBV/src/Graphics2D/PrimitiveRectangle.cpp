@@ -5,8 +5,8 @@ using namespace std;
 
 PrimitiveRectangle::
 PrimitiveRectangle(const Color &color, const Float2D &topLeft,
-                   const Float2D &bottomRight)
-  : PrimitivePolygon(color, 4)
+                   const Float2D &bottomRight, FillMode fillMode)
+  : PrimitivePolygon(color, 4, fillMode)
 {
   SetPoint(0, topLeft);
   SetPoint(1, Float2D(bottomRight[0], topLeft[1]));
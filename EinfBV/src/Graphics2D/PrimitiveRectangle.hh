@@ -11,9 +11,11 @@ class PrimitiveRectangle : public PrimitivePolygon
 {
 public:
 
-  /** @brief Initialize rectangle primitive with points. */
+  /** @brief Initialize rectangle primitive with points. A filled rectangle
+             covers the pixels with centers in [left, right) x [top, bottom)
+             (see PrimitivePolygon::FillMode). */
   PrimitiveRectangle(const Color &color, const Float2D &topLeft,
-                     const Float2D &bottomRight);
+                     const Float2D &bottomRight, FillMode fillMode = FM_Outline);
 
   /** @brief Destructor. Release dynamically allocated memory. */
   virtual ~PrimitiveRectangle();